@@ -0,0 +1,97 @@
+/**
+ * Measures the throughput of the float conversion kernels run by the worker pool, each with and without its vector
+ * instructions. Needs no GL context, the kernels run on frames of random components in memory.
+ *
+ * usage: ConversionBenchmark [--quick] [--seconds <minimum seconds per case = 0.5>]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include "FloatConverter.hpp"
+#include "Samples.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  bool quick = false;
+  double seconds = 0.5;
+};
+
+auto parse(int argc, char** argv) -> Options {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (arg == "--quick") {
+      options.quick = true;
+    } else if (arg == "--seconds" && i + 1 < argc) {
+      options.seconds = std::strtod(argv[++i], nullptr);
+    }
+  }
+  return options;
+}
+
+struct Kernel {
+  char const* name;
+  FloatKernel kernel;
+};
+
+constexpr Kernel kKernels[] = {
+    {"half", FloatKernel::kHalf},       {"unorm8", FloatKernel::kUnorm8},   {"snorm8", FloatKernel::kSnorm8},
+    {"unorm16", FloatKernel::kUnorm16}, {"snorm16", FloatKernel::kSnorm16}, {"srgb8", FloatKernel::kSrgb8},
+};
+
+/**
+ * @brief Convert the frame until at least min_seconds have passed and 8 conversions completed
+ */
+auto run_case(Kernel const& kernel, bool vectorised, std::vector<uint8_t> const& src, std::vector<float>& dst,
+              double min_seconds) -> Samples {
+  constexpr size_t kMinRuns = 8;
+  Samples samples{vectorised ? "vectorised" : "scalar", {}};
+  Clock::time_point start = Clock::now();
+  while (samples.ns.size() < kMinRuns || std::chrono::duration<double>(Clock::now() - start).count() < min_seconds) {
+    Clock::time_point begin = Clock::now();
+    convert_to_float(kernel.kernel, src.data(), dst.size(), 4, dst.data(), vectorised);
+    samples.ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count());
+  }
+  samples.sort();
+  return samples;
+}
+
+}  // namespace
+
+auto main(int argc, char** argv) -> int {
+  Options options = parse(argc, argv);
+  int width = 1920;
+  int height = 1080;
+  if (options.quick) {
+    width = 256;
+    height = 256;
+    options.seconds = 0;
+  }
+
+  // 4 components per pixel, the largest components take 2 bytes
+  size_t count = static_cast<size_t>(width) * height * 4;
+  std::vector<uint8_t> src(count * 2);
+  std::mt19937 random(1);
+  for (uint8_t& byte : src) byte = static_cast<uint8_t>(random());
+  std::vector<float> dst(count);
+
+  std::printf("%dx%d RGBA\n", width, height);
+  std::printf("%-8s %-10s %8s %10s %10s %12s\n", "kernel", "path", "runs", "p50 us", "p99 us", "Mcomp/s");
+  for (Kernel const& kernel : kKernels) {
+    for (bool vectorised : {false, true}) {
+      Samples samples = run_case(kernel, vectorised, src, dst, options.seconds);
+      double p50 = static_cast<double>(samples.at(0.5));
+      std::printf("%-8s %-10s %8zu %10.1f %10.1f %12.1f\n", kernel.name, samples.name, samples.ns.size(), p50 * 1e-3,
+                  static_cast<double>(samples.at(0.99)) * 1e-3, static_cast<double>(count) / p50 * 1e3);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,138 @@
+/**
+ * Measures how long main-thread request queries take while large readbacks are retrieved on the render thread.
+ *
+ * usage: QueryLatencyBenchmark [size in MiB = 256] [frames = 240] [requests in flight = 4] [--readback-thread]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "HeadlessRenderThread.hpp"
+#include "Samples.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  GLsizeiptr size = GLsizeiptr{256} << 20;
+  int frames = 240;
+  size_t in_flight = 4;
+  bool readback_thread = false;
+};
+
+auto parse(int argc, char** argv) -> Options {
+  Options options;
+  int positional = 0;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (arg == "--readback-thread") {
+      options.readback_thread = true;
+      continue;
+    }
+    long value = std::strtol(argv[i], nullptr, 10);
+    switch (positional++) {
+      case 0: options.size = static_cast<GLsizeiptr>(value) << 20; break;
+      case 1: options.frames = static_cast<int>(value); break;
+      case 2: options.in_flight = static_cast<size_t>(value); break;
+      default: break;
+    }
+  }
+  return options;
+}
+
+template <class F>
+void measure(Samples& samples, F&& query) {
+  Clock::time_point start = Clock::now();
+  query();
+  samples.ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+}
+
+}  // namespace
+
+auto main(int argc, char** argv) -> int try {
+  Options options = parse(argc, argv);
+  HeadlessRenderThread render_thread;
+  std::printf("renderer: %s\n", render_thread.renderer());
+
+  SetReadbackThreadEnabled(options.readback_thread);
+
+  GLuint buffer = render_thread.run([&options]() {
+    GLuint ssbo = 0;
+    glGenBuffers(1, &ssbo);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, options.size, nullptr, GL_STATIC_DRAW);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R8, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glFinish();
+    return ssbo;
+  });
+
+  // queries run on their own thread against the newest request, like scripts polling while the frame loop runs
+  std::atomic<EventId> latest = -1;
+  std::atomic<bool> stop = false;
+  Samples done{"Request_Done", {}};
+  Samples exists{"Request_Exists", {}};
+  Samples get_data{"Request_GetData", {}};
+  std::thread queries([&]() {
+    while (!stop) {
+      EventId id = latest;
+      if (id < 0) continue;
+      measure(done, [id]() { static_cast<void>(Request_Done(id)); });
+      measure(exists, [id]() { static_cast<void>(Request_Exists(id)); });
+      measure(get_data, [id]() {
+        void* data = nullptr;
+        size_t length = 0;
+        static_cast<void>(Request_GetData(id, &data, &length));
+      });
+    }
+  });
+
+  constexpr auto kFrameTime = std::chrono::microseconds(16667);
+  std::vector<EventId> in_flight;
+  size_t completed = 0;
+  Clock::time_point start = Clock::now();
+  Clock::time_point next_frame = start;
+  for (int frame = 0; frame < options.frames; ++frame) {
+    std::erase_if(in_flight, [&completed](EventId id) {
+      bool is_done = Request_Done(id);
+      if (is_done) ++completed;
+      return is_done;
+    });
+    while (in_flight.size() < options.in_flight) {
+      EventId id = Request_ComputeBuffer(buffer, options.size);
+      in_flight.push_back(id);
+      latest = id;
+    }
+    MainThread_UpdateOnce();
+
+    next_frame += kFrameTime;
+    std::this_thread::sleep_until(next_frame);
+  }
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  stop = true;
+  queries.join();
+  for (EventId id : in_flight) Request_WaitForCompletion(id);
+
+  std::printf("%d frames, %zu readbacks of %lld MiB completed, %.2f GiB/s, readback thread %s\n", options.frames,
+              completed, static_cast<long long>(options.size >> 20),
+              static_cast<double>(completed) * static_cast<double>(options.size) / seconds / (1 << 30),
+              IsReadbackThreadActive() ? "on" : "off");
+  done.report();
+  exists.report();
+  get_data.report();
+
+  render_thread.run([buffer]() { glDeleteBuffers(1, &buffer); });
+  return 0;
+} catch (std::exception const& e) {
+  std::fprintf(stderr, "%s\n", e.what());
+  return 1;
+}
@@ -0,0 +1,194 @@
+/**
+ * Measures readback throughput and latency for textures and compute buffers across sizes, formats and in-flight
+ * depths. Each frame updates the plugin from the main thread and waits for the render thread to run the frame's
+ * events, latency is measured from creating a request until the main thread sees it done.
+ *
+ * usage: ReadbackBenchmark [--quick] [--readback-thread] [--seconds <minimum seconds per case = 0.5>]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "HeadlessRenderThread.hpp"
+#include "Samples.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  bool quick = false;
+  bool readback_thread = false;
+  double seconds = 0.5;
+};
+
+auto parse(int argc, char** argv) -> Options {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (arg == "--quick") {
+      options.quick = true;
+    } else if (arg == "--readback-thread") {
+      options.readback_thread = true;
+    } else if (arg == "--seconds" && i + 1 < argc) {
+      options.seconds = std::strtod(argv[++i], nullptr);
+    }
+  }
+  return options;
+}
+
+struct Format {
+  char const* name;
+  GLenum internal_format;
+  GLenum format;
+  GLenum type;
+  GLsizeiptr pixel_size;
+};
+
+constexpr Format kFormats[] = {
+    {"R8", GL_R8, GL_RED, GL_UNSIGNED_BYTE, 1},
+    {"RGBA8", GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 4},
+    {"RGBA16F", GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, 8},
+    {"RGBA32F", GL_RGBA32F, GL_RGBA, GL_FLOAT, 16},
+};
+
+/**
+ * @brief Result of one benchmark case
+ */
+struct Result {
+  size_t requests = 0;
+  double seconds = 0;
+  Samples latency{"latency", {}};
+};
+
+/**
+ * @brief Keep depth requests in flight until at least min_seconds have passed and 8 requests completed
+ * @param submit creates a request and returns its id
+ */
+template <class Submit>
+auto run_case(HeadlessRenderThread& render_thread, size_t depth, double min_seconds, Submit&& submit) -> Result {
+  constexpr size_t kMinRequests = 8;
+  struct InFlight {
+    EventId id;
+    Clock::time_point submitted;
+  };
+
+  Result result;
+  std::vector<InFlight> in_flight;
+  Clock::time_point start = Clock::now();
+  while (result.requests < kMinRequests ||
+         std::chrono::duration<double>(Clock::now() - start).count() < min_seconds) {
+    while (in_flight.size() < depth) in_flight.push_back({submit(), Clock::now()});
+
+    render_thread.frame();
+
+    std::erase_if(in_flight, [&result](InFlight const& request) {
+      if (!Request_Done(request.id)) return false;
+      if (Request_Error(request.id)) throw std::runtime_error("readback failed");
+      result.latency.ns.push_back(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - request.submitted).count());
+      ++result.requests;
+      return true;
+    });
+  }
+  result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  // finish the remaining requests so that they do not count towards the next case
+  for (InFlight const& request : in_flight) Request_WaitForCompletion(request.id);
+  MainThread_UpdateOnce();
+  render_thread.frame();
+  return result;
+}
+
+void report(char const* kind, char const* format, char const* size, size_t depth, GLsizeiptr bytes, Result& result) {
+  result.latency.sort();
+  double requests = static_cast<double>(result.requests);
+  std::printf("%-8s %-8s %12s %5zu %8zu %10.1f %10.3f %10.3f %10.3f\n", kind, format, size, depth, result.requests,
+              requests / result.seconds, requests * static_cast<double>(bytes) / result.seconds / (1 << 20),
+              static_cast<double>(result.latency.at(0.5)) * 1e-6, static_cast<double>(result.latency.at(0.99)) * 1e-6);
+}
+
+}  // namespace
+
+auto main(int argc, char** argv) -> int try {
+  Options options = parse(argc, argv);
+  HeadlessRenderThread render_thread;
+  std::printf("renderer: %s\n", render_thread.renderer());
+
+  SetReadbackThreadEnabled(options.readback_thread);
+  // the thread is started on the next update
+  render_thread.frame();
+  std::printf("readback thread %s\n", IsReadbackThreadActive() ? "on" : "off");
+
+  std::vector<GLsizei> texture_sizes = {256, 1024, 2048};
+  std::vector<GLsizeiptr> buffer_sizes = {GLsizeiptr{64} << 10, GLsizeiptr{4} << 20, GLsizeiptr{64} << 20};
+  std::vector<size_t> depths = {1, 2, 4, 8};
+  if (options.quick) {
+    texture_sizes = {256, 1024};
+    buffer_sizes = {GLsizeiptr{64} << 10, GLsizeiptr{4} << 20};
+    depths = {1, 4};
+    options.seconds = 0;
+  }
+
+  std::printf("%-8s %-8s %12s %5s %8s %10s %10s %10s %10s\n", "kind", "format", "size", "depth", "requests", "req/s",
+              "MiB/s", "p50 ms", "p99 ms");
+
+  for (GLsizei size : texture_sizes) {
+    for (Format const& format : kFormats) {
+      GLuint texture = render_thread.run([&format, size]() {
+        GLuint name = 0;
+        glGenTextures(1, &name);
+        glBindTexture(GL_TEXTURE_2D, name);
+        glTexStorage2D(GL_TEXTURE_2D, 1, format.internal_format, size, size);
+        glClearTexImage(name, 0, format.format, format.type, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glFinish();
+        return name;
+      });
+
+      char label[32];
+      std::snprintf(label, sizeof(label), "%dx%d", size, size);
+      GLsizeiptr bytes = GLsizeiptr{size} * size * format.pixel_size;
+      for (size_t depth : depths) {
+        Result result =
+            run_case(render_thread, depth, options.seconds, [texture]() { return Request_Texture(texture, 0); });
+        report("texture", format.name, label, depth, bytes, result);
+      }
+
+      render_thread.run([texture]() { glDeleteTextures(1, &texture); });
+    }
+  }
+
+  for (GLsizeiptr size : buffer_sizes) {
+    GLuint buffer = render_thread.run([size]() {
+      GLuint name = 0;
+      glGenBuffers(1, &name);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, name);
+      glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_STATIC_DRAW);
+      glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R8, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+      glFinish();
+      return name;
+    });
+
+    char label[32];
+    std::snprintf(label, sizeof(label), "%lld KiB", static_cast<long long>(size >> 10));
+    for (size_t depth : depths) {
+      Result result = run_case(render_thread, depth, options.seconds,
+                               [buffer, size]() { return Request_ComputeBuffer(buffer, size); });
+      report("buffer", "-", label, depth, size, result);
+    }
+
+    render_thread.run([buffer]() { glDeleteBuffers(1, &buffer); });
+  }
+
+  return 0;
+} catch (std::exception const& e) {
+  std::fprintf(stderr, "%s\n", e.what());
+  return 1;
+}
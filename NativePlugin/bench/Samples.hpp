@@ -0,0 +1,32 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+/**
+ * @brief Latency samples in nanoseconds
+ */
+struct Samples {
+  char const* name;
+  std::vector<int64_t> ns;
+
+  /**
+   * @param q quantile in [0, 1], the samples must be sorted
+   */
+  [[nodiscard]] auto at(double q) const -> int64_t {
+    if (ns.empty()) return 0;
+    return ns[static_cast<size_t>(q * static_cast<double>(ns.size() - 1))];
+  }
+
+  void sort() { std::sort(ns.begin(), ns.end()); }
+
+  void report() {
+    if (ns.empty()) return;
+    sort();
+    std::printf("%-16s %10zu calls  p50 %8lld ns  p99 %8lld ns  p99.9 %8lld ns  max %10lld ns\n", name, ns.size(),
+                static_cast<long long>(at(0.5)), static_cast<long long>(at(0.99)), static_cast<long long>(at(0.999)),
+                static_cast<long long>(ns.back()));
+  }
+};
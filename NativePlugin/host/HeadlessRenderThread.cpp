@@ -0,0 +1,188 @@
+#include "HeadlessRenderThread.hpp"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// stub Unity interfaces, only called from the render thread
+std::vector<IUnityGraphicsDeviceEventCallback> device_event_callbacks;
+int next_event_id = 0;
+
+auto UNITY_INTERFACE_API get_renderer() -> UnityGfxRenderer { return kUnityGfxRendererOpenGLCore; }
+void UNITY_INTERFACE_API register_device_event_callback(IUnityGraphicsDeviceEventCallback callback) {
+  device_event_callbacks.push_back(callback);
+}
+void UNITY_INTERFACE_API unregister_device_event_callback(IUnityGraphicsDeviceEventCallback callback) {
+  std::erase(device_event_callbacks, callback);
+}
+auto UNITY_INTERFACE_API reserve_event_id_range(int count) -> int {
+  int first = next_event_id;
+  next_event_id += count;
+  return first;
+}
+
+auto make_graphics() noexcept -> IUnityGraphics {
+  IUnityGraphics graphics{};
+  graphics.GetRenderer = get_renderer;
+  graphics.RegisterDeviceEventCallback = register_device_event_callback;
+  graphics.UnregisterDeviceEventCallback = unregister_device_event_callback;
+  graphics.ReserveEventIDRange = reserve_event_id_range;
+  return graphics;
+}
+
+IUnityGraphics graphics = make_graphics();
+
+auto UNITY_INTERFACE_API get_interface(UnityInterfaceGUID guid) -> IUnityInterface* {
+  if (guid == GetUnityInterfaceGUID<IUnityGraphics>()) return &graphics;
+  return nullptr;
+}
+auto UNITY_INTERFACE_API get_interface_split(unsigned long long high, unsigned long long low) -> IUnityInterface* {
+  return get_interface(UnityInterfaceGUID(high, low));
+}
+void UNITY_INTERFACE_API register_interface(UnityInterfaceGUID /* guid */, IUnityInterface* /* ptr */) {}
+void UNITY_INTERFACE_API register_interface_split(unsigned long long /* high */, unsigned long long /* low */,
+                                                  IUnityInterface* /* ptr */) {}
+
+IUnityInterfaces interfaces{
+    .GetInterface = get_interface,
+    .RegisterInterface = register_interface,
+    .GetInterfaceSplit = get_interface_split,
+    .RegisterInterfaceSplit = register_interface_split,
+};
+
+/**
+ * @brief Surfaceless Mesa display if available so that no window system is needed, the default display otherwise
+ */
+auto open_display() -> EGLDisplay {
+  auto get_platform_display =
+      reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  EGLDisplay display = EGL_NO_DISPLAY;
+  if (get_platform_display != nullptr) {
+    display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+  }
+  if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if (display == EGL_NO_DISPLAY || eglInitialize(display, nullptr, nullptr) != EGL_TRUE) {
+    throw std::runtime_error("failed to initialize an EGL display");
+  }
+  return display;
+}
+
+auto create_context(EGLDisplay display) -> EGLContext {
+  eglBindAPI(EGL_OPENGL_API);
+  // surfaceless displays have no window configs, which is what is asked for by default
+  EGLint const config_attribs[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+  EGLConfig config = nullptr;
+  EGLint config_count = 0;
+  if (eglChooseConfig(display, config_attribs, &config, 1, &config_count) != EGL_TRUE || config_count == 0) {
+    throw std::runtime_error("no EGL config supports desktop OpenGL");
+  }
+
+  // compute buffer readbacks need 4.3
+  for (EGLint minor : {5, 3}) {
+    EGLint const context_attribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                      4,
+                                      EGL_CONTEXT_MINOR_VERSION,
+                                      minor,
+                                      EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                      EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                      EGL_NONE};
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+    if (context != EGL_NO_CONTEXT) return context;
+  }
+  throw std::runtime_error("failed to create an OpenGL 4.3 core context");
+}
+
+}  // namespace
+
+HeadlessRenderThread::HeadlessRenderThread() {
+  std::promise<void> started;
+  std::future<void> ready = started.get_future();
+  thread_ = std::thread([this, started = std::move(started)]() mutable { run_loop(std::move(started)); });
+  try {
+    ready.get();
+  } catch (...) {
+    thread_.join();
+    throw;
+  }
+  current_ = this;
+  SetGLIssuePluginEventPtr(issue_plugin_event);
+}
+
+HeadlessRenderThread::~HeadlessRenderThread() noexcept {
+  submit([]() {
+    // copied since callbacks unregister themselves
+    std::vector<IUnityGraphicsDeviceEventCallback> callbacks = device_event_callbacks;
+    for (auto callback : callbacks) callback(kUnityGfxDeviceEventShutdown);
+    UnityPluginUnload();
+    device_event_callbacks.clear();
+  });
+  {
+    std::scoped_lock guard(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_one();
+  thread_.join();
+  current_ = nullptr;
+}
+
+void HeadlessRenderThread::issue_plugin_event(UnityRenderingEvent event, int event_id) {
+  current_->submit([event, event_id]() { event(event_id); });
+}
+
+void HeadlessRenderThread::frame() {
+  MainThread_UpdateOnce();
+  run([]() {});
+}
+
+void HeadlessRenderThread::submit(std::function<void()> job) {
+  {
+    std::scoped_lock guard(mutex_);
+    jobs_.emplace_back(std::move(job));
+  }
+  wake_.notify_one();
+}
+
+void HeadlessRenderThread::run_loop(std::promise<void> started) {
+  EGLDisplay display = EGL_NO_DISPLAY;
+  EGLContext context = EGL_NO_CONTEXT;
+  try {
+    display = open_display();
+    context = create_context(display);
+    if (eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context) != EGL_TRUE) {
+      throw std::runtime_error("failed to make the EGL context current without a surface");
+    }
+
+    // loads the entry points for GL calls made by the benchmarks themselves, core contexts need experimental
+    glewExperimental = GL_TRUE;
+    glewInit();
+    UnityPluginLoad(&interfaces);
+    if (!CheckCompatible()) throw std::runtime_error("the plugin does not accept the stub renderer");
+    renderer_ = reinterpret_cast<char const*>(glGetString(GL_RENDERER));
+  } catch (...) {
+    if (context != EGL_NO_CONTEXT) eglDestroyContext(display, context);
+    if (display != EGL_NO_DISPLAY) eglTerminate(display);
+    started.set_exception(std::current_exception());
+    return;
+  }
+  started.set_value();
+
+  while (true) {
+    std::function<void()> job;
+    {
+      std::unique_lock lock(mutex_);
+      wake_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+      if (jobs_.empty()) break;
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+    }
+    job();
+  }
+
+  eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  eglDestroyContext(display, context);
+  eglTerminate(display);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+#include "OpenGLAsyncGPUReadbackPluginAPI.hpp"
+
+/**
+ * @brief Stand-in for Unity's render thread, to run the plugin library in benchmarks, soak tests and profilers
+ *
+ * Owns a headless EGL context, loads the plugin against stub Unity interfaces that report an OpenGL core renderer,
+ * installs issue_plugin_event() as its GL.IssuePluginEvent and runs the events it issues in order, like Unity's render
+ * thread does. Graphics device callbacks registered by the plugin receive the shutdown event before it is unloaded.
+ * Only one instance may exist at a time.
+ */
+class HeadlessRenderThread {
+ public:
+  /**
+   * @brief Create the context and load the plugin, throws std::runtime_error if no context can be created
+   */
+  HeadlessRenderThread();
+  HeadlessRenderThread(HeadlessRenderThread const&) = delete;
+  HeadlessRenderThread(HeadlessRenderThread&&) = delete;
+  auto operator=(HeadlessRenderThread const&) = delete;
+  auto operator=(HeadlessRenderThread&&) = delete;
+
+  /**
+   * @brief Runs the queued events, shuts down the graphics device, unloads the plugin and destroys the context
+   */
+  ~HeadlessRenderThread() noexcept;
+
+  /**
+   * @brief GL.IssuePluginEvent replacement to pass to SetGLIssuePluginEventPtr
+   */
+  static void UNITY_INTERFACE_API issue_plugin_event(UnityRenderingEvent event, int event_id);
+
+  /**
+   * @brief Queue a job on the render thread
+   */
+  void submit(std::function<void()> job);
+
+  /**
+   * @brief Run one frame the way Unity does: update the plugin on the calling thread, which stands in for the main
+   * thread, then wait until the render thread has run the events of the frame
+   */
+  void frame();
+
+  /**
+   * @brief Run a job on the render thread and wait for its result
+   */
+  template <class F>
+  auto run(F&& f) -> std::invoke_result_t<F> {
+    auto task = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::forward<F>(f));
+    auto result = task->get_future();
+    submit([task]() { (*task)(); });
+    return result.get();
+  }
+
+  /**
+   * @return GL_RENDERER of the context
+   */
+  [[nodiscard]] auto renderer() const noexcept -> char const* { return renderer_; }
+
+ private:
+  static inline HeadlessRenderThread* current_ = nullptr;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<std::function<void()>> jobs_;
+  bool stopping_ = false;
+  char const* renderer_ = "";
+  std::thread thread_;
+
+  void run_loop(std::promise<void> started);
+};
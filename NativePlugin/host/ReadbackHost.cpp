@@ -0,0 +1,145 @@
+/**
+ * Runs the plugin library through Unity's frame loop without Unity, for profiling (perf, heaptrack) and long running
+ * soak checks on build agents. Each frame submits a number of readbacks, updates the plugin and waits for the render
+ * thread, completed requests are released by the plugin as they would be in a player.
+ *
+ * usage: ReadbackHost [--frames <frames = 600>] [--requests <per frame = 4>]
+ *                     [--texture <RGBA8 edge = 1024> | --buffer <bytes>] [--readback-thread] [--realtime]
+ *                     [--stats-every <frames = 60>] [--debug-messages]
+ */
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string_view>
+#include <thread>
+
+#include "HeadlessRenderThread.hpp"
+
+namespace {
+
+struct Options {
+  long frames = 600;
+  long requests = 4;
+  GLsizei texture_size = 1024;
+  GLsizeiptr buffer_size = 0;
+  bool readback_thread = false;
+  bool realtime = false;
+  long stats_every = 60;
+  bool debug_messages = false;
+};
+
+auto parse(int argc, char** argv) -> Options {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--frames" && has_value) {
+      options.frames = std::strtol(argv[++i], nullptr, 10);
+    } else if (arg == "--requests" && has_value) {
+      options.requests = std::strtol(argv[++i], nullptr, 10);
+    } else if (arg == "--texture" && has_value) {
+      options.texture_size = static_cast<GLsizei>(std::strtol(argv[++i], nullptr, 10));
+      options.buffer_size = 0;
+    } else if (arg == "--buffer" && has_value) {
+      options.buffer_size = static_cast<GLsizeiptr>(std::strtoll(argv[++i], nullptr, 10));
+    } else if (arg == "--readback-thread") {
+      options.readback_thread = true;
+    } else if (arg == "--realtime") {
+      options.realtime = true;
+    } else if (arg == "--stats-every" && has_value) {
+      options.stats_every = std::strtol(argv[++i], nullptr, 10);
+    } else if (arg == "--debug-messages") {
+      options.debug_messages = true;
+    }
+  }
+  return options;
+}
+
+void print_stats(long frame) {
+  PluginStats stats;
+  if (!Plugin_GetStats(&stats)) return;
+  std::printf("frame %6ld: in flight %4" PRIu64 ", completed %8" PRIu64 ", errors %4" PRIu64
+              ", %8.1f req/s, %8.1f MiB/s, p99 %2" PRIu64
+              " frames, staging %8.1f MiB (peak %8.1f), GL objects %4" PRIu64 ", stalled %4" PRIu64 "\n",
+              frame, stats.in_flight, stats.completed, stats.errors, stats.completions_per_second,
+              stats.bytes_per_second / (1 << 20), stats.p99_frames_to_done,
+              static_cast<double>(stats.staging_bytes) / (1 << 20),
+              static_cast<double>(stats.peak_staging_bytes) / (1 << 20),
+              stats.live_pbos + stats.live_fbos + stats.live_fences, stats.stalled_requests);
+}
+
+}  // namespace
+
+auto main(int argc, char** argv) -> int try {
+  Options options = parse(argc, argv);
+  HeadlessRenderThread render_thread;
+  std::printf("renderer: %s\n", render_thread.renderer());
+
+  SetReadbackThreadEnabled(options.readback_thread);
+  Plugin_SetDebugMessageCapture(options.debug_messages);
+  render_thread.frame();
+  std::printf("readback thread %s\n", IsReadbackThreadActive() ? "on" : "off");
+
+  bool use_buffer = options.buffer_size > 0;
+  GLuint source = render_thread.run([&options, use_buffer]() {
+    GLuint name = 0;
+    if (use_buffer) {
+      glGenBuffers(1, &name);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, name);
+      glBufferData(GL_SHADER_STORAGE_BUFFER, options.buffer_size, nullptr, GL_STATIC_DRAW);
+      glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R8, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    } else {
+      glGenTextures(1, &name);
+      glBindTexture(GL_TEXTURE_2D, name);
+      glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, options.texture_size, options.texture_size);
+      glClearTexImage(name, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+      glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    glFinish();
+    return name;
+  });
+
+  constexpr auto kFrameTime = std::chrono::microseconds(16667);
+  auto next_frame = std::chrono::steady_clock::now();
+  for (long frame = 1; frame <= options.frames; ++frame) {
+    for (long i = 0; i < options.requests; ++i) {
+      static_cast<void>(use_buffer ? Request_ComputeBuffer(source, options.buffer_size) : Request_Texture(source, 0));
+    }
+    render_thread.frame();
+
+    if (options.stats_every > 0 && frame % options.stats_every == 0) print_stats(frame);
+    if (options.realtime) {
+      next_frame += kFrameTime;
+      std::this_thread::sleep_until(next_frame);
+    }
+  }
+
+  // let the last requests complete and be released
+  PluginStats stats;
+  for (int i = 0; i < 1000 && Plugin_GetStats(&stats) && stats.in_flight > 0; ++i) render_thread.frame();
+  render_thread.frame();
+  render_thread.frame();
+  print_stats(options.frames);
+  char message[512];
+  for (size_t i = 0; Plugin_GetPerformanceMessage(i, message, sizeof(message)) > 0; ++i) {
+    std::printf("performance message: %s\n", message);
+  }
+  Plugin_SetDebugMessageCapture(false);
+  render_thread.frame();
+
+  render_thread.run([source, use_buffer]() {
+    if (use_buffer) {
+      glDeleteBuffers(1, &source);
+    } else {
+      glDeleteTextures(1, &source);
+    }
+  });
+  return 0;
+} catch (std::exception const& e) {
+  std::fprintf(stderr, "%s\n", e.what());
+  return 1;
+}
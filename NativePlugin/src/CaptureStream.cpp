@@ -0,0 +1,144 @@
+#include "CaptureStream.hpp"
+
+#include <algorithm>
+
+auto StreamSlot::reserve(size_t length) -> void* {
+  if (capacity < length) {
+    data = std::make_unique<char[]>(length);
+    capacity = length;
+  }
+  return data.get();
+}
+
+CaptureStream::CaptureStream(GLuint texture, int miplevel, size_t slots, StreamDropPolicy policy,
+                             std::chrono::nanoseconds block_timeout, RequestOptions const& options)
+    : texture_(texture),
+      miplevel_(miplevel),
+      policy_(policy),
+      // waits are measured from now, which would overflow for "forever"
+      block_timeout_(std::min<std::chrono::nanoseconds>(block_timeout, std::chrono::hours(24))),
+      options_(options) {
+  slots_.resize(std::max<size_t>(slots, 1));
+  for (auto& slot : slots_) slot = std::make_shared<StreamSlot>();
+}
+
+auto CaptureStream::arm() -> std::shared_ptr<StreamSlot> {
+  std::unique_lock lock(mutex_);
+  if (closed_) return nullptr;
+
+  std::shared_ptr<StreamSlot> slot = free_slot();
+  // captures in flight only finish on the render or readback thread, so only a consumer holding every slot is waited on
+  if (slot == nullptr && policy_ == kStreamBlock && find(StreamSlot::State::kInFlight) == nullptr) {
+    released_.wait_for(lock, block_timeout_, [this, &slot]() { return closed_ || (slot = free_slot()) != nullptr; });
+    if (closed_) return nullptr;
+  }
+  if (slot == nullptr && policy_ == kStreamDropOldest) {
+    // the consumer has not acquired the frame yet, so the newer capture takes its place
+    slot = find(StreamSlot::State::kReady);
+  }
+
+  // either the frame in the slot or the new one is lost
+  if (slot == nullptr || slot->state == StreamSlot::State::kReady) ++dropped_;
+  if (slot == nullptr) return nullptr;
+
+  slot->state = StreamSlot::State::kInFlight;
+  slot->sequence = sequence_++;
+  slot->size = 0;
+  return slot;
+}
+
+void CaptureStream::on_captured(StreamSlot& slot, EventId event_id, bool error, size_t size) {
+  std::scoped_lock guard(mutex_);
+  slot.event_id = event_id;
+  if (error) {
+    slot.state = StreamSlot::State::kFree;
+    ++errors_;
+  } else {
+    slot.state = StreamSlot::State::kReady;
+    slot.size = size;
+    ++captured_;
+  }
+}
+
+auto CaptureStream::acquire(StreamFrame& frame) -> bool {
+  std::scoped_lock guard(mutex_);
+  std::shared_ptr<StreamSlot> slot = find(StreamSlot::State::kReady);
+  if (slot == nullptr) return false;
+
+  slot->state = StreamSlot::State::kAcquired;
+  frame = StreamFrame{
+      .data = slot->data.get(),
+      .length = slot->size,
+      .sequence = slot->sequence,
+      .event_id = slot->event_id,
+  };
+  return true;
+}
+
+auto CaptureStream::release(uint64_t sequence) -> bool {
+  {
+    std::scoped_lock guard(mutex_);
+    auto iter = std::find_if(slots_.begin(), slots_.end(), [sequence](auto const& slot) {
+      return slot->state == StreamSlot::State::kAcquired && slot->sequence == sequence;
+    });
+    if (iter == slots_.end()) return false;
+    (*iter)->state = StreamSlot::State::kFree;
+  }
+  released_.notify_all();
+  return true;
+}
+
+void CaptureStream::close() {
+  {
+    std::scoped_lock guard(mutex_);
+    closed_ = true;
+  }
+  released_.notify_all();
+}
+
+auto CaptureStream::is_idle() const -> bool {
+  std::scoped_lock guard(mutex_);
+  return find(StreamSlot::State::kInFlight) == nullptr;
+}
+
+void CaptureStream::take_staging_buffers(std::vector<std::pair<GLuint, GLsizeiptr>>& staging) {
+  std::scoped_lock guard(mutex_);
+  for (auto& slot : slots_) {
+    if (slot->pbo == 0) continue;
+    staging.emplace_back(slot->pbo, slot->staging_size);
+    slot->pbo = 0;
+    slot->staging_size = 0;
+  }
+}
+
+auto CaptureStream::stats() const -> StreamStats {
+  std::scoped_lock guard(mutex_);
+  StreamStats stats{
+      .captured = captured_,
+      .dropped = dropped_,
+      .errors = errors_,
+  };
+  for (auto const& slot : slots_) {
+    if (slot->state == StreamSlot::State::kReady) ++stats.ready;
+    if (slot->state == StreamSlot::State::kInFlight) ++stats.in_flight;
+  }
+  return stats;
+}
+
+auto CaptureStream::find(StreamSlot::State state) const -> std::shared_ptr<StreamSlot> {
+  std::shared_ptr<StreamSlot> oldest = nullptr;
+  for (auto const& slot : slots_) {
+    if (slot->state == state && (oldest == nullptr || slot->sequence < oldest->sequence)) oldest = slot;
+  }
+  return oldest;
+}
+
+auto CaptureStream::free_slot() -> std::shared_ptr<StreamSlot> {
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    size_t index = (next_ + i) % slots_.size();
+    if (slots_[index]->state != StreamSlot::State::kFree) continue;
+    next_ = index + 1;
+    return slots_[index];
+  }
+  return nullptr;
+}
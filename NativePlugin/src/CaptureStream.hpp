@@ -0,0 +1,128 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "OpenGLAsyncGPUReadbackPluginAPI.hpp"
+
+/**
+ * @brief Staging buffer and result storage of one slot of a capture stream, reused by every capture through the slot
+ */
+struct StreamSlot {
+  enum class State {
+    kFree,
+    kInFlight,
+    kReady,
+    kAcquired,
+  };
+
+  /** @brief pixel pack buffer created by the first capture, only used on the GL threads */
+  GLuint pbo = 0;
+  GLsizeiptr staging_size = 0;
+  /** @brief result storage, only written by the capture in flight */
+  std::unique_ptr<char[]> data = nullptr;
+  size_t capacity = 0;
+
+  // guarded by the stream
+  State state = State::kFree;
+  size_t size = 0;
+  uint64_t sequence = 0;
+  EventId event_id = 0;
+
+  /**
+   * @return storage for at least length bytes, only reallocated when the previous captures were smaller
+   */
+  auto reserve(size_t length) -> void*;
+};
+
+/**
+ * @brief Continuous readback of one texture through a fixed ring of slots, armed once per MainThread_UpdateOnce
+ *
+ * A slot is in flight while its capture is read back, ready once the capture is done and acquired while the consumer
+ * holds it. Frames are captured into free slots only; when there is none the drop policy decides whether the oldest
+ * ready frame is overwritten, the new frame is skipped or the main thread waits for the consumer to release one. The
+ * frame is skipped with every policy when the slots are taken by captures still in flight, as the GPU rather than the
+ * consumer is behind then.
+ */
+class CaptureStream {
+ public:
+  CaptureStream(GLuint texture, int miplevel, size_t slots, StreamDropPolicy policy,
+                std::chrono::nanoseconds block_timeout, RequestOptions const& options);
+
+  [[nodiscard]] auto texture() const noexcept -> GLuint { return texture_; }
+  [[nodiscard]] auto miplevel() const noexcept -> int { return miplevel_; }
+  [[nodiscard]] auto options() const noexcept -> RequestOptions const& { return options_; }
+
+  /**
+   * @brief Claim a slot for the capture of the current frame according to the drop policy, called from the main thread
+   * @return slot now in flight, nullptr if the frame is dropped or the stream is closed
+   */
+  [[nodiscard]] auto arm() -> std::shared_ptr<StreamSlot>;
+
+  /**
+   * @brief Make a slot ready once its capture is done, or free again if the capture failed
+   * @param slot slot returned by arm()
+   * @param event_id request that captured the frame
+   * @param error whether the request failed
+   * @param size size in bytes of the captured frame
+   */
+  void on_captured(StreamSlot& slot, EventId event_id, bool error, size_t size);
+
+  /**
+   * @brief Hand the oldest ready frame to the consumer, it stays valid until released or the stream is closed
+   * @return false if no frame is ready
+   */
+  auto acquire(StreamFrame& frame) -> bool;
+
+  /**
+   * @brief Return an acquired frame to the ring
+   * @param sequence sequence number of the frame
+   * @return false if no such frame is acquired
+   */
+  auto release(uint64_t sequence) -> bool;
+
+  /**
+   * @brief Stop arming new captures and wake up a blocked arm()
+   */
+  void close();
+
+  /**
+   * @return true if no capture is in flight, the staging buffers of a closed stream can be deleted then
+   */
+  [[nodiscard]] auto is_idle() const -> bool;
+
+  /**
+   * @brief Move the staging buffers of all slots out of the stream, as pairs of buffer name and size in bytes
+   * @param staging buffers are appended to it
+   */
+  void take_staging_buffers(std::vector<std::pair<GLuint, GLsizeiptr>>& staging);
+
+  [[nodiscard]] auto stats() const -> StreamStats;
+
+ private:
+  GLuint texture_;
+  int miplevel_;
+  StreamDropPolicy policy_;
+  std::chrono::nanoseconds block_timeout_;
+  RequestOptions options_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable released_;
+  std::vector<std::shared_ptr<StreamSlot>> slots_;
+  // slot the next free slot is searched from, so that captures go round the ring
+  size_t next_ = 0;
+  uint64_t sequence_ = 0;
+  bool closed_ = false;
+  uint64_t captured_ = 0;
+  uint64_t dropped_ = 0;
+  uint64_t errors_ = 0;
+
+  /** @return the slot in a state that was armed first, nullptr if there is none */
+  [[nodiscard]] auto find(StreamSlot::State state) const -> std::shared_ptr<StreamSlot>;
+  [[nodiscard]] auto free_slot() -> std::shared_ptr<StreamSlot>;
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+/**
+ * Runtime checks for the instruction sets used by the vectorised pixel kernels. The kernels are compiled for their
+ * instruction set per function with READBACK_TARGET rather than for the whole plugin, so that the plugin still loads
+ * on CPUs without them and falls back to the scalar versions.
+ */
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define READBACK_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+#ifdef READBACK_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+// MSVC accepts the intrinsics of every instruction set without flags
+#define READBACK_TARGET(isa)
+#else
+#define READBACK_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace cpu {
+
+#ifdef READBACK_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+namespace detail {
+/** @brief CPUID leaf 1 ECX bits of AVX, only usable when the OS saves the AVX registers on context switches */
+[[nodiscard]] inline auto has_avx_with(int leaf1_ecx_bit) noexcept -> bool {
+  int info[4] = {};
+  __cpuid(info, 1);
+  return (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6 &&
+         (info[2] & (1 << leaf1_ecx_bit)) != 0;
+}
+}  // namespace detail
+
+/**
+ * @return true if the CPU and OS support AVX2
+ */
+[[nodiscard]] inline auto has_avx2() noexcept -> bool {
+  static bool const supported = []() {
+    int info[4] = {};
+    __cpuidex(info, 7, 0);
+    return detail::has_avx_with(28) && (info[1] & (1 << 5)) != 0;
+  }();
+  return supported;
+}
+
+/**
+ * @return true if the CPU and OS support the F16C half-float conversions
+ */
+[[nodiscard]] inline auto has_f16c() noexcept -> bool {
+  static bool const supported = detail::has_avx_with(29);
+  return supported;
+}
+#else
+/**
+ * @return true if the CPU and OS support AVX2
+ */
+[[nodiscard]] inline auto has_avx2() noexcept -> bool { return __builtin_cpu_supports("avx2") != 0; }
+
+/**
+ * @return true if the CPU and OS support the F16C half-float conversions
+ */
+[[nodiscard]] inline auto has_f16c() noexcept -> bool { return __builtin_cpu_supports("f16c") != 0; }
+#endif
+#else
+[[nodiscard]] constexpr auto has_avx2() noexcept -> bool { return false; }
+[[nodiscard]] constexpr auto has_f16c() noexcept -> bool { return false; }
+#endif
+
+}  // namespace cpu
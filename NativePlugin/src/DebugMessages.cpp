@@ -0,0 +1,54 @@
+#include "DebugMessages.hpp"
+
+auto DebugMessages::install() -> bool {
+  if (installed_) return true;
+  if (glDebugMessageCallback == nullptr || glDebugMessageControl == nullptr) return false;
+
+  void* callback = nullptr;
+  void* user_param = nullptr;
+  glGetPointerv(GL_DEBUG_CALLBACK_FUNCTION, &callback);
+  glGetPointerv(GL_DEBUG_CALLBACK_USER_PARAM, &user_param);
+  previous_callback_ = reinterpret_cast<GLDEBUGPROC>(callback);  // NOLINT: the callback is stored as a void pointer
+  previous_user_param_ = user_param;
+  was_enabled_ = glIsEnabled(GL_DEBUG_OUTPUT);
+
+  glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_PERFORMANCE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+  glDebugMessageCallback(on_message, this);
+  glEnable(GL_DEBUG_OUTPUT);
+  installed_ = true;
+  return true;
+}
+
+void DebugMessages::uninstall() {
+  if (!installed_) return;
+  glDebugMessageCallback(previous_callback_, previous_user_param_);
+  if (was_enabled_ == GL_FALSE) glDisable(GL_DEBUG_OUTPUT);
+  installed_ = false;
+}
+
+auto DebugMessages::message(size_t index, std::string& message) const -> bool {
+  std::scoped_lock guard(mutex_);
+  if (index >= messages_.size()) return false;
+  message = messages_[messages_.size() - 1 - index];
+  return true;
+}
+
+void GLAPIENTRY DebugMessages::on_message(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+                                          GLchar const* message, void const* user_param) {
+  // GL hands the user parameter back as const
+  auto* self = static_cast<DebugMessages*>(const_cast<void*>(user_param));  // NOLINT
+  if (type == GL_DEBUG_TYPE_PERFORMANCE && message != nullptr) {
+    self->stats_.on_performance_message();
+    try {
+      std::scoped_lock guard(self->mutex_);
+      if (self->messages_.size() == kKept) self->messages_.pop_front();
+      self->messages_.emplace_back(message, length < 0 ? std::char_traits<char>::length(message)
+                                                       : static_cast<size_t>(length));
+    } catch (...) {
+      // called from inside the driver, the message is dropped rather than letting anything escape
+    }
+  }
+  if (self->previous_callback_ != nullptr) {
+    self->previous_callback_(source, type, id, severity, length, message, self->previous_user_param_);
+  }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+
+#include "Statistics.hpp"
+
+/**
+ * @brief Captures KHR_debug performance messages of a context, e.g. drivers reporting that a read had to take a slow
+ * path or stall, for Plugin_GetPerformanceMessage
+ *
+ * The callback is installed on the context current on the calling thread and forwards every message to the callback
+ * that was installed before, so that Unity's own debug output keeps working. Install and uninstall have to be called
+ * with the same context current, the callback may be called from any thread.
+ */
+class DebugMessages {
+ public:
+  /** @brief number of most recent messages kept */
+  static constexpr size_t kKept = 32;
+
+  explicit DebugMessages(Statistics& stats) noexcept : stats_(stats) {}
+  DebugMessages(DebugMessages const&) = delete;
+  DebugMessages(DebugMessages&&) = delete;
+  auto operator=(DebugMessages const&) = delete;
+  auto operator=(DebugMessages&&) = delete;
+  ~DebugMessages() = default;
+
+  /**
+   * @brief Install the callback on the current context
+   * @return false if the context does not support KHR_debug
+   */
+  auto install() -> bool;
+
+  /**
+   * @brief Restore the previous callback on the current context
+   */
+  void uninstall();
+
+  [[nodiscard]] auto is_installed() const noexcept -> bool { return installed_; }
+
+  /**
+   * @param index 0 for the most recent message
+   * @param message
+   * @return false if fewer messages were captured
+   */
+  auto message(size_t index, std::string& message) const -> bool;
+
+ private:
+  Statistics& stats_;
+  bool installed_ = false;
+  GLDEBUGPROC previous_callback_ = nullptr;
+  void const* previous_user_param_ = nullptr;
+  GLboolean was_enabled_ = GL_FALSE;
+
+  mutable std::mutex mutex_;
+  std::deque<std::string> messages_;
+
+  static void GLAPIENTRY on_message(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+                                    GLchar const* message, void const* user_param);
+};
@@ -0,0 +1,195 @@
+#include "FloatConverter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "CpuFeatures.hpp"
+
+namespace {
+
+template <class T>
+auto load(void const* src, size_t index) noexcept -> T {
+  T value;
+  std::memcpy(&value, static_cast<unsigned char const*>(src) + index * sizeof(T), sizeof(T));
+  return value;
+}
+
+auto half_to_float(uint16_t half) noexcept -> float {
+  uint32_t sign = static_cast<uint32_t>(half & 0x8000U) << 16U;
+  uint32_t exponent = (half >> 10U) & 0x1fU;
+  uint32_t mantissa = half & 0x3ffU;
+  if (exponent == 0) {
+    // zero or subnormal, exactly representable as a float
+    float value = static_cast<float>(mantissa) * 0x1p-24F;
+    return sign != 0 ? -value : value;
+  }
+  if (exponent == 0x1f) {
+    // infinity or NaN, NaNs are made quiet as F16C does
+    return std::bit_cast<float>(sign | 0x7f800000U | (mantissa << 13U) | (mantissa != 0 ? 0x400000U : 0U));
+  }
+  return std::bit_cast<float>(sign | ((exponent + 127 - 15) << 23U) | (mantissa << 13U));
+}
+
+template <class T>
+constexpr float kNormalizedMax = static_cast<float>(std::numeric_limits<T>::max());
+
+template <class T>
+auto normalized_to_float(T value) noexcept -> float {
+  float result = static_cast<float>(value) / kNormalizedMax<T>;
+  // both the most negative value and the one above it map to -1
+  if constexpr (std::is_signed_v<T>) result = std::max(result, -1.0F);
+  return result;
+}
+
+auto srgb_table() noexcept -> std::array<float, 256> const& {
+  static std::array<float, 256> const table = []() {
+    std::array<float, 256> values{};
+    for (size_t i = 0; i < values.size(); ++i) {
+      double c = static_cast<double>(i) / 255.0;
+      values[i] = static_cast<float>(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+    }
+    return values;
+  }();
+  return table;
+}
+
+template <class Convert>
+void convert_each(size_t begin, size_t count, float* dst, Convert&& convert) noexcept {
+  for (size_t i = begin; i < count; ++i) dst[i] = convert(i);
+}
+
+void convert_scalar(FloatKernel kernel, void const* src, size_t begin, size_t count, int components,
+                    float* dst) noexcept {
+  // the kernel is picked once rather than per component
+  switch (kernel) {
+    case FloatKernel::kHalf:
+      convert_each(begin, count, dst, [src](size_t i) { return half_to_float(load<uint16_t>(src, i)); });
+      break;
+    case FloatKernel::kUnorm8:
+      convert_each(begin, count, dst, [src](size_t i) { return normalized_to_float(load<uint8_t>(src, i)); });
+      break;
+    case FloatKernel::kSnorm8:
+      convert_each(begin, count, dst, [src](size_t i) { return normalized_to_float(load<int8_t>(src, i)); });
+      break;
+    case FloatKernel::kUnorm16:
+      convert_each(begin, count, dst, [src](size_t i) { return normalized_to_float(load<uint16_t>(src, i)); });
+      break;
+    case FloatKernel::kSnorm16:
+      convert_each(begin, count, dst, [src](size_t i) { return normalized_to_float(load<int16_t>(src, i)); });
+      break;
+    case FloatKernel::kSrgb8: {
+      float const* table = srgb_table().data();
+      convert_each(begin, count, dst, [src, table, components](size_t i) {
+        uint8_t value = load<uint8_t>(src, i);
+        return components == 4 && i % 4 == 3 ? normalized_to_float(value) : table[value];
+      });
+      break;
+    }
+    case FloatKernel::kNone: break;
+  }
+}
+
+#ifdef READBACK_X86
+READBACK_TARGET("f16c")
+auto convert_half_f16c(void const* src, size_t count, float* dst) noexcept -> size_t {
+  auto const* halves = static_cast<unsigned char const*>(src);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i packed = _mm_loadu_si128(reinterpret_cast<__m128i const*>(halves + i * 2));
+    _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(packed));
+  }
+  return i;
+}
+
+/** @return 8 components widened to float */
+template <class T>
+READBACK_TARGET("avx2")
+auto widen8(unsigned char const* src) noexcept -> __m256 {
+  if constexpr (sizeof(T) == 1) {
+    __m128i packed = _mm_loadl_epi64(reinterpret_cast<__m128i const*>(src));
+    return _mm256_cvtepi32_ps(std::is_signed_v<T> ? _mm256_cvtepi8_epi32(packed) : _mm256_cvtepu8_epi32(packed));
+  } else {
+    __m128i packed = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src));
+    return _mm256_cvtepi32_ps(std::is_signed_v<T> ? _mm256_cvtepi16_epi32(packed) : _mm256_cvtepu16_epi32(packed));
+  }
+}
+
+template <class T>
+READBACK_TARGET("avx2")
+auto convert_normalized_avx2(void const* src, size_t count, float* dst) noexcept -> size_t {
+  auto const* bytes = static_cast<unsigned char const*>(src);
+  __m256 const scale = _mm256_set1_ps(kNormalizedMax<T>);
+  __m256 const lowest = _mm256_set1_ps(-1.0F);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    // divided rather than multiplied by the reciprocal so that the largest value maps to exactly 1
+    __m256 value = _mm256_div_ps(widen8<T>(bytes + i * sizeof(T)), scale);
+    if constexpr (std::is_signed_v<T>) value = _mm256_max_ps(value, lowest);
+    _mm256_storeu_ps(dst + i, value);
+  }
+  return i;
+}
+
+READBACK_TARGET("avx2")
+auto convert_srgb_avx2(void const* src, size_t count, int components, float* dst) noexcept -> size_t {
+  auto const* bytes = static_cast<unsigned char const*>(src);
+  float const* table = srgb_table().data();
+  __m256 const scale = _mm256_set1_ps(kNormalizedMax<uint8_t>);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(bytes + i)));
+    __m256 value = _mm256_i32gather_ps(table, index, sizeof(float));
+    if (components == 4) {
+      // 8 components are two whole pixels, alpha is the 4th and 8th
+      value = _mm256_blend_ps(value, _mm256_div_ps(_mm256_cvtepi32_ps(index), scale), 0x88);
+    }
+    _mm256_storeu_ps(dst + i, value);
+  }
+  return i;
+}
+
+auto convert_vectorised(FloatKernel kernel, void const* src, size_t count, int components, float* dst) noexcept
+    -> size_t {
+  if (kernel == FloatKernel::kHalf) return cpu::has_f16c() ? convert_half_f16c(src, count, dst) : 0;
+  if (!cpu::has_avx2()) return 0;
+  switch (kernel) {
+    case FloatKernel::kUnorm8: return convert_normalized_avx2<uint8_t>(src, count, dst);
+    case FloatKernel::kSnorm8: return convert_normalized_avx2<int8_t>(src, count, dst);
+    case FloatKernel::kUnorm16: return convert_normalized_avx2<uint16_t>(src, count, dst);
+    case FloatKernel::kSnorm16: return convert_normalized_avx2<int16_t>(src, count, dst);
+    case FloatKernel::kSrgb8: return convert_srgb_avx2(src, count, components, dst);
+    default: return 0;
+  }
+}
+#endif
+
+}  // namespace
+
+auto float_kernel(FloatConversion conversion, PixelLayout const& layout) noexcept -> FloatKernel {
+  if (conversion == kFloatNone || !layout.is_valid() || !layout.normalized) return FloatKernel::kNone;
+  switch (layout.type) {
+    case GL_HALF_FLOAT: return FloatKernel::kHalf;
+    case GL_UNSIGNED_BYTE:
+      return layout.srgb || conversion == kFloatDecodeSrgb ? FloatKernel::kSrgb8 : FloatKernel::kUnorm8;
+    case GL_BYTE: return FloatKernel::kSnorm8;
+    case GL_UNSIGNED_SHORT: return FloatKernel::kUnorm16;
+    case GL_SHORT: return FloatKernel::kSnorm16;
+    default: return FloatKernel::kNone;
+  }
+}
+
+void convert_to_float(FloatKernel kernel, void const* src, size_t count, int components, float* dst,
+                      bool vectorised) noexcept {
+  size_t converted = 0;
+#ifdef READBACK_X86
+  if (vectorised) converted = convert_vectorised(kernel, src, count, components, dst);
+#endif
+  static_cast<void>(vectorised);
+  convert_scalar(kernel, src, converted, count, components, dst);
+}
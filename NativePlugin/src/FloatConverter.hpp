@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+
+#include "OpenGLAsyncGPUReadbackPluginAPI.hpp"
+#include "PostProcess.hpp"
+
+/**
+ * @brief Source components of a conversion to float
+ */
+enum class FloatKernel {
+  kNone,
+  kHalf,
+  kUnorm8,
+  kSnorm8,
+  kUnorm16,
+  kSnorm16,
+  /** @brief 8-bit colour components decoded from sRGB, every 4th component is linear alpha */
+  kSrgb8,
+};
+
+/**
+ * @return kernel converting the components of layout, kNone if they are already floats or are not normalized
+ */
+[[nodiscard]] auto float_kernel(FloatConversion conversion, PixelLayout const& layout) noexcept -> FloatKernel;
+
+/**
+ * @brief Convert components to float, halves exactly and normalized integers as divided by their largest value, sRGB
+ * through a table of the 256 decoded values. Components are converted 8 at a time where the CPU supports it, halves
+ * with F16C and the rest with AVX2, which gathers sRGB values from the table
+ * @param kernel source components, kNone does nothing
+ * @param src count components
+ * @param count number of components
+ * @param components number of components per pixel, used to find alpha for kSrgb8
+ * @param dst count floats
+ * @param vectorised false forces the scalar code, which gives the same results
+ */
+void convert_to_float(FloatKernel kernel, void const* src, size_t count, int components, float* dst,
+                      bool vectorised = true) noexcept;
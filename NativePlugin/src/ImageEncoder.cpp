@@ -0,0 +1,723 @@
+#include "ImageEncoder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+namespace {
+
+using Bytes = std::vector<unsigned char>;
+
+void put_u16_be(Bytes& out, uint32_t value) {
+  out.push_back(static_cast<unsigned char>(value >> 8U));
+  out.push_back(static_cast<unsigned char>(value));
+}
+
+void put_u32_be(Bytes& out, uint32_t value) {
+  put_u16_be(out, value >> 16U);
+  put_u16_be(out, value & 0xFFFFU);
+}
+
+auto read32(unsigned char const* p) noexcept -> uint32_t {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+struct Rgba {
+  unsigned char r, g, b, a;
+
+  [[nodiscard]] auto packed() const noexcept -> uint32_t {
+    return static_cast<uint32_t>(r) << 24U | static_cast<uint32_t>(g) << 16U | static_cast<uint32_t>(b) << 8U | a;
+  }
+};
+
+/**
+ * @brief Read a pixel of a view, see ImageView::components for how the formats map to RGBA
+ */
+auto load(unsigned char const* p, int components) noexcept -> Rgba {
+  switch (components) {
+    case 1: return {p[0], p[0], p[0], 255};
+    case 2: return {p[0], p[1], 0, 255};
+    case 3: return {p[0], p[1], p[2], 255};
+    default: return {p[0], p[1], p[2], p[3]};
+  }
+}
+
+// QOI, https://qoiformat.org/qoi-specification.pdf
+
+constexpr unsigned char kQoiIndex = 0x00;
+constexpr unsigned char kQoiDiff = 0x40;
+constexpr unsigned char kQoiLuma = 0x80;
+constexpr unsigned char kQoiRun = 0xC0;
+constexpr unsigned char kQoiRgb = 0xFE;
+constexpr unsigned char kQoiRgba = 0xFF;
+constexpr int kQoiMaxRun = 62;
+
+void encode_qoi(ImageView const& image, Bytes& out) {
+  int channels = image.components == 4 ? 4 : 3;
+  out.reserve(static_cast<size_t>(image.width) * image.height * channels / 2 + 22);
+  out.insert(out.end(), {'q', 'o', 'i', 'f'});
+  put_u32_be(out, static_cast<uint32_t>(image.width));
+  put_u32_be(out, static_cast<uint32_t>(image.height));
+  out.push_back(static_cast<unsigned char>(channels));
+  // sRGB with linear alpha
+  out.push_back(0);
+
+  std::array<Rgba, 64> index{};
+  Rgba previous{0, 0, 0, 255};
+  int run = 0;
+  for (int y = 0; y < image.height; ++y) {
+    unsigned char const* row = image.row(y);
+    for (int x = 0; x < image.width; ++x) {
+      Rgba pixel = load(row + static_cast<size_t>(x) * image.components, image.components);
+      if (pixel.packed() == previous.packed()) {
+        if (++run == kQoiMaxRun) {
+          out.push_back(static_cast<unsigned char>(kQoiRun | (run - 1)));
+          run = 0;
+        }
+        continue;
+      }
+      if (run > 0) {
+        out.push_back(static_cast<unsigned char>(kQoiRun | (run - 1)));
+        run = 0;
+      }
+
+      auto slot = static_cast<unsigned char>((pixel.r * 3 + pixel.g * 5 + pixel.b * 7 + pixel.a * 11) % 64);
+      if (index[slot].packed() == pixel.packed()) {
+        out.push_back(kQoiIndex | slot);
+      } else if (index[slot] = pixel; pixel.a == previous.a) {
+        auto dr = static_cast<signed char>(pixel.r - previous.r);
+        auto dg = static_cast<signed char>(pixel.g - previous.g);
+        auto db = static_cast<signed char>(pixel.b - previous.b);
+        int dr_dg = dr - dg;
+        int db_dg = db - dg;
+        if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+          out.push_back(static_cast<unsigned char>(kQoiDiff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+        } else if (dr_dg >= -8 && dr_dg <= 7 && dg >= -32 && dg <= 31 && db_dg >= -8 && db_dg <= 7) {
+          out.push_back(static_cast<unsigned char>(kQoiLuma | (dg + 32)));
+          out.push_back(static_cast<unsigned char>((dr_dg + 8) << 4 | (db_dg + 8)));
+        } else {
+          out.insert(out.end(), {kQoiRgb, pixel.r, pixel.g, pixel.b});
+        }
+      } else {
+        out.insert(out.end(), {kQoiRgba, pixel.r, pixel.g, pixel.b, pixel.a});
+      }
+      previous = pixel;
+    }
+  }
+  if (run > 0) out.push_back(static_cast<unsigned char>(kQoiRun | (run - 1)));
+  out.insert(out.end(), {0, 0, 0, 0, 0, 0, 0, 1});
+}
+
+// PNG with a single fixed Huffman deflate block, compresses worse than zlib but needs no dependency and a single pass
+
+constexpr auto kCrcTable = [] {
+  std::array<uint32_t, 256> table{};
+  for (uint32_t n = 0; n < table.size(); ++n) {
+    uint32_t c = n;
+    for (int k = 0; k < 8; ++k) c = (c & 1U) != 0 ? 0xEDB88320U ^ (c >> 1U) : c >> 1U;
+    table[n] = c;
+  }
+  return table;
+}();
+
+auto crc32(unsigned char const* data, size_t length) noexcept -> uint32_t {
+  uint32_t crc = 0xFFFFFFFFU;
+  for (size_t i = 0; i < length; ++i) crc = kCrcTable[(crc ^ data[i]) & 0xFFU] ^ (crc >> 8U);
+  return crc ^ 0xFFFFFFFFU;
+}
+
+auto adler32(unsigned char const* data, size_t length) noexcept -> uint32_t {
+  constexpr uint32_t kModulus = 65521;
+  // largest number of bytes before the sums can overflow
+  constexpr size_t kBlock = 5552;
+  uint32_t a = 1;
+  uint32_t b = 0;
+  while (length > 0) {
+    size_t count = std::min(length, kBlock);
+    length -= count;
+    for (size_t i = 0; i < count; ++i) {
+      a += *data++;
+      b += a;
+    }
+    a %= kModulus;
+    b %= kModulus;
+  }
+  return b << 16U | a;
+}
+
+/**
+ * @brief Deflate bit stream, packed starting from the least significant bit
+ */
+class DeflateWriter {
+ public:
+  explicit DeflateWriter(Bytes& out) noexcept : out_(out) {}
+
+  void put(uint32_t value, int length) {
+    bits_ |= static_cast<uint64_t>(value) << count_;
+    count_ += length;
+    while (count_ >= 8) {
+      out_.push_back(static_cast<unsigned char>(bits_));
+      bits_ >>= 8U;
+      count_ -= 8;
+    }
+  }
+
+  void flush() {
+    if (count_ > 0) out_.push_back(static_cast<unsigned char>(bits_));
+    bits_ = 0;
+    count_ = 0;
+  }
+
+ private:
+  Bytes& out_;
+  uint64_t bits_ = 0;
+  int count_ = 0;
+};
+
+struct Code {
+  uint16_t bits;
+  uint8_t length;
+};
+
+/**
+ * @brief Huffman codes are sent starting from their most significant bit
+ */
+constexpr auto reversed(uint32_t code, int length) noexcept -> uint16_t {
+  uint32_t result = 0;
+  for (int i = 0; i < length; ++i, code >>= 1U) result = result << 1U | (code & 1U);
+  return static_cast<uint16_t>(result);
+}
+
+constexpr auto kFixedLiteralCodes = [] {
+  std::array<Code, 288> codes{};
+  for (uint32_t symbol = 0; symbol < codes.size(); ++symbol) {
+    if (symbol < 144) {
+      codes[symbol] = {reversed(0x30 + symbol, 8), 8};
+    } else if (symbol < 256) {
+      codes[symbol] = {reversed(0x190 + symbol - 144, 9), 9};
+    } else if (symbol < 280) {
+      codes[symbol] = {reversed(symbol - 256, 7), 7};
+    } else {
+      codes[symbol] = {reversed(0xC0 + symbol - 280, 8), 8};
+    }
+  }
+  return codes;
+}();
+
+constexpr unsigned kEndOfBlock = 256;
+constexpr size_t kMinMatch = 4;
+constexpr size_t kMaxMatch = 258;
+constexpr size_t kWindow = 32768;
+constexpr int kHashBits = 15;
+
+void put_symbol(DeflateWriter& writer, unsigned symbol) {
+  writer.put(kFixedLiteralCodes[symbol].bits, kFixedLiteralCodes[symbol].length);
+}
+
+void put_match(DeflateWriter& writer, size_t length, size_t distance) {
+  // length codes 257-284 cover 3-257 in groups of 4 codes that double in size, 285 is 258
+  auto n = static_cast<unsigned>(length - 3);
+  if (length == kMaxMatch) {
+    put_symbol(writer, 285);
+  } else if (n < 8) {
+    put_symbol(writer, 257 + n);
+  } else {
+    int shift = std::bit_width(n) - 3;
+    unsigned top = (n >> static_cast<unsigned>(shift)) & 3U;
+    put_symbol(writer, 257 + 4 * static_cast<unsigned>(shift + 1) + top);
+    writer.put(n - ((4U | top) << static_cast<unsigned>(shift)), shift);
+  }
+
+  // distance codes come in pairs that double in size, with 5 bit fixed codes
+  auto d = static_cast<unsigned>(distance - 1);
+  if (d < 4) {
+    writer.put(reversed(d, 5), 5);
+  } else {
+    int shift = std::bit_width(d) - 2;
+    unsigned top = (d >> static_cast<unsigned>(shift)) & 1U;
+    writer.put(reversed(2 * static_cast<unsigned>(shift + 1) + top, 5), 5);
+    writer.put(d - ((2U | top) << static_cast<unsigned>(shift)), shift);
+  }
+}
+
+/**
+ * @brief Append a zlib stream, greedy matching against the last occurrence of each 4 byte sequence
+ */
+void deflate(unsigned char const* data, size_t size, Bytes& out) {
+  // 32K window, no preset dictionary, fastest compression
+  out.insert(out.end(), {0x78, 0x01});
+  DeflateWriter writer(out);
+  // final block with fixed codes
+  writer.put(1, 1);
+  writer.put(1, 2);
+
+  // positions + 1 so that 0 means empty
+  std::vector<uint32_t> head(size_t{1} << kHashBits, 0);
+  auto hash = [](uint32_t value) noexcept { return (value * 2654435761U) >> (32 - kHashBits); };
+  size_t i = 0;
+  while (i < size) {
+    if (i + kMinMatch <= size) {
+      uint32_t value = read32(data + i);
+      uint32_t& slot = head[hash(value)];
+      size_t candidate = slot;
+      slot = static_cast<uint32_t>(i + 1);
+      if (candidate != 0 && i - (candidate - 1) <= kWindow && read32(data + candidate - 1) == value) {
+        size_t from = candidate - 1;
+        size_t limit = std::min(kMaxMatch, size - i);
+        size_t length = kMinMatch;
+        while (length < limit && data[from + length] == data[i + length]) ++length;
+        put_match(writer, length, i - from);
+
+        // later data can refer to anywhere inside the match
+        size_t end = i + length;
+        for (++i; i < end && i + kMinMatch <= size; ++i) head[hash(read32(data + i))] = static_cast<uint32_t>(i + 1);
+        i = end;
+        continue;
+      }
+    }
+    put_symbol(writer, data[i++]);
+  }
+  put_symbol(writer, kEndOfBlock);
+  writer.flush();
+  put_u32_be(out, adler32(data, size));
+}
+
+void begin_chunk(Bytes& out, char const (&type)[5]) {
+  // length is filled in by end_chunk
+  put_u32_be(out, 0);
+  out.insert(out.end(), type, type + 4);
+}
+
+void end_chunk(Bytes& out, size_t start) {
+  size_t length = out.size() - start - 8;
+  for (int i = 0; i < 4; ++i) out[start + i] = static_cast<unsigned char>(length >> (24U - 8U * i));
+  put_u32_be(out, crc32(out.data() + start + 4, length + 4));
+}
+
+auto paeth(int a, int b, int c) noexcept -> int {
+  int p = a + b - c;
+  int pa = std::abs(p - a);
+  int pb = std::abs(p - b);
+  int pc = std::abs(p - c);
+  if (pa <= pb && pa <= pc) return a;
+  return pb <= pc ? b : c;
+}
+
+void encode_png(ImageView const& image, Bytes& out) {
+  int channels = image.components == 1 ? 1 : image.components == 4 ? 4 : 3;
+  auto row_size = static_cast<size_t>(image.width) * channels;
+
+  // every row with the Paeth filter, which suits rendered images best on average
+  constexpr unsigned char kPaethFilter = 4;
+  Bytes filtered((row_size + 1) * image.height);
+  Bytes previous(row_size, 0);
+  Bytes current(row_size);
+  for (int y = 0; y < image.height; ++y) {
+    unsigned char const* row = image.row(y);
+    if (image.components == channels) {
+      std::memcpy(current.data(), row, row_size);
+    } else {
+      for (int x = 0; x < image.width; ++x) {
+        Rgba pixel = load(row + static_cast<size_t>(x) * image.components, image.components);
+        std::memcpy(current.data() + static_cast<size_t>(x) * channels, &pixel, channels);
+      }
+    }
+
+    unsigned char* dst = filtered.data() + (row_size + 1) * y;
+    *dst++ = kPaethFilter;
+    for (size_t i = 0; i < row_size; ++i) {
+      int left = i >= static_cast<size_t>(channels) ? current[i - channels] : 0;
+      int up_left = i >= static_cast<size_t>(channels) ? previous[i - channels] : 0;
+      dst[i] = static_cast<unsigned char>(current[i] - paeth(left, previous[i], up_left));
+    }
+    previous.swap(current);
+  }
+
+  out.insert(out.end(), {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'});
+  size_t start = out.size();
+  begin_chunk(out, "IHDR");
+  put_u32_be(out, static_cast<uint32_t>(image.width));
+  put_u32_be(out, static_cast<uint32_t>(image.height));
+  // 8 bits, grey, RGB or RGBA, default compression, filtering and no interlacing
+  unsigned char color_type = channels == 1 ? 0 : channels == 3 ? 2 : 6;
+  out.insert(out.end(), {8, color_type, 0, 0, 0});
+  end_chunk(out, start);
+
+  start = out.size();
+  begin_chunk(out, "IDAT");
+  deflate(filtered.data(), filtered.size(), out);
+  end_chunk(out, start);
+
+  start = out.size();
+  begin_chunk(out, "IEND");
+  end_chunk(out, start);
+}
+
+// baseline JPEG with the tables of the specification's annex K, 4:2:0 chroma subsampling
+
+/** @brief position of each coefficient of a block in zigzag order */
+constexpr std::array<uint8_t, 64> kZigZag = {
+    0,  1,  5,  6,  14, 15, 27, 28, 2,  4,  7,  13, 16, 26, 29, 42, 3,  8,  12, 17, 25, 30, 41, 43, 9,  11, 18, 24,
+    31, 40, 44, 53, 10, 19, 23, 32, 39, 45, 52, 54, 20, 22, 33, 38, 46, 51, 55, 60, 21, 34, 37, 47, 50, 56, 59, 61,
+    35, 36, 48, 49, 57, 58, 62, 63,
+};
+
+constexpr std::array<uint8_t, 64> kLuminanceQuantization = {
+    16, 11, 10, 16, 24,  40,  51,  61,  12, 12, 14, 19, 26,  58,  60,  55,  14, 13, 16, 24,  40,  57,
+    69, 56, 14, 17, 22,  29,  51,  87,  80, 62, 18, 22, 37,  56,  68,  109, 103, 77, 24, 35, 55,  64,
+    81, 104, 113, 92, 49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95,  98,  112, 100, 103, 99,
+};
+
+constexpr std::array<uint8_t, 64> kChrominanceQuantization = {
+    17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99, 24, 26, 56, 99, 99, 99,
+    99, 99, 47, 66, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+};
+
+/**
+ * @brief Huffman table as stored in a DHT segment: number of codes of each length from 1 to 16, then the symbols
+ */
+struct HuffmanSpec {
+  std::array<uint8_t, 16> counts;
+  std::vector<uint8_t> symbols;
+};
+
+HuffmanSpec const kLuminanceDc = {{0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0},
+                                  {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11}};
+HuffmanSpec const kChrominanceDc = {{0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0},
+                                    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11}};
+HuffmanSpec const kLuminanceAc = {
+    {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7D},
+    {0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71,
+     0x14, 0x32, 0x81, 0x91, 0xA1, 0x08, 0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0, 0x24, 0x33, 0x62, 0x72,
+     0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x34, 0x35, 0x36, 0x37,
+     0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+     0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x83,
+     0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3,
+     0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3,
+     0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2,
+     0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA}};
+HuffmanSpec const kChrominanceAc = {
+    {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77},
+    {0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13, 0x22,
+     0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0, 0x15, 0x62, 0x72, 0xD1,
+     0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25, 0xF1, 0x17, 0x18, 0x19, 0x1A, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x35, 0x36,
+     0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
+     0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A,
+     0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A,
+     0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA,
+     0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA,
+     0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA}};
+
+/**
+ * @brief Canonical codes of a HuffmanSpec by symbol
+ */
+struct HuffmanTable {
+  std::array<Code, 256> codes{};
+
+  explicit HuffmanTable(HuffmanSpec const& spec) noexcept {
+    uint32_t code = 0;
+    size_t symbol = 0;
+    for (int length = 1; length <= 16; ++length, code <<= 1U) {
+      for (int i = 0; i < spec.counts[length - 1]; ++i) {
+        codes[spec.symbols[symbol++]] = {static_cast<uint16_t>(code++), static_cast<uint8_t>(length)};
+      }
+    }
+  }
+};
+
+/**
+ * @brief Entropy coded segment bit stream, packed starting from the most significant bit with 0xFF bytes stuffed
+ */
+class JpegWriter {
+ public:
+  explicit JpegWriter(Bytes& out) noexcept : out_(out) {}
+
+  void put(uint32_t value, int length) {
+    count_ += length;
+    bits_ |= (value & ((1U << static_cast<unsigned>(length)) - 1U)) << static_cast<unsigned>(24 - count_);
+    while (count_ >= 8) {
+      auto byte = static_cast<unsigned char>(bits_ >> 16U);
+      out_.push_back(byte);
+      if (byte == 0xFF) out_.push_back(0);
+      bits_ <<= 8U;
+      count_ -= 8;
+    }
+  }
+
+  void put(Code code) { put(code.bits, code.length); }
+
+  /**
+   * @brief Pad the last byte with 1 bits
+   */
+  void flush() { put(0x7F, 7); }
+
+ private:
+  Bytes& out_;
+  uint32_t bits_ = 0;
+  int count_ = 0;
+};
+
+/**
+ * @brief Scaled 8 point forward DCT of Arai, Agui and Nakajima, the output scale factors are folded into quantization
+ */
+void fdct(float* d, size_t step) noexcept {
+  float tmp0 = d[0] + d[7 * step];
+  float tmp7 = d[0] - d[7 * step];
+  float tmp1 = d[step] + d[6 * step];
+  float tmp6 = d[step] - d[6 * step];
+  float tmp2 = d[2 * step] + d[5 * step];
+  float tmp5 = d[2 * step] - d[5 * step];
+  float tmp3 = d[3 * step] + d[4 * step];
+  float tmp4 = d[3 * step] - d[4 * step];
+
+  // even part
+  float tmp10 = tmp0 + tmp3;
+  float tmp13 = tmp0 - tmp3;
+  float tmp11 = tmp1 + tmp2;
+  float tmp12 = tmp1 - tmp2;
+  d[0] = tmp10 + tmp11;
+  d[4 * step] = tmp10 - tmp11;
+  float z1 = (tmp12 + tmp13) * 0.707106781F;
+  d[2 * step] = tmp13 + z1;
+  d[6 * step] = tmp13 - z1;
+
+  // odd part
+  tmp10 = tmp4 + tmp5;
+  tmp11 = tmp5 + tmp6;
+  tmp12 = tmp6 + tmp7;
+  float z5 = (tmp10 - tmp12) * 0.382683433F;
+  float z2 = tmp10 * 0.541196100F + z5;
+  float z4 = tmp12 * 1.306562965F + z5;
+  float z3 = tmp11 * 0.707106781F;
+  float z11 = tmp7 + z3;
+  float z13 = tmp7 - z3;
+  d[5 * step] = z13 + z2;
+  d[3 * step] = z13 - z2;
+  d[step] = z11 + z4;
+  d[7 * step] = z11 - z4;
+}
+
+struct Quantization {
+  /** @brief quantizer values in zigzag order, as stored in the DQT segment */
+  std::array<uint8_t, 64> table{};
+  /** @brief reciprocal of the quantizer and DCT scale of each coefficient in natural order */
+  std::array<float, 64> scale{};
+
+  Quantization(std::array<uint8_t, 64> const& base, int quality) noexcept {
+    constexpr std::array<float, 8> kDctScale = {1.0F,         1.387039845F, 1.306562965F, 1.175875602F,
+                                                1.0F,         0.785694958F, 0.541196100F, 0.275899379F};
+    int factor = quality < 50 ? 5000 / quality : 200 - 2 * quality;
+    for (size_t i = 0; i < 64; ++i) {
+      table[kZigZag[i]] = static_cast<uint8_t>(std::clamp((base[i] * factor + 50) / 100, 1, 255));
+    }
+    for (size_t row = 0; row < 8; ++row) {
+      for (size_t col = 0; col < 8; ++col) {
+        size_t i = row * 8 + col;
+        scale[i] = 1.0F / (static_cast<float>(table[kZigZag[i]]) * kDctScale[row] * kDctScale[col] * 8.0F);
+      }
+    }
+  }
+};
+
+/**
+ * @brief Transform, quantize and entropy code a block of level shifted samples in natural order
+ * @return quantized DC coefficient, predicts the next block of the component
+ */
+auto encode_block(JpegWriter& writer, std::array<float, 64>& block, Quantization const& quantization, int previous_dc,
+                  HuffmanTable const& dc, HuffmanTable const& ac) -> int {
+  for (size_t row = 0; row < 8; ++row) fdct(block.data() + row * 8, 1);
+  for (size_t col = 0; col < 8; ++col) fdct(block.data() + col, 8);
+
+  std::array<int, 64> coefficients;
+  for (size_t i = 0; i < 64; ++i) {
+    coefficients[kZigZag[i]] = static_cast<int>(std::lround(block[i] * quantization.scale[i]));
+  }
+
+  // values are sent as their magnitude category followed by that many bits, one less for negative values
+  auto put_value = [&writer](int value) {
+    auto magnitude = static_cast<unsigned>(std::abs(value));
+    int length = std::bit_width(magnitude);
+    writer.put(static_cast<uint32_t>(value < 0 ? value - 1 : value), length);
+    return length;
+  };
+
+  int diff = coefficients[0] - previous_dc;
+  writer.put(dc.codes[std::bit_width(static_cast<unsigned>(std::abs(diff)))]);
+  put_value(diff);
+
+  int last = 63;
+  while (last > 0 && coefficients[last] == 0) --last;
+  int zeros = 0;
+  for (int i = 1; i <= last; ++i) {
+    if (coefficients[i] == 0) {
+      ++zeros;
+      continue;
+    }
+    for (; zeros >= 16; zeros -= 16) writer.put(ac.codes[0xF0]);
+    auto length = static_cast<unsigned>(std::bit_width(static_cast<unsigned>(std::abs(coefficients[i]))));
+    writer.put(ac.codes[static_cast<unsigned>(zeros) << 4U | length]);
+    put_value(coefficients[i]);
+    zeros = 0;
+  }
+  if (last < 63) writer.put(ac.codes[0x00]);
+  return coefficients[0];
+}
+
+void put_segment(Bytes& out, unsigned char marker, size_t length) {
+  out.insert(out.end(), {0xFF, marker});
+  put_u16_be(out, static_cast<uint32_t>(length + 2));
+}
+
+void put_huffman_table(Bytes& out, unsigned char table_class_and_id, HuffmanSpec const& spec) {
+  out.push_back(table_class_and_id);
+  out.insert(out.end(), spec.counts.begin(), spec.counts.end());
+  out.insert(out.end(), spec.symbols.begin(), spec.symbols.end());
+}
+
+void encode_jpeg(ImageView const& image, int quality, Bytes& out) {
+  bool grey = image.components == 1;
+  Quantization luminance(kLuminanceQuantization, quality);
+  Quantization chrominance(kChrominanceQuantization, quality);
+  HuffmanTable const luminance_dc(kLuminanceDc);
+  HuffmanTable const luminance_ac(kLuminanceAc);
+  HuffmanTable const chrominance_dc(kChrominanceDc);
+  HuffmanTable const chrominance_ac(kChrominanceAc);
+  int components = grey ? 1 : 3;
+
+  out.reserve(static_cast<size_t>(image.width) * image.height / 4 + 1024);
+  out.insert(out.end(), {0xFF, 0xD8});
+  // JFIF 1.1, no density or thumbnail
+  put_segment(out, 0xE0, 14);
+  out.insert(out.end(), {'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0});
+
+  put_segment(out, 0xDB, grey ? 65 : 130);
+  out.push_back(0);
+  out.insert(out.end(), luminance.table.begin(), luminance.table.end());
+  if (!grey) {
+    out.push_back(1);
+    out.insert(out.end(), chrominance.table.begin(), chrominance.table.end());
+  }
+
+  put_segment(out, 0xC0, 6 + 3 * static_cast<size_t>(components));
+  out.push_back(8);
+  put_u16_be(out, static_cast<uint32_t>(image.height));
+  put_u16_be(out, static_cast<uint32_t>(image.width));
+  out.push_back(static_cast<unsigned char>(components));
+  if (grey) {
+    out.insert(out.end(), {1, 0x11, 0});
+  } else {
+    // luma at twice the chroma resolution in both directions
+    out.insert(out.end(), {1, 0x22, 0, 2, 0x11, 1, 3, 0x11, 1});
+  }
+
+  auto table_size = [](HuffmanSpec const& spec) { return 17 + spec.symbols.size(); };
+  put_segment(out, 0xC4,
+              table_size(kLuminanceDc) + table_size(kLuminanceAc) +
+                  (grey ? 0 : table_size(kChrominanceDc) + table_size(kChrominanceAc)));
+  put_huffman_table(out, 0x00, kLuminanceDc);
+  put_huffman_table(out, 0x10, kLuminanceAc);
+  if (!grey) {
+    put_huffman_table(out, 0x01, kChrominanceDc);
+    put_huffman_table(out, 0x11, kChrominanceAc);
+  }
+
+  put_segment(out, 0xDA, 4 + 2 * static_cast<size_t>(components));
+  out.push_back(static_cast<unsigned char>(components));
+  if (grey) {
+    out.insert(out.end(), {1, 0x00});
+  } else {
+    out.insert(out.end(), {1, 0x00, 2, 0x11, 3, 0x11});
+  }
+  out.insert(out.end(), {0, 63, 0});
+
+  JpegWriter writer(out);
+  // samples past the edges repeat the last row and column
+  auto pixel = [&image](int x, int y) {
+    return load(image.row(std::min(y, image.height - 1)) + static_cast<size_t>(std::min(x, image.width - 1)) *
+                                                                image.components,
+                image.components);
+  };
+
+  std::array<float, 64> block{};
+  if (grey) {
+    int dc = 0;
+    for (int y0 = 0; y0 < image.height; y0 += 8) {
+      for (int x0 = 0; x0 < image.width; x0 += 8) {
+        for (int i = 0; i < 64; ++i) block[i] = static_cast<float>(pixel(x0 + i % 8, y0 + i / 8).r) - 128.0F;
+        dc = encode_block(writer, block, luminance, dc, luminance_dc, luminance_ac);
+      }
+    }
+  } else {
+    std::array<std::array<float, 64>, 4> y_blocks{};
+    std::array<float, 64> cb{};
+    std::array<float, 64> cr{};
+    int y_dc = 0;
+    int cb_dc = 0;
+    int cr_dc = 0;
+    for (int y0 = 0; y0 < image.height; y0 += 16) {
+      for (int x0 = 0; x0 < image.width; x0 += 16) {
+        cb.fill(0.0F);
+        cr.fill(0.0F);
+        for (int y = 0; y < 16; ++y) {
+          for (int x = 0; x < 16; ++x) {
+            Rgba p = pixel(x0 + x, y0 + y);
+            auto r = static_cast<float>(p.r);
+            auto g = static_cast<float>(p.g);
+            auto b = static_cast<float>(p.b);
+            y_blocks[(y / 8) * 2 + x / 8][(y % 8) * 8 + x % 8] = 0.299F * r + 0.587F * g + 0.114F * b - 128.0F;
+            // averaged over 2x2 pixels
+            size_t i = (y / 2) * 8 + x / 2;
+            cb[i] += (-0.168736F * r - 0.331264F * g + 0.5F * b) * 0.25F;
+            cr[i] += (0.5F * r - 0.418688F * g - 0.081312F * b) * 0.25F;
+          }
+        }
+        for (auto& y_block : y_blocks) {
+          y_dc = encode_block(writer, y_block, luminance, y_dc, luminance_dc, luminance_ac);
+        }
+        cb_dc = encode_block(writer, cb, chrominance, cb_dc, chrominance_dc, chrominance_ac);
+        cr_dc = encode_block(writer, cr, chrominance, cr_dc, chrominance_dc, chrominance_ac);
+      }
+    }
+  }
+  writer.flush();
+  out.insert(out.end(), {0xFF, 0xD9});
+}
+
+}  // namespace
+
+auto encode_image(ImageEncoding encoding, ImageView const& image, int quality, std::vector<unsigned char>& out)
+    -> bool {
+  out.clear();
+  if (image.top == nullptr || image.width <= 0 || image.height <= 0 || image.components < 1 || image.components > 4) {
+    return false;
+  }
+
+  switch (encoding) {
+    case kEncodingQoi: encode_qoi(image, out); return true;
+    case kEncodingPng: encode_png(image, out); return true;
+    case kEncodingJpeg: {
+      constexpr int kMaxJpegSize = 65535;
+      if (image.width > kMaxJpegSize || image.height > kMaxJpegSize) return false;
+      encode_jpeg(image, quality == 0 ? kDefaultJpegQuality : std::clamp(quality, 1, 100), out);
+      return true;
+    }
+    default: return false;
+  }
+}
+
+auto encoding_from_extension(std::filesystem::path const& path) -> ImageEncoding {
+  std::string extension = path.extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  if (extension == ".qoi") return kEncodingQoi;
+  if (extension == ".png") return kEncodingPng;
+  if (extension == ".jpg" || extension == ".jpeg") return kEncodingJpeg;
+  return kEncodingNone;
+}
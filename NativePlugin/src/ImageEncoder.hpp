@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "OpenGLAsyncGPUReadbackPluginAPI.hpp"
+
+/**
+ * @brief Rows of 8-bit pixels in the order they are displayed
+ */
+struct ImageView {
+  /** @brief first byte of the top row */
+  unsigned char const* top = nullptr;
+  /** @brief offset in bytes from one row to the one below, negative for bottom-up data such as glReadPixels output */
+  ptrdiff_t stride = 0;
+  int width = 0;
+  int height = 0;
+  /** @brief 1 is encoded as grey, 2 as RGB with blue set to 0, 3 as RGB and 4 as RGBA */
+  int components = 0;
+
+  [[nodiscard]] auto row(int y) const noexcept -> unsigned char const* { return top + y * stride; }
+};
+
+/**
+ * @brief Encode an image, JPEG drops the alpha channel
+ * @param encoding image format, kEncodingNone fails
+ * @param image pixels to encode
+ * @param quality JPEG quality from 1 to 100, 0 picks kDefaultJpegQuality, ignored by the lossless formats
+ * @param out replaced by the encoded file contents
+ * @return false if the image cannot be represented in the format
+ */
+[[nodiscard]] auto encode_image(ImageEncoding encoding, ImageView const& image, int quality,
+                                std::vector<unsigned char>& out) -> bool;
+
+constexpr int kDefaultJpegQuality = 90;
+
+/**
+ * @return encoding matching the extension of path, kEncodingNone if there is none
+ */
+[[nodiscard]] auto encoding_from_extension(std::filesystem::path const& path) -> ImageEncoding;
@@ -0,0 +1,63 @@
+#include "LeakCheck.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct Entry {
+  EventId event_id;
+  // creation order, objects are reported in it
+  uint64_t sequence;
+};
+
+std::mutex mutex;
+std::map<std::pair<GLResource, uint64_t>, Entry> objects;
+uint64_t next_sequence = 0;
+
+auto resource_name(GLResource resource) -> char const* {
+  switch (resource) {
+    case GLResource::kPbo: return "pixel buffer";
+    case GLResource::kFbo: return "framebuffer";
+    case GLResource::kFence: return "fence";
+    default: return "object";
+  }
+}
+
+}  // namespace
+
+void LeakCheck::on_created(GLResource resource, uint64_t name, EventId event_id) {
+  std::scoped_lock guard(mutex);
+  objects.insert_or_assign({resource, name}, Entry{.event_id = event_id, .sequence = next_sequence++});
+}
+
+void LeakCheck::on_deleted(GLResource resource, uint64_t name) {
+  std::scoped_lock guard(mutex);
+  objects.erase({resource, name});
+}
+
+auto LeakCheck::report(std::FILE* out) -> size_t {
+  struct Leak {
+    uint64_t sequence;
+    GLResource resource;
+    uint64_t name;
+    EventId event_id;
+  };
+  std::vector<Leak> leaks;
+  {
+    std::scoped_lock guard(mutex);
+    for (auto const& [key, entry] : objects) leaks.push_back({entry.sequence, key.first, key.second, entry.event_id});
+  }
+  std::sort(leaks.begin(), leaks.end(), [](Leak const& lhs, Leak const& rhs) { return lhs.sequence < rhs.sequence; });
+
+  for (Leak const& leak : leaks) {
+    std::fprintf(out, "OpenGLAsyncGPUReadbackPlugin: leaked %s %#" PRIx64 " of request %d\n",
+                 resource_name(leak.resource), leak.name, leak.event_id);
+  }
+  if (!leaks.empty()) std::fprintf(out, "OpenGLAsyncGPUReadbackPlugin: %zu GL objects leaked\n", leaks.size());
+  return leaks.size();
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+#include "OpenGLAsyncGPUReadbackPluginAPI.hpp"
+#include "Statistics.hpp"
+
+/**
+ * @brief Registry of every GL object held by a request, reported at UnityPluginUnload in builds with
+ * READBACK_LEAK_CHECK
+ *
+ * Statistics only counts live objects, this records which request each of them belongs to so that leaks can be traced
+ * back to a code path. Every call takes a lock, so it is meant for debugging only.
+ */
+class LeakCheck {
+ public:
+  /**
+   * @param name object name, or the GLsync handle for fences
+   * @param event_id request the object was created for
+   */
+  static void on_created(GLResource resource, uint64_t name, EventId event_id);
+  static void on_deleted(GLResource resource, uint64_t name);
+
+  /**
+   * @brief Write a line for every object that has not been deleted yet
+   * @return number of objects still alive
+   */
+  static auto report(std::FILE* out) -> size_t;
+};
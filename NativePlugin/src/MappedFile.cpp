@@ -0,0 +1,82 @@
+#include "MappedFile.hpp"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+auto MappedFile::open(std::filesystem::path const& path, size_t capacity) -> std::unique_ptr<MappedFile> {
+  if (capacity == 0) return nullptr;
+
+  std::unique_ptr<MappedFile> file(new MappedFile());
+  file->capacity_ = capacity;
+
+#if defined(_WIN32)
+  HANDLE handle = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (handle == INVALID_HANDLE_VALUE) return nullptr;
+  file->file_ = handle;
+
+  auto size = static_cast<ULONGLONG>(capacity);
+  HANDLE mapping = CreateFileMappingW(handle, nullptr, PAGE_READWRITE, static_cast<DWORD>(size >> 32U),
+                                      static_cast<DWORD>(size & 0xFFFFFFFFU), nullptr);
+  if (mapping == nullptr) return nullptr;
+  file->mapping_ = mapping;
+
+  file->data_ = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, capacity);
+#else
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return nullptr;
+  file->file_ = fd;
+
+  if (ftruncate(fd, static_cast<off_t>(capacity)) != 0) return nullptr;
+
+  void* data = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) return nullptr;
+  file->data_ = data;
+#endif
+
+  if (file->data_ == nullptr) return nullptr;
+  return file;
+}
+
+MappedFile::~MappedFile() noexcept {
+  auto used = static_cast<long long>(size());
+
+#if defined(_WIN32)
+  if (data_ != nullptr) UnmapViewOfFile(data_);
+  if (mapping_ != nullptr) CloseHandle(mapping_);
+  if (file_ != nullptr) {
+    LARGE_INTEGER end;
+    end.QuadPart = used;
+    if (SetFilePointerEx(file_, end, nullptr, FILE_BEGIN)) SetEndOfFile(file_);
+    CloseHandle(file_);
+  }
+#else
+  if (data_ != nullptr) munmap(data_, capacity_);
+  if (file_ >= 0) {
+    // drop the unused tail, nothing to do if it fails as the data is still valid
+    [[maybe_unused]] int truncated = ftruncate(file_, static_cast<off_t>(used));
+    close(file_);
+  }
+#endif
+}
+
+auto MappedFile::allocate(size_t length, size_t& offset) noexcept -> void* {
+  size_t current = size_.load();
+  do {
+    if (capacity_ - current < length) [[unlikely]] { return nullptr; }
+  } while (!size_.compare_exchange_weak(current, current + length));
+
+  offset = current;
+  return static_cast<char*>(data_) + offset;
+}
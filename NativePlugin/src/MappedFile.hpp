@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+
+/**
+ * @brief Pre-sized memory-mapped output file that readback results are appended to
+ *
+ * The file is created (or truncated) with the requested capacity and mapped for writing. Regions are reserved with
+ * allocate() in completion order and written to directly, so results land in the page cache without intermediate
+ * copies. On destruction the file is unmapped and truncated to the number of bytes actually appended.
+ */
+class MappedFile {
+ public:
+  /**
+   * @brief Create and map a new output file
+   * @param path file path, existing files are overwritten
+   * @param capacity maximum number of bytes that can be appended
+   * @return the mapped file or nullptr on failure
+   */
+  [[nodiscard]] static auto open(std::filesystem::path const& path, size_t capacity) -> std::unique_ptr<MappedFile>;
+
+  MappedFile(MappedFile const&) = delete;
+  MappedFile(MappedFile&&) = delete;
+  auto operator=(MappedFile const&) = delete;
+  auto operator=(MappedFile&&) = delete;
+  ~MappedFile() noexcept;
+
+  /**
+   * @brief Reserve the next region of the file
+   * @param length size in bytes of the region
+   * @param offset offset in bytes of the region from the start of the file
+   * @return pointer to the mapped region or nullptr if the file has no space left
+   */
+  [[nodiscard]] auto allocate(size_t length, size_t& offset) noexcept -> void*;
+
+  /**
+   * @return number of bytes appended so far
+   */
+  [[nodiscard]] auto size() const noexcept -> size_t { return size_; }
+  [[nodiscard]] auto capacity() const noexcept -> size_t { return capacity_; }
+
+ private:
+  MappedFile() noexcept = default;
+
+  void* data_ = nullptr;
+  size_t capacity_ = 0;
+  std::atomic<size_t> size_ = 0;
+
+#if defined(_WIN32)
+  void* file_ = nullptr;
+  void* mapping_ = nullptr;
+#else
+  int file_ = -1;
+#endif
+};
@@ -1,21 +1,153 @@
 #include "OpenGLAsyncGPUReadbackPlugin.hpp"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
+#include <chrono>
 #include <condition_variable>
 #include <cstring>
-
+#include <fstream>
+#include <limits>
+#include <type_traits>
+
+#include "CaptureStream.hpp"
+#include "FloatConverter.hpp"
+#include "ImageEncoder.hpp"
+#include "LeakCheck.hpp"
+#include "MappedFile.hpp"
+#include "PostProcess.hpp"
+#include "SharedContext.hpp"
+#include "Statistics.hpp"
+#include "Tracer.hpp"
 #include "TypeHelpers.hpp"
+#include "WorkerPool.hpp"
+#include "YuvConverter.hpp"
 
 class BaseTask;
 class SsboTask;
 class FrameTask;
 
+/**
+ * @brief Largest number of bytes moved by a single GL copy, read or map call. Some drivers fail or silently truncate
+ * transfers above 2 GB so larger requests are split into chunks of at most this size.
+ */
+constexpr GLsizeiptr kMaxCopyChunkSize = GLsizeiptr{1} << 30;
+
+/**
+ * @brief Longest time a single render thread event blocks on a fence for wait_for_completion(), waits that take longer
+ * are split over several events so that other rendering can run in between
+ */
+constexpr std::chrono::nanoseconds kRenderWaitSlice = std::chrono::milliseconds(1);
+
+#ifdef READBACK_TIMINGS
+constexpr bool kTimingsEnabled = true;
+#else
+constexpr bool kTimingsEnabled = false;
+#endif
+
+/**
+ * @brief Points in the lifecycle of a request recorded with READBACK_TIMINGS and traced, in the order of
+ * RequestTimings
+ */
+enum class Stage : size_t {
+  kSubmitted,
+  kStarted,
+  kGpuCopyStart,
+  kGpuCopyEnd,
+  kSignalled,
+  kMapped,
+  kCopied,
+  kDone,
+  kReleased,
+  kCount,
+};
+
+static auto now_ns() noexcept -> uint64_t {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+/**
+ * @brief Trace a request reaching a stage, the request spans from submission to release
+ */
+static void trace(Stage stage, EventId event_id) noexcept {
+  if (!Tracer::enabled()) return;
+  switch (stage) {
+    case Stage::kSubmitted: Tracer::record(Tracer::Phase::kAsyncBegin, "request", event_id); break;
+    case Stage::kStarted: Tracer::record(Tracer::Phase::kAsyncInstant, "started", event_id); break;
+    case Stage::kSignalled: Tracer::record(Tracer::Phase::kAsyncInstant, "signalled", event_id); break;
+    case Stage::kMapped: Tracer::record(Tracer::Phase::kAsyncInstant, "mapped", event_id); break;
+    case Stage::kCopied: Tracer::record(Tracer::Phase::kAsyncInstant, "copied", event_id); break;
+    case Stage::kDone: Tracer::record(Tracer::Phase::kAsyncInstant, "done", event_id); break;
+    case Stage::kReleased: Tracer::record(Tracer::Phase::kAsyncEnd, "request", event_id); break;
+    // GPU timestamps are only known after the fact
+    default: break;
+  }
+}
+
+/**
+ * @brief GL calls that should return right away but may block when the driver cannot keep a readback asynchronous,
+ * in the order of RequestStalls
+ */
+enum class BlockingCall : size_t {
+  kMapBuffer,
+  kReadPixels,
+  kClientWait,
+  kCount,
+};
+
 struct Request {
   EventId id;
   std::shared_ptr<BaseTask> task = nullptr;
 };
 
+/**
+ * @brief Set of requests a thread is waiting on, the waiter is woken up once when all or any of them are done
+ */
+class WaitGroup {
+ public:
+  WaitGroup(std::vector<std::shared_ptr<BaseTask>> tasks, bool wait_all) noexcept
+      : tasks_(std::move(tasks)), wait_all_(wait_all), remaining_(wait_all ? tasks_.size() : 1) {}
+
+  [[nodiscard]] auto tasks() const noexcept -> std::vector<std::shared_ptr<BaseTask>> const& { return tasks_; }
+  [[nodiscard]] auto waits_for_all() const noexcept -> bool { return wait_all_; }
+
+  /**
+   * @brief Called once by each task of the group when it is done
+   */
+  void notify() {
+    {
+      std::scoped_lock guard(mutex_);
+      if (remaining_ == 0 || --remaining_ != 0) return;
+    }
+    satisfied_.notify_all();
+  }
+
+  /**
+   * @return true if the group is satisfied before the deadline
+   */
+  auto wait_until(std::chrono::steady_clock::time_point deadline) -> bool {
+    std::unique_lock lock(mutex_);
+    return satisfied_.wait_until(lock, deadline, [this]() { return remaining_ == 0; });
+  }
+
+  /**
+   * @brief Claim the right to issue a render thread wait event, so that a waiter has at most one event in flight
+   * @return false if an event is already pending
+   */
+  auto begin_render_wait() noexcept -> bool { return !render_wait_pending_.exchange(true); }
+  void end_render_wait() noexcept { render_wait_pending_ = false; }
+
+ private:
+  std::vector<std::shared_ptr<BaseTask>> tasks_;
+  bool wait_all_;
+  std::mutex mutex_;
+  std::condition_variable satisfied_;
+  size_t remaining_;
+  std::atomic<bool> render_wait_pending_ = false;
+};
+
 /**
  * @brief Owned or borrowed buffer
  */
@@ -37,6 +169,9 @@ class Buffer {
     set(storage_.get(), length);
   }
 
+  /** @brief whether the data is allocated by the buffer rather than borrowed */
+  [[nodiscard]] auto is_owned() const noexcept -> bool { return storage_ != nullptr && data_ == storage_.get(); }
+
   auto allocate_if_null(size_t length) -> void* {
     if (data_ == nullptr) set(std::make_unique<char[]>(length), length);
     return data_;
@@ -52,15 +187,206 @@ class BaseTask {
  public:
   BaseTask() noexcept = default;
   BaseTask(void* dst, size_t length) noexcept : result_(dst, length) {}
+  explicit BaseTask(std::shared_ptr<MappedFile> sink) noexcept : sink_(std::move(sink)) {
+    if (sink_ == nullptr) set_error_and_done();
+  }
+  explicit BaseTask(std::filesystem::path output_path) noexcept : output_path_(std::move(output_path)) {
+    if (output_path_.empty()) set_error_and_done();
+  }
+  explicit BaseTask(std::shared_ptr<StreamSlot> slot) noexcept : slot_(std::move(slot)) {}
   BaseTask(BaseTask const&) noexcept = delete;
   BaseTask(BaseTask&&) noexcept = delete;
   auto operator=(BaseTask const&) noexcept = delete;
   auto operator=(BaseTask&&) noexcept = delete;
   virtual ~BaseTask() noexcept = default;
 
+  [[nodiscard]] auto event_id() const noexcept -> EventId { return event_id_; }
+  void set_event_id(EventId event_id) noexcept { event_id_ = event_id; }
+  [[nodiscard]] auto is_started() const noexcept -> bool { return started_; }
   [[nodiscard]] auto is_initialized() const noexcept -> bool { return initialized_; }
+  [[nodiscard]] auto is_retrieved() const noexcept -> bool { return retrieved_; }
   [[nodiscard]] auto is_done() const noexcept -> bool { return done_; }
   [[nodiscard]] auto has_error() const noexcept -> bool { return error_; }
+  [[nodiscard]] auto has_sink() const noexcept -> bool { return sink_ != nullptr; }
+  /** @brief whether the data is retrieved by the readback thread instead of the render thread */
+  [[nodiscard]] auto is_threaded() const noexcept -> bool { return threaded_; }
+  void set_threaded() noexcept { threaded_ = true; }
+  [[nodiscard]] auto sink_offset() const noexcept -> size_t { return sink_offset_; }
+  [[nodiscard]] auto hash() const noexcept -> uint64_t { return hash_; }
+  [[nodiscard]] auto options() const noexcept -> RequestOptions const& { return options_; }
+  void set_options(RequestOptions const& options) noexcept { options_ = options; }
+
+  [[nodiscard]] auto needs_post_process() const noexcept -> bool {
+    return (options_.post_process & (kPostProcessSwapRedBlue | kPostProcessHash | kPostProcessCallback)) != 0 ||
+           options_.encoding != kEncodingNone || options_.yuv_format != kYuvNone ||
+           options_.float_conversion != kFloatNone;
+  }
+
+  /**
+   * @brief Mark the request as complete once its data is retrieved and post-processed and wake up its waiters
+   */
+  void set_done() { mark_done(); }
+
+  /**
+   * @return true the first time it is called, so that a request is counted and reported as done only once
+   */
+  [[nodiscard]] auto mark_completed() noexcept -> bool { return !completed_.exchange(true); }
+
+  /**
+   * @brief Allow the request to be released once the completion callbacks have seen it, being done is not enough as
+   * requests are marked done before they are reported
+   */
+  void mark_delivered() noexcept { delivered_.store(true, std::memory_order_release); }
+  [[nodiscard]] auto is_delivered() const noexcept -> bool { return delivered_.load(std::memory_order_acquire); }
+
+  /**
+   * @brief Notify a wait group once the request is done, immediately if it already is
+   * @param group
+   */
+  void add_waiter(std::shared_ptr<WaitGroup> const& group) {
+    {
+      std::scoped_lock guard(done_mutex_);
+      if (!done_) {
+        waiters_.emplace_back(group);
+        return;
+      }
+    }
+    group->notify();
+  }
+
+  /**
+   * @brief Run a function once the request is done, immediately on the calling thread if it already is
+   * @param continuation
+   */
+  void add_continuation(std::function<void()> continuation) {
+    {
+      std::scoped_lock guard(done_mutex_);
+      if (!done_) {
+        continuations_.emplace_back(std::move(continuation));
+        return;
+      }
+    }
+    continuation();
+  }
+
+  /**
+   * @brief Record the time a stage was reached and trace it, only traces without READBACK_TIMINGS
+   */
+  void stamp(Stage stage) noexcept {
+#ifdef READBACK_TIMINGS
+    stamp_at(stage, now_ns());
+#endif
+    trace(stage, event_id_);
+  }
+
+  void stamp_at([[maybe_unused]] Stage stage, [[maybe_unused]] uint64_t time) noexcept {
+#ifdef READBACK_TIMINGS
+    timestamps_[static_cast<size_t>(stage)].store(time, std::memory_order_relaxed);
+#endif
+  }
+
+  [[nodiscard]] auto timings() const noexcept -> RequestTimings {
+    RequestTimings timings;
+#ifdef READBACK_TIMINGS
+    auto at = [this](Stage stage) { return timestamps_[static_cast<size_t>(stage)].load(std::memory_order_relaxed); };
+    timings.submitted = at(Stage::kSubmitted);
+    timings.started = at(Stage::kStarted);
+    timings.gpu_copy_start = at(Stage::kGpuCopyStart);
+    timings.gpu_copy_end = at(Stage::kGpuCopyEnd);
+    timings.signalled = at(Stage::kSignalled);
+    timings.mapped = at(Stage::kMapped);
+    timings.copied = at(Stage::kCopied);
+    timings.done = at(Stage::kDone);
+    timings.released = at(Stage::kReleased);
+#endif
+    return timings;
+  }
+
+  /**
+   * @return time spent in blocking GL calls so far, stalled is only set once the request is done
+   */
+  [[nodiscard]] auto stalls() const noexcept -> RequestStalls {
+    auto at = [this](BlockingCall call) {
+      return blocking_ns_[static_cast<size_t>(call)].load(std::memory_order_relaxed);
+    };
+    return RequestStalls{
+        .map_ns = at(BlockingCall::kMapBuffer),
+        .read_pixels_ns = at(BlockingCall::kReadPixels),
+        .client_wait_ns = at(BlockingCall::kClientWait),
+        .stalled = stalled_,
+    };
+  }
+
+  /**
+   * @brief Flag the request if it spent longer than threshold in any kind of blocking call, called once it is done
+   * @param threshold in nanoseconds, 0 flags nothing
+   * @return the final stall times
+   */
+  auto flag_stalls(uint64_t threshold) noexcept -> RequestStalls {
+    RequestStalls times = stalls();
+    stalled_ = threshold != 0 &&
+               std::max({times.map_ns, times.read_pixels_ns, times.client_wait_ns}) > threshold;
+    times.stalled = stalled_;
+    return times;
+  }
+
+  /**
+   * @brief Set where GPU memory and allocations are accounted
+   * @param stats
+   * @param frame frame the request was submitted in
+   */
+  void set_statistics(Statistics* stats, uint64_t frame) noexcept {
+    stats_ = stats;
+    submit_frame_ = frame;
+  }
+  [[nodiscard]] auto submit_frame() const noexcept -> uint64_t { return submit_frame_; }
+
+  /**
+   * @return size in bytes of the retrieved data
+   */
+  [[nodiscard]] auto size() noexcept -> size_t {
+    std::scoped_lock guard(mutex_);
+    return result_.size();
+  }
+
+  /** @brief position of the request in the order requests were issued on the render thread */
+  [[nodiscard]] auto issue_order() const noexcept -> uint64_t { return issue_order_; }
+  void set_issue_order(uint64_t order) noexcept { issue_order_ = order; }
+
+  /**
+   * @brief Run the requested post-processing steps, YUV or float conversion and encoding on the retrieved data, called
+   * from a worker thread
+   * @param event_id request id passed to the callback
+   * @param callback native post-processing callback for kPostProcessCallback
+   */
+  void post_process(EventId event_id, PostProcessCallbackPtr callback) {
+    std::scoped_lock guard(mutex_);
+    void* data = result_.data();
+    size_t length = result_.size();
+
+    if ((options_.post_process & kPostProcessSwapRedBlue) != 0 && !swap_red_blue(data, length, layout_)) {
+      error_ = true;
+      return;
+    }
+    if (options_.yuv_format != kYuvNone) {
+      if (!convert_yuv(data, length)) {
+        error_ = true;
+        return;
+      }
+      length = result_.size();
+    }
+    if (options_.float_conversion != kFloatNone) {
+      if (!convert_float()) {
+        error_ = true;
+        return;
+      }
+      data = result_.data();
+      length = result_.size();
+    }
+    if ((options_.post_process & kPostProcessHash) != 0) hash_ = xxh64(data, length);
+    if ((options_.post_process & kPostProcessCallback) != 0 && callback != nullptr) callback(event_id, data, length);
+    if (options_.encoding != kEncodingNone && !encode(data, length)) error_ = true;
+  }
 
   auto get_data(size_t& length) -> void* {
     if (!done_ || error_) { return nullptr; }
@@ -69,28 +395,110 @@ class BaseTask {
     return result_.data();
   }
 
-  void start_request() {
-    glGenBuffers(1, &pbo_);
+  auto get_encoded_data(size_t& length) -> void* {
+    if (!done_ || error_) { return nullptr; }
+    std::scoped_lock guard(mutex_);
+    if (encoded_.empty()) return nullptr;
+    length = encoded_.size();
+    return encoded_.data();
+  }
+
+  /**
+   * @brief Query anything needed to size the request, called from the render thread before start_request()
+   * @return request size in bytes
+   */
+  auto prepare() -> GLsizeiptr {
+    if (!prepared_ && !error_) {
+      on_prepare();
+      prepared_ = true;
+    }
+    return buffer_size_;
+  }
+
+  /**
+   * @param gpu_clock_offset returns the offset converting GPU timestamps to now_ns(), only called for timed copies
+   */
+  void start_request([[maybe_unused]] std::function<int64_t()> const& gpu_clock_offset) {
+    if (started_.exchange(true)) return;
+    stamp(Stage::kStarted);
+    prepare();
+    if (error_) [[unlikely]] { return; }
+
+    if (slot_ != nullptr && slot_->pbo != 0) {
+      pbo_ = slot_->pbo;
+    } else {
+      glGenBuffers(1, &pbo_);
+      on_created(GLResource::kPbo, pbo_);
+      // the staging memory of stream slots is accounted when their storage grows
+      if (slot_ != nullptr) {
+        slot_->pbo = pbo_;
+      } else if (stats_ != nullptr) {
+        stats_->on_staging_allocated(static_cast<size_t>(buffer_size_));
+      }
+    }
     glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo_);
 
+#ifdef READBACK_TIMINGS
+    if (!threaded_) gpu_clock_offset_ = gpu_clock_offset();
+#endif
+    begin_gpu_timing();
     on_start_request();
+    end_gpu_timing();
+    if (error_) [[unlikely]] {
+      // nothing will ever retrieve it, so the staging buffer goes right away
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+      clean_up();
+      return;
+    }
 
     // Create a fence.
     fence_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    on_created(GLResource::kFence, reinterpret_cast<uintptr_t>(fence_));
     initialized_ = true;
   }
 
-  void wait_for_completion() {
-    GLenum status = glClientWaitSync(fence_, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
+  /**
+   * @brief Block until the copy has finished and retrieve the data, is_retrieved() is true afterwards unless the wait
+   * timed out
+   * @param timeout maximum time to wait in nanoseconds
+   * @return false if the wait timed out
+   */
+  auto wait_for_completion(GLuint64 timeout = std::numeric_limits<GLuint64>::max()) -> bool {
+    GLenum status = timed(BlockingCall::kClientWait,
+                          [this, timeout]() { return glClientWaitSync(fence_, GL_SYNC_FLUSH_COMMANDS_BIT, timeout); });
+    if (status == GL_TIMEOUT_EXPIRED) return false;
     if (status != GL_CONDITION_SATISFIED && status != GL_ALREADY_SIGNALED) [[unlikely]] {
-      // timeout, error or unknown status -> treat as error
+      // error or unknown status -> treat as error
       set_error_and_done();
-      return;
+      clean_up();
+      return true;
     }
 
     retrieve_data();
+    return true;
+  }
+
+  /**
+   * @brief Fail a request whose copy was given up on, releasing its staging buffer and fence
+   */
+  void abandon() {
+    set_error_and_done();
+    clean_up();
   }
 
+  /**
+   * @return true if the copy has finished, without retrieving the data
+   */
+  [[nodiscard]] auto is_signalled() const -> bool {
+    GLint status = 0;
+    GLsizei length = 0;
+    glGetSynciv(fence_, GL_SYNC_STATUS, sizeof(GLint), &length, &status);
+    return length > 0 && status == GL_SIGNALED;
+  }
+
+  /**
+   * @brief Retrieve the data if the copy has finished, is_retrieved() is true once it has
+   */
   void update() {
     // Check fence state
     GLint status = 0;
@@ -107,60 +515,366 @@ class BaseTask {
   }
 
  protected:
+  virtual void on_prepare() {}
   virtual void on_start_request() = 0;
-  virtual void clean_up_graphics_resources() {}
 
   /*
   Called by subclass to mark as error.
   */
   void set_error_and_done() {
     error_ = true;
-    done_ = true;
+    retrieved_ = true;
+    mark_done();
+  }
+
+  /**
+   * @brief Account a GL object created for the request, see Plugin_GetStats and LeakCheck
+   * @param name object name, or the GLsync handle for fences
+   */
+  void on_created(GLResource resource, [[maybe_unused]] uint64_t name) {
+    if (stats_ != nullptr) stats_->on_created(resource);
+#ifdef READBACK_LEAK_CHECK
+    LeakCheck::on_created(resource, name, event_id_);
+#endif
+  }
+
+  /**
+   * @brief Run a GL call and add the time it took to the request's stall times
+   */
+  template <class Call>
+  auto timed(BlockingCall call, Call&& gl_call) -> decltype(gl_call()) {
+    uint64_t start = now_ns();
+    if constexpr (std::is_void_v<decltype(gl_call())>) {
+      gl_call();
+      blocking_ns_[static_cast<size_t>(call)].fetch_add(now_ns() - start, std::memory_order_relaxed);
+    } else {
+      auto result = gl_call();
+      blocking_ns_[static_cast<size_t>(call)].fetch_add(now_ns() - start, std::memory_order_relaxed);
+      return result;
+    }
   }
 
-  [[nodiscard]] auto buffer_size() const noexcept -> GLint { return buffer_size_; }
-  void set_buffer_size(GLint s) noexcept { buffer_size_ = s; }
+  void on_deleted(GLResource resource, [[maybe_unused]] uint64_t name) {
+    if (stats_ != nullptr) stats_->on_deleted(resource);
+#ifdef READBACK_LEAK_CHECK
+    LeakCheck::on_deleted(resource, name);
+#endif
+  }
+
+  void set_layout(PixelLayout const& layout) noexcept { layout_ = layout; }
+
+  /** @brief whether texture rows are stored top row first, buffers have no rows to flip */
+  [[nodiscard]] auto is_flipped() const noexcept -> bool {
+    return (options_.copy_flags & kCopyFlipRows) != 0 && layout_.is_valid();
+  }
+
+  /**
+   * @brief Allocate the storage of the bound staging buffer, captures of a stream keep the storage of their slot when
+   * it is large enough
+   * @param usage glBufferData usage hint
+   */
+  void allocate_staging(GLenum usage) {
+    if (slot_ != nullptr && slot_->staging_size >= buffer_size_) return;
+    glBufferData(GL_PIXEL_PACK_BUFFER, buffer_size_, nullptr, usage);
+    if (slot_ == nullptr) return;
+    if (stats_ != nullptr) {
+      stats_->on_staging_released(static_cast<size_t>(slot_->staging_size));
+      stats_->on_staging_allocated(static_cast<size_t>(buffer_size_));
+    }
+    slot_->staging_size = buffer_size_;
+  }
+
+  [[nodiscard]] auto buffer_size() const noexcept -> GLsizeiptr { return buffer_size_; }
+  void set_buffer_size(GLsizeiptr s) noexcept { buffer_size_ = s; }
 
  private:
+  EventId event_id_ = 0;
   Buffer result_;
+  std::shared_ptr<MappedFile> sink_ = nullptr;
+  size_t sink_offset_ = 0;
+  std::vector<unsigned char> encoded_;
+  std::filesystem::path output_path_;
+  std::shared_ptr<StreamSlot> slot_ = nullptr;
+  RequestOptions options_;
+  PixelLayout layout_;
+  uint64_t hash_ = 0;
   std::mutex mutex_;
 
+  std::atomic<bool> started_ = false;
   std::atomic<bool> initialized_ = false;
   std::atomic<bool> error_ = false;
+  std::atomic<bool> retrieved_ = false;
   std::atomic<bool> done_ = false;
+  std::atomic<bool> threaded_ = false;
+  std::atomic<bool> completed_ = false;
+  std::atomic<bool> delivered_ = false;
+  std::atomic<bool> stalled_ = false;
+  std::array<std::atomic<uint64_t>, static_cast<size_t>(BlockingCall::kCount)> blocking_ns_{};
+  uint64_t issue_order_ = 0;
+  Statistics* stats_ = nullptr;
+  uint64_t submit_frame_ = 0;
+
+  // per-request so that waiters are only woken up by the requests they wait on
+  std::mutex done_mutex_;
+  std::vector<std::weak_ptr<WaitGroup>> waiters_;
+  std::vector<std::function<void()>> continuations_;
+
+#ifdef READBACK_TIMINGS
+  std::array<std::atomic<uint64_t>, static_cast<size_t>(Stage::kCount)> timestamps_{};
+  std::array<GLuint, 2> timestamp_queries_{};
+  // converts GPU timestamps to now_ns(), shared by the requests started in the same render update
+  int64_t gpu_clock_offset_ = 0;
+#endif
 
   GLuint pbo_ = 0;
   GLsync fence_ = nullptr;
-  GLint buffer_size_ = 0;
+  GLsizeiptr buffer_size_ = 0;
+  bool prepared_ = false;
+
+  void mark_done() {
+    std::vector<std::weak_ptr<WaitGroup>> waiters;
+    std::vector<std::function<void()>> continuations;
+    {
+      // lock so that groups cannot be added between setting done and taking the waiters
+      std::scoped_lock guard(done_mutex_);
+      // failed requests are marked done where they fail and again when the plugin completes them
+      if (done_) return;
+      stamp(Stage::kDone);
+      done_ = true;
+      waiters.swap(waiters_);
+      continuations.swap(continuations_);
+    }
+    for (auto const& waiter : waiters) {
+      if (std::shared_ptr<WaitGroup> group = waiter.lock()) group->notify();
+    }
+    for (auto const& continuation : continuations) continuation();
+  }
 
   void clean_up() {
-    if (pbo_ != 0) { glDeleteBuffers(1, &pbo_); }
-    if (fence_ != nullptr) { glDeleteSync(fence_); }
-    clean_up_graphics_resources();
+    if (pbo_ != 0 && slot_ != nullptr) {
+      // stays with the slot for its next capture
+      pbo_ = 0;
+    } else if (pbo_ != 0) {
+      on_deleted(GLResource::kPbo, pbo_);
+      glDeleteBuffers(1, &pbo_);
+      pbo_ = 0;
+      if (stats_ != nullptr) stats_->on_staging_released(static_cast<size_t>(buffer_size_));
+    }
+    if (fence_ != nullptr) {
+      on_deleted(GLResource::kFence, reinterpret_cast<uintptr_t>(fence_));
+      glDeleteSync(fence_);
+      fence_ = nullptr;
+    }
+#ifdef READBACK_TIMINGS
+    if (timestamp_queries_[0] != 0) {
+      glDeleteQueries(static_cast<GLsizei>(timestamp_queries_.size()), timestamp_queries_.data());
+      timestamp_queries_ = {};
+    }
+#endif
   }
 
-  void set_data_and_done(void* data, size_t length) {
-    {
-      std::scoped_lock guard(mutex_);
-      void* dst = result_.allocate_if_null(length);
-      std::memcpy(dst, data, std::min(result_.size(), length));
+  /**
+   * @brief Bracket the copy commands with GPU timestamp queries, only on the render thread context since the readback
+   * thread cannot read queries from another context
+   */
+  void begin_gpu_timing() {
+#ifdef READBACK_TIMINGS
+    if (threaded_) return;
+    glGenQueries(static_cast<GLsizei>(timestamp_queries_.size()), timestamp_queries_.data());
+    glQueryCounter(timestamp_queries_[0], GL_TIMESTAMP);
+#endif
+  }
+
+  void end_gpu_timing() {
+#ifdef READBACK_TIMINGS
+    if (timestamp_queries_[1] != 0) glQueryCounter(timestamp_queries_[1], GL_TIMESTAMP);
+#endif
+  }
+
+  /**
+   * @brief Record the GPU timestamps, their results are available once the fence has signalled
+   */
+  void read_gpu_timing() {
+#ifdef READBACK_TIMINGS
+    if (timestamp_queries_[0] == 0) return;
+    for (auto [query, stage] : {std::pair{timestamp_queries_[0], Stage::kGpuCopyStart},
+                                std::pair{timestamp_queries_[1], Stage::kGpuCopyEnd}}) {
+      GLuint64 gpu_time = 0;
+      glGetQueryObjectui64v(query, GL_QUERY_RESULT, &gpu_time);
+      stamp_at(stage, static_cast<uint64_t>(static_cast<int64_t>(gpu_time) + gpu_clock_offset_));
     }
-    done_ = true;
+#endif
+  }
+
+  /**
+   * @brief Copy a mapped chunk of the staging buffer into the result
+   * @param offset offset in bytes of the chunk from the start of the staging buffer
+   * @param data mapped chunk
+   * @param length size in bytes of the chunk
+   */
+  void set_data(size_t offset, void const* data, size_t length) {
+    std::scoped_lock guard(mutex_);
+    if (is_flipped()) {
+      copy_flipped(result_.data(), result_.size(), static_cast<size_t>(layout_.height), layout_.row_size(), offset,
+                   data, length);
+      return;
+    }
+    if (offset >= result_.size()) return;
+    std::memcpy(static_cast<char*>(result_.data()) + offset, data, std::min(result_.size() - offset, length));
+  }
+
+  /**
+   * @brief Encode texture data with the requested encoding and write it to the output file if there is one, called
+   * with mutex_ held
+   * @return false if the data is not a texture with 8-bit unsigned components or the file cannot be written
+   */
+  auto encode(void const* data, size_t length) -> bool {
+    // the converted frame is no longer an image of the texture
+    if (options_.yuv_format != kYuvNone) return false;
+    ImageView image;
+    if (!image_view(data, length, image)) return false;
+    if (!encode_image(static_cast<ImageEncoding>(options_.encoding), image, options_.encode_quality, encoded_)) {
+      return false;
+    }
+    if (output_path_.empty()) return true;
+
+    std::ofstream file(output_path_, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<char const*>(encoded_.data()), static_cast<std::streamsize>(encoded_.size()));
+    return static_cast<bool>(file);
+  }
+
+  /**
+   * @brief View of texture data with 8-bit unsigned components
+   * @return false if the data is not such a texture or is too short
+   */
+  auto image_view(void const* data, size_t length, ImageView& image) const noexcept -> bool {
+    if (!layout_.is_valid() || layout_.component_size != 1 || layout_.type != GL_UNSIGNED_BYTE) return false;
+    auto row_size = static_cast<ptrdiff_t>(layout_.row_size());
+    if (length < static_cast<size_t>(row_size) * layout_.height) return false;
+
+    // rows are read back starting from the bottom of the texture unless they were flipped, images start from the top
+    bool flipped = is_flipped();
+    image = ImageView{
+        .top = static_cast<unsigned char const*>(data) + (flipped ? 0 : row_size * (layout_.height - 1)),
+        .stride = flipped ? row_size : -row_size,
+        .width = layout_.width,
+        .height = layout_.height,
+        .components = layout_.components,
+    };
+    return true;
+  }
+
+  /**
+   * @brief Replace RGB(A) texture data with the requested YUV frame, which is always smaller, called with mutex_ held
+   * @return false if the data cannot be converted, is written to a file or had its red and blue swapped
+   */
+  auto convert_yuv(void* data, size_t length) -> bool {
+    // the file region keeps the size of the staging buffer, and swapped pixels would give swapped chroma
+    if (sink_ != nullptr || (options_.post_process & kPostProcessSwapRedBlue) != 0) return false;
+    ImageView image;
+    if (!image_view(data, length, image)) return false;
+
+    auto format = static_cast<YuvFormat>(options_.yuv_format);
+    size_t size = yuv_frame_size(format, image.width, image.height);
+    // the frame overlaps the pixels it is converted from
+    thread_local std::vector<unsigned char> scratch;
+    scratch.resize(size);
+    if (!convert_to_yuv(format, static_cast<YuvColorSpace>(options_.yuv_color_space), image, scratch.data())) {
+      return false;
+    }
+    std::memcpy(data, scratch.data(), size);
+    result_.set(data, size);
+    return true;
+  }
+
+  /**
+   * @brief Replace texture data with its components converted to float, called with mutex_ held
+   * @return false if the components are not normalized, or the floats do not fit where the data is stored
+   */
+  auto convert_float() -> bool {
+    if (layout_.is_valid() && layout_.type == GL_FLOAT) return true;
+    FloatKernel kernel = float_kernel(static_cast<FloatConversion>(options_.float_conversion), layout_);
+    // floats are larger than the components, which the file region is sized for
+    if (kernel == FloatKernel::kNone || sink_ != nullptr || options_.yuv_format != kYuvNone) return false;
+
+    // borrowed buffers can be larger than the data
+    size_t count = std::min(result_.size(), static_cast<size_t>(buffer_size_)) / layout_.component_size;
+    size_t size = count * sizeof(float);
+    if (result_.is_owned()) {
+      auto floats = std::make_unique<char[]>(size);
+      convert_to_float(kernel, result_.data(), count, layout_.components, reinterpret_cast<float*>(floats.get()));
+      result_.set(std::move(floats), size);
+      if (stats_ != nullptr) stats_->on_result_allocated();
+    } else {
+      // the floats overlap the components they are converted from
+      thread_local std::vector<float> scratch;
+      scratch.resize(count);
+      convert_to_float(kernel, result_.data(), count, layout_.components, scratch.data());
+      void* dst = result_.data();
+      if (slot_ != nullptr) {
+        if (slot_->capacity < size && stats_ != nullptr) stats_->on_result_allocated();
+        dst = slot_->reserve(size);
+      } else if (size > result_.size()) {
+        return false;
+      }
+      std::memcpy(dst, scratch.data(), size);
+      result_.set(dst, size);
+    }
+    layout_.component_size = sizeof(float);
+    layout_.type = GL_FLOAT;
+    return true;
   }
 
   void retrieve_data() {
+    stamp(Stage::kSignalled);
+    read_gpu_timing();
+
     // Bind back the pbo
     glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo_);
 
-    // Map the buffer and copy it to data
-    void* ptr = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, buffer_size_, GL_MAP_READ_BIT);
+    bool mapped = true;
+    {
+      std::scoped_lock guard(mutex_);
+      if (sink_ != nullptr) {
+        // write straight into the next region of the output file
+        void* dst = sink_->allocate(static_cast<size_t>(buffer_size_), sink_offset_);
+        mapped = dst != nullptr;
+        result_.set(dst, mapped ? static_cast<size_t>(buffer_size_) : 0);
+      } else if (slot_ != nullptr) {
+        if (slot_->capacity < static_cast<size_t>(buffer_size_) && stats_ != nullptr) stats_->on_result_allocated();
+        result_.set(slot_->reserve(static_cast<size_t>(buffer_size_)), static_cast<size_t>(buffer_size_));
+      } else {
+        if (result_.data() == nullptr && stats_ != nullptr) stats_->on_result_allocated();
+        result_.allocate_if_null(static_cast<size_t>(buffer_size_));
+      }
+    }
+
+    // Map the buffer chunk by chunk and copy it to data
+    for (GLsizeiptr offset = 0; offset < buffer_size_ && mapped; offset += kMaxCopyChunkSize) {
+      GLsizeiptr length = std::min(kMaxCopyChunkSize, buffer_size_ - offset);
+      void* ptr = timed(BlockingCall::kMapBuffer, [offset, length]() {
+        return glMapBufferRange(GL_PIXEL_PACK_BUFFER, offset, length, GL_MAP_READ_BIT);
+      });
+      mapped = ptr != nullptr;
+      if (mapped) [[likely]] {
+        if (offset == 0) stamp(Stage::kMapped);
+        set_data(static_cast<size_t>(offset), ptr, static_cast<size_t>(length));
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+      }
+    }
 
-    set_data_and_done(ptr, buffer_size_);
+    if (mapped) stamp(Stage::kCopied);
 
-    // Unmap and unbind
-    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    // Unbind
     glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
     clean_up();
+
+    if (mapped) [[likely]] {
+      // done is set by the plugin once post-processing has finished
+      retrieved_ = true;
+    } else {
+      set_error_and_done();
+    }
   }
 };
 
@@ -170,7 +884,7 @@ class SsboTask : public BaseTask {
  public:
   using BaseTask::BaseTask;
 
-  void init(GLuint _ssbo, GLint _bufferSize) {
+  void init(GLuint _ssbo, GLsizeiptr _bufferSize) {
     this->ssbo_ = _ssbo;
     this->set_buffer_size(_bufferSize);
   }
@@ -181,10 +895,13 @@ class SsboTask : public BaseTask {
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->ssbo_);
 
     // Initialize pbo buffer storage.
-    glBufferData(GL_PIXEL_PACK_BUFFER, this->buffer_size(), nullptr, GL_STREAM_READ);
+    this->allocate_staging(GL_STREAM_READ);
 
     // Copy data to pbo.
-    glCopyBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_PIXEL_PACK_BUFFER, 0, 0, this->buffer_size());
+    for (GLsizeiptr offset = 0; offset < this->buffer_size(); offset += kMaxCopyChunkSize) {
+      GLsizeiptr length = std::min(kMaxCopyChunkSize, this->buffer_size() - offset);
+      glCopyBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_PIXEL_PACK_BUFFER, offset, offset, length);
+    }
 
     // Unbind buffers.
     glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
@@ -207,15 +924,24 @@ class FrameTask : public BaseTask {
   }
 
  protected:
-  void on_start_request() override {
-    // Get texture information
+  void on_prepare() override {
+    // Only 2D textures are read back, binding a texture of another target fails and leaves the previous binding, which
+    // is checked rather than glGetError() so that errors raised by Unity are neither picked up nor cleared
     glBindTexture(GL_TEXTURE_2D, texture_);
+    GLint bound = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+    if (static_cast<GLuint>(bound) != texture_) {
+      set_error_and_done();
+      return;
+    }
+
+    // Get texture information
     glGetTexLevelParameteriv(GL_TEXTURE_2D, miplevel_, GL_TEXTURE_WIDTH, &(width_));
     glGetTexLevelParameteriv(GL_TEXTURE_2D, miplevel_, GL_TEXTURE_HEIGHT, &(height_));
-    glGetTexLevelParameteriv(GL_TEXTURE_2D, miplevel_, GL_TEXTURE_DEPTH, &(depth_));
     glGetTexLevelParameteriv(GL_TEXTURE_2D, miplevel_, GL_TEXTURE_INTERNAL_FORMAT, &(internal_format_));
     int pixelBits = getPixelSizeFromInternalFormat(internal_format_);
-    this->set_buffer_size(depth_ * width_ * height_ * pixelBits / 8);
+    row_size_ = static_cast<GLsizeiptr>(width_) * pixelBits / 8;
+    this->set_buffer_size(static_cast<GLsizeiptr>(height_) * row_size_);
     // Check for errors
     if (this->buffer_size() == 0 || pixelBits % 8 != 0  // Only support textures aligned to one byte.
         || getFormatFromInternalFormat(internal_format_) == 0 || getTypeFromInternalFormat(internal_format_) == 0) {
@@ -223,38 +949,74 @@ class FrameTask : public BaseTask {
       return;
     }
 
+    int format = getFormatFromInternalFormat(internal_format_);
+    int type = getTypeFromInternalFormat(internal_format_);
+    set_layout(PixelLayout{
+        .width = width_,
+        .height = height_,
+        .components = getComponentCountFromFormat(format),
+        .component_size = getComponentSizeFromType(type),
+        .type = type,
+        .normalized = !isIntegerFormat(format),
+        .srgb = isSrgbInternalFormat(internal_format_),
+    });
+  }
+
+  void on_start_request() override {
     // Create the fbo (frame buffer object) from the given texture
-    glGenFramebuffers(1, &(fbo_));
+    GLuint fbo = 0;
+    glGenFramebuffers(1, &fbo);
+    on_created(GLResource::kFbo, fbo);
+    auto delete_fbo = [this, &fbo]() {
+      glBindFramebuffer(GL_FRAMEBUFFER, 0);
+      on_deleted(GLResource::kFbo, fbo);
+      glDeleteFramebuffers(1, &fbo);
+    };
 
     // Bind the texture to the fbo
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
     glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, texture_, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) [[unlikely]] {
+      // e.g. the texture was deleted in the meantime, reading would fail, start_request() deletes the pbo
+      delete_fbo();
+      set_error_and_done();
+      return;
+    }
 
     // bind pbo (pixel buffer object) to fbo
-    glBufferData(GL_PIXEL_PACK_BUFFER, this->buffer_size(), nullptr, GL_DYNAMIC_READ);
+    this->allocate_staging(GL_DYNAMIC_READ);
+
+    // Rows are tightly packed in the pbo, chunk offsets below depend on it
+    GLint pack_alignment = 4;
+    glGetIntegerv(GL_PACK_ALIGNMENT, &pack_alignment);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
 
-    // Start the read request
+    // Start the read request, in bands of rows so that no single read exceeds kMaxCopyChunkSize
     glReadBuffer(GL_COLOR_ATTACHMENT0);
-    glReadPixels(0, 0, width_, height_, getFormatFromInternalFormat(internal_format_),
-                 getTypeFromInternalFormat(internal_format_), nullptr);
+    GLint rows_per_read = static_cast<GLint>(std::clamp<GLsizeiptr>(kMaxCopyChunkSize / row_size_, 1, height_));
+    for (GLint row = 0; row < height_; row += rows_per_read) {
+      GLint rows = std::min(rows_per_read, height_ - row);
+      timed(BlockingCall::kReadPixels, [this, row, rows]() {
+        glReadPixels(0, row, width_, rows, getFormatFromInternalFormat(internal_format_),
+                     getTypeFromInternalFormat(internal_format_),
+                     reinterpret_cast<void*>(static_cast<GLintptr>(row) * row_size_));  // NOLINT: pbo offset
+      });
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, pack_alignment);
 
-    // Unbind buffers
+    // Unbind buffers, framebuffers are not shared between contexts so the fbo is deleted here rather than by whichever
+    // thread retrieves the data, pending reads keep it alive
     glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-  }
-
-  void clean_up_graphics_resources() override {
-    if (fbo_ != 0) glDeleteFramebuffers(1, &fbo_);
+    delete_fbo();
   }
 
  private:
   GLuint texture_ = 0;
-  GLuint fbo_ = 0;
   int miplevel_ = 0;
   int height_ = 0;
   int width_ = 0;
-  int depth_ = 0;
   GLint internal_format_ = 0;
+  GLsizeiptr row_size_ = 0;
 };
 
 auto Plugin::instance() noexcept -> Plugin& {
@@ -262,55 +1024,243 @@ auto Plugin::instance() noexcept -> Plugin& {
   return plugin;
 }
 
-auto Plugin::request_texture(GLuint texture, int miplevel) -> EventId {
+auto Plugin::request_texture(GLuint texture, int miplevel, RequestOptions const& options) -> EventId {
   std::shared_ptr<FrameTask> task = std::make_shared<FrameTask>();
   task->init(texture, miplevel);
-  return insert(std::move(task));
+  return insert(std::move(task), options);
 }
 
-auto Plugin::request_texture(void* buffer, size_t size, GLuint texture, int miplevel) -> EventId {
+auto Plugin::request_texture(void* buffer, size_t size, GLuint texture, int miplevel, RequestOptions const& options)
+    -> EventId {
   std::shared_ptr<FrameTask> task = std::make_shared<FrameTask>(buffer, size);
   task->init(texture, miplevel);
-  return insert(std::move(task));
+  return insert(std::move(task), options);
+}
+
+auto Plugin::request_texture_into_sink(SinkId sink, GLuint texture, int miplevel, RequestOptions const& options)
+    -> EventId {
+  std::shared_ptr<FrameTask> task = std::make_shared<FrameTask>(find_sink(sink));
+  task->init(texture, miplevel);
+  return insert(std::move(task), options);
 }
 
-auto Plugin::request_compute_buffer(GLuint compute_buffer, GLint buffer_size) -> EventId {
+auto Plugin::request_texture_to_file(std::filesystem::path const& path, GLuint texture, int miplevel,
+                                     RequestOptions options) -> EventId {
+  if (options.encoding == kEncodingNone) options.encoding = encoding_from_extension(path);
+  // without an encoding the request fails right away, as requests into a missing sink do
+  std::shared_ptr<FrameTask> task =
+      std::make_shared<FrameTask>(options.encoding != kEncodingNone ? path : std::filesystem::path());
+  task->init(texture, miplevel);
+  return insert(std::move(task), options);
+}
+
+auto Plugin::request_compute_buffer(GLuint compute_buffer, GLsizeiptr buffer_size, RequestOptions const& options)
+    -> EventId {
   std::shared_ptr<SsboTask> task = std::make_shared<SsboTask>();
   task->init(compute_buffer, buffer_size);
-  return insert(std::move(task));
+  return insert(std::move(task), options);
 }
 
-auto Plugin::request_compute_buffer(void* buffer, size_t size, GLuint compute_buffer, GLint buffer_size) -> EventId {
+auto Plugin::request_compute_buffer(void* buffer, size_t size, GLuint compute_buffer, GLsizeiptr buffer_size,
+                                    RequestOptions const& options) -> EventId {
   std::shared_ptr<SsboTask> task = std::make_shared<SsboTask>(buffer, size);
   task->init(compute_buffer, buffer_size);
-  return insert(std::move(task));
+  return insert(std::move(task), options);
 }
 
-void Plugin::update_once() {
+auto Plugin::request_compute_buffer_into_sink(SinkId sink, GLuint compute_buffer, GLsizeiptr buffer_size,
+                                              RequestOptions const& options) -> EventId {
+  std::shared_ptr<SsboTask> task = std::make_shared<SsboTask>(find_sink(sink));
+  task->init(compute_buffer, buffer_size);
+  return insert(std::move(task), options);
+}
+
+auto Plugin::open_sink(std::filesystem::path const& path, size_t capacity) -> SinkId {
+  std::shared_ptr<MappedFile> file = MappedFile::open(path, capacity);
+  if (file == nullptr) return kInvalidSinkId;
+
+  std::scoped_lock guard(mutex_);
+  SinkId sink = next_sink_id_++;
+  sinks_.emplace_back(sink, std::move(file));
+  return sink;
+}
+
+void Plugin::close_sink(SinkId sink) {
+  std::scoped_lock guard(mutex_);
+  // requests still writing to the file keep it mapped until they are released
+  std::erase_if(sinks_, [sink](auto const& item) { return item.first == sink; });
+}
+
+auto Plugin::sink_size(SinkId sink) const -> size_t {
+  std::shared_ptr<MappedFile> file = find_sink(sink);
+  return file != nullptr ? file->size() : 0;
+}
+
+auto Plugin::open_stream(GLuint texture, int miplevel, size_t slots, StreamDropPolicy policy,
+                         std::chrono::nanoseconds block_timeout, RequestOptions const& options) -> StreamId {
+  auto stream = std::make_shared<CaptureStream>(texture, miplevel, slots, policy, block_timeout, options);
+
   std::scoped_lock guard(mutex_);
+  StreamId id = next_stream_id_++;
+  streams_.emplace_back(id, std::move(stream));
+  return id;
+}
+
+void Plugin::close_stream(StreamId stream) {
+  std::scoped_lock guard(mutex_);
+  auto iter =
+      std::find_if(streams_.begin(), streams_.end(), [stream](auto const& item) { return item.first == stream; });
+  if (iter == streams_.end()) return;
+  iter->second->close();
+  closed_streams_.push_back(std::move(iter->second));
+  streams_.erase(iter);
+}
+
+auto Plugin::acquire_stream_frame(StreamId stream, StreamFrame& frame) -> bool {
+  std::shared_ptr<CaptureStream> capture = find_stream(stream);
+  return capture != nullptr && capture->acquire(frame);
+}
+
+auto Plugin::release_stream_frame(StreamId stream, uint64_t sequence) -> bool {
+  std::shared_ptr<CaptureStream> capture = find_stream(stream);
+  return capture != nullptr && capture->release(sequence);
+}
+
+auto Plugin::stream_stats(StreamId stream, StreamStats& stats) const -> bool {
+  std::shared_ptr<CaptureStream> capture = find_stream(stream);
+  if (capture == nullptr) return false;
+  stats = capture->stats();
+  return true;
+}
+
+void Plugin::arm_streams() {
+  std::vector<std::shared_ptr<CaptureStream>> streams;
+  {
+    std::scoped_lock guard(mutex_);
+    if (streams_.empty() && closed_streams_.empty()) return;
+    streams.reserve(streams_.size());
+    for (auto const& [id, stream] : streams_) streams.push_back(stream);
+    std::erase_if(closed_streams_, [this](std::shared_ptr<CaptureStream> const& stream) {
+      if (!stream->is_idle()) return false;
+      stream->take_staging_buffers(retired_staging_);
+      return true;
+    });
+  }
+
+  // arming may block with kStreamBlock, so it happens outside of the lock
+  for (auto const& stream : streams) {
+    std::shared_ptr<StreamSlot> slot = stream->arm();
+    if (slot == nullptr) continue;
 
-  // Remove tasks that are done in the last update.
-  if (!pending_release_.empty()) {
-    std::erase_if(requests_, [this](Request const& request) {
-      auto iter = std::lower_bound(pending_release_.cbegin(), pending_release_.cend(), request.id);
-      bool erased = iter != pending_release_.cend() && *iter == request.id;
-      if (erased && on_destruct_ != nullptr) on_destruct_(request.id);
-      return erased;
+    auto task = std::make_shared<FrameTask>(slot);
+    task->init(stream->texture(), stream->miplevel());
+    // the continuation runs inside the task, which cannot go away before it returns
+    task->add_continuation([stream, slot, task = task.get()]() {
+      stream->on_captured(*slot, task->event_id(), task->has_error(), task->size());
     });
-    pending_release_.clear();
+    static_cast<void>(insert(std::move(task), stream->options()));
+  }
+}
+
+void Plugin::delete_retired_staging() {
+  std::vector<std::pair<GLuint, GLsizeiptr>> staging;
+  {
+    std::scoped_lock guard(mutex_);
+    if (retired_staging_.empty()) return;
+    staging.swap(retired_staging_);
+  }
+  for (auto [pbo, size] : staging) {
+    stats_.on_deleted(GLResource::kPbo);
+#ifdef READBACK_LEAK_CHECK
+    LeakCheck::on_deleted(GLResource::kPbo, pbo);
+#endif
+    glDeleteBuffers(1, &pbo);
+    stats_.on_staging_released(static_cast<size_t>(size));
+  }
+}
+
+void Plugin::set_on_complete_batch(RequestBatchCallbackPtr ptr) {
+  on_complete_batch_ = ptr;
+  if (ptr == nullptr) {
+    std::scoped_lock guard(main_thread_mutex_);
+    completed_.clear();
+  }
+}
+
+void Plugin::update_once() {
+  Tracer::name_thread("main");
+  Tracer::Scope scope("update_once");
+  stats_.update();
+
+  // delivered before any of the requests can be released below, requests are queued before they are marked delivered
+  // so the batch holding an id always goes out no later than the update that releases it
+  std::vector<EventId> completed;
+  std::vector<std::function<void()>> jobs;
+  {
+    std::scoped_lock guard(main_thread_mutex_);
+    completed.swap(completed_);
+    jobs.swap(main_thread_jobs_);
+  }
+  if (RequestBatchCallbackPtr on_complete_batch = on_complete_batch_; on_complete_batch != nullptr) {
+    if (!completed.empty()) on_complete_batch(completed.data(), completed.size());
+  }
+  for (auto const& job : jobs) job();
+
+  std::vector<EventId> released;
+  {
+    std::scoped_lock guard(mutex_);
+
+    // Remove tasks that are done in the last update.
+    if (!pending_release_.empty()) {
+      std::erase_if(requests_, [this](Request const& request) {
+        auto iter = std::lower_bound(pending_release_.cbegin(), pending_release_.cend(), request.id);
+        bool release = iter != pending_release_.cend() && *iter == request.id;
+        if (!release) return false;
+        request.task->stamp(Stage::kReleased);
+        if (kTimingsEnabled) record_released_timings(request);
+        return true;
+      });
+      released.swap(pending_release_);
+    }
+
+    // Push tasks whose completion has been reported to pending list.
+    for (auto& request : requests_) {
+      if (request.task->is_delivered()) { pending_release_.push_back(request.id); }
+    }
   }
 
-  // Push new done tasks to pending list.
-  for (auto& request : requests_) {
-    if (request.task->is_done()) { pending_release_.push_back(request.id); }
+  // callbacks run outside of the lock so that they cannot hold up queries from other threads
+  if (RequestCallbackPtr on_destruct = on_destruct_; on_destruct != nullptr) {
+    for (EventId event_id : released) on_destruct(event_id);
   }
 
+  arm_streams();
+
   assert(issue_plugin_event_ != nullptr);
   issue_plugin_event_([](EventId /* event_id */) { instance().update_render_thread_once(); }, 0);
 }
 
+void Plugin::record_released_timings(Request const& request) {
+  if (released_timings_.size() == kReleasedTimingsHistory) released_timings_.pop_front();
+  released_timings_.emplace_back(request.id, request.task->timings());
+}
+
+auto Plugin::get_timings(EventId event_id, RequestTimings& timings) const -> bool {
+  if (!kTimingsEnabled) return false;
+  std::shared_lock guard(mutex_);
+  if (auto iter = find(event_id); iter != requests_.cend()) {
+    timings = iter->task->timings();
+    return true;
+  }
+  auto iter = std::find_if(released_timings_.crbegin(), released_timings_.crend(),
+                           [event_id](auto const& item) { return item.first == event_id; });
+  if (iter == released_timings_.crend()) return false;
+  timings = iter->second;
+  return true;
+}
+
 auto Plugin::get_data(EventId event_id, void*& buffer, size_t& length) -> bool {
-  std::scoped_lock guard(mutex_);
+  std::shared_lock guard(mutex_);
   auto iter = find(event_id);
 
   // Do something only if initialized (thread safety)
@@ -323,13 +1273,48 @@ auto Plugin::get_data(EventId event_id, void*& buffer, size_t& length) -> bool {
   return true;
 }
 
+auto Plugin::get_sink_offset(EventId event_id, size_t& offset) -> bool {
+  std::shared_lock guard(mutex_);
+  auto iter = find(event_id);
+
+  if (iter == requests_.cend() || !iter->task->is_done() || iter->task->has_error() || !iter->task->has_sink())
+      [[unlikely]] {
+    return false;
+  }
+
+  offset = iter->task->sink_offset();
+  return true;
+}
+
+auto Plugin::get_hash(EventId event_id, uint64_t& hash) -> bool {
+  std::shared_lock guard(mutex_);
+  auto iter = find(event_id);
+
+  if (iter == requests_.cend() || !iter->task->is_done() || iter->task->has_error() ||
+      (iter->task->options().post_process & kPostProcessHash) == 0) [[unlikely]] {
+    return false;
+  }
+
+  hash = iter->task->hash();
+  return true;
+}
+
+auto Plugin::get_encoded_data(EventId event_id, void*& buffer, size_t& length) -> bool {
+  std::shared_lock guard(mutex_);
+  auto iter = find(event_id);
+  if (iter == requests_.cend()) [[unlikely]] { return false; }
+
+  buffer = iter->task->get_encoded_data(length);
+  return buffer != nullptr;
+}
+
 auto Plugin::exists(EventId event_id) const -> bool {
-  std::scoped_lock guard(mutex_);
+  std::shared_lock guard(mutex_);
   return find(event_id) != requests_.cend();
 }
 
 auto Plugin::is_done(EventId event_id) const -> bool {
-  std::scoped_lock guard(mutex_);
+  std::shared_lock guard(mutex_);
   auto ite = find(event_id);
   if (ite != requests_.cend()) [[likely]]
     return ite->task->is_done();
@@ -337,7 +1322,7 @@ auto Plugin::is_done(EventId event_id) const -> bool {
 }
 
 auto Plugin::has_error(EventId event_id) const -> bool {
-  std::scoped_lock guard(mutex_);
+  std::shared_lock guard(mutex_);
   auto ite = find(event_id);
   if (ite != requests_.end()) [[likely]]
     return ite->task->has_error();
@@ -345,56 +1330,342 @@ auto Plugin::has_error(EventId event_id) const -> bool {
   return true;  // It's disposed, assume as error.
 }
 
-void Plugin::wait_for_completion(EventId event_id) const {
-  std::shared_ptr<BaseTask> task;
+auto Plugin::wait_for_completion(EventId event_id, std::chrono::nanoseconds timeout) -> bool {
+  return wait(&event_id, 1, true, timeout, nullptr);
+}
+
+auto Plugin::wait_all(EventId const* event_ids, size_t count, std::chrono::nanoseconds timeout, bool* completed)
+    -> bool {
+  return wait(event_ids, count, true, timeout, completed);
+}
+
+auto Plugin::wait_any(EventId const* event_ids, size_t count, std::chrono::nanoseconds timeout, bool* completed)
+    -> bool {
+  return wait(event_ids, count, false, timeout, completed);
+}
 
-  // get the task first
+auto Plugin::wait(EventId const* event_ids, size_t count, bool wait_all, std::chrono::nanoseconds timeout,
+                  bool* completed) -> bool {
+  // requests that no longer exist count as done
+  std::vector<std::shared_ptr<BaseTask>> tasks;
   {
-    std::scoped_lock guard(mutex_);
-    auto iter = find(event_id);
-    if (iter == requests_.cend() || iter->task->is_done()) return;
-    task = iter->task;
+    std::shared_lock guard(mutex_);
+    for (size_t i = 0; i < count; ++i) {
+      auto iter = find(event_ids[i]);
+      if (iter != requests_.cend() && !iter->task->is_done()) tasks.push_back(iter->task);
+    }
   }
 
-  // using example from https://en.cppreference.com/w/cpp/thread/condition_variable
-  static std::condition_variable cv;
+  bool satisfied = wait_all ? tasks.empty() : tasks.size() < count;
+  if (!satisfied && !tasks.empty()) {
+    assert(issue_plugin_event_ != nullptr);
+    Tracer::Scope scope("wait");
 
-  assert(issue_plugin_event_ != nullptr);
+    auto group = std::make_shared<WaitGroup>(std::move(tasks), wait_all);
+    for (auto const& task : group->tasks()) task->add_waiter(group);
 
-  issue_plugin_event_(
-      [](EventId id) {
-        Plugin& plugin = instance();
+    int group_id = 0;
+    {
+      std::scoped_lock guard(mutex_);
+      group_id = next_wait_group_id_++;
+      wait_groups_.emplace_back(group_id, group);
+    }
+
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point now = Clock::now();
+    Clock::time_point deadline = timeout >= Clock::time_point::max() - now ? Clock::time_point::max() : now + timeout;
+    while (true) {
+      // keep one bounded wait in flight on the render thread, requests may also complete from the readback thread, a
+      // worker or the regular update
+      if (group->begin_render_wait()) {
+        issue_plugin_event_([](int id) { instance().wait_on_render_thread(id); }, group_id);
+      }
+
+      Clock::time_point wake = std::min(deadline, Clock::now() + kRenderWaitSlice);
+      satisfied = group->wait_until(wake);
+      if (satisfied || wake == deadline) break;
+    }
 
-        std::shared_ptr<BaseTask> task;
-        {
-          std::scoped_lock guard(plugin.mutex_);
-          task = plugin.find(id)->task;
-        }
+    std::scoped_lock guard(mutex_);
+    std::erase_if(wait_groups_, [group_id](auto const& item) { return item.first == group_id; });
+  }
 
-        task->wait_for_completion();
+  if (completed != nullptr) {
+    std::shared_lock guard(mutex_);
+    for (size_t i = 0; i < count; ++i) {
+      auto iter = find(event_ids[i]);
+      completed[i] = iter == requests_.cend() || iter->task->is_done();
+    }
+  }
+  return satisfied;
+}
 
-        cv.notify_one();
-      },
-      event_id);
+void Plugin::wait_on_render_thread(int group_id) {
+  Tracer::Scope scope("render_wait");
+  std::shared_ptr<WaitGroup> group;
+  {
+    std::shared_lock guard(mutex_);
+    auto iter = std::find_if(wait_groups_.cbegin(), wait_groups_.cend(),
+                             [group_id](auto const& item) { return item.first == group_id; });
+    if (iter == wait_groups_.cend()) return;
+    group = iter->second;
+  }
 
-  std::mutex mutex;
-  std::unique_lock lock(mutex);
-  cv.wait(lock, [&task]() { return task->is_done(); });
+  // requests may still be held back by the scheduler, the readback thread completes the ones it takes over
+  bool threaded = false;
+  for (auto const& task : group->tasks()) threaded |= start(task);
+  if (threaded) glFlush();
+
+  // fences signal in the order they were issued, so the newest fence covers all requests and the oldest any of them
+  auto is_pending = [](BaseTask const& task) {
+    return task.is_initialized() && !task.is_threaded() && !task.is_retrieved();
+  };
+  std::shared_ptr<BaseTask> key = nullptr;
+  for (auto const& task : group->tasks()) {
+    if (!is_pending(*task)) continue;
+    bool newer = key == nullptr || task->issue_order() > key->issue_order();
+    bool older = key == nullptr || task->issue_order() < key->issue_order();
+    if (group->waits_for_all() ? newer : older) key = task;
+  }
 
-  if (on_complete_ != nullptr) on_complete_(event_id);
+  if (key != nullptr && key->wait_for_completion(static_cast<GLuint64>(kRenderWaitSlice.count()))) {
+    finish(key->event_id(), key);
+    for (auto const& task : group->tasks()) {
+      if (is_pending(*task) && task->wait_for_completion(0)) finish(task->event_id(), task);
+    }
+  }
+
+  group->end_render_wait();
 }
 
 void Plugin::update_render_thread_once() {
-  std::scoped_lock guard(mutex_);
-  for (auto const& request : requests_) {
-    auto const& task = request.task;
-    if (task != nullptr && task->is_initialized() && !task->is_done()) {
+  Tracer::name_thread("render");
+  Tracer::Scope scope("render_update");
+  // both clocks drift, so the offset is queried again by the first request timed in this update
+  gpu_clock_calibrated_ = false;
+  update_readback_thread();
+  update_debug_messages();
+  delete_retired_staging();
+  scheduler_.begin_frame();
+  issue_pending();
+  poll_in_flight();
+}
+
+void Plugin::poll_in_flight() {
+  // requests retrieved by a wait event in the meantime have already been finished
+  while (!in_flight_.empty() && in_flight_.front()->is_retrieved()) in_flight_.pop_front();
+  if (in_flight_.empty()) return;
+
+  // fences signal in the order they were issued, once the newest one has signalled all of them have
+  if (poll_newest_only_) {
+    if (!in_flight_.back()->is_signalled()) return;
+
+    for (auto const& task : in_flight_) {
+      if (!task->is_retrieved() && task->wait_for_completion(0)) finish(task->event_id(), task);
+    }
+    std::erase_if(in_flight_, [](std::shared_ptr<BaseTask> const& task) { return task->is_retrieved(); });
+    return;
+  }
+
+  // otherwise stop at the first fence that has not signalled yet, so the cost is proportional to the completed requests
+  while (!in_flight_.empty()) {
+    std::shared_ptr<BaseTask> const& task = in_flight_.front();
+    if (!task->is_retrieved()) {
       task->update();
-      if (on_complete_ != nullptr && task->is_done()) on_complete_(request.id);
+      if (!task->is_retrieved()) break;
+      finish(task->event_id(), task);
     }
+    in_flight_.pop_front();
   }
 }
 
+void Plugin::finish(EventId event_id, std::shared_ptr<BaseTask> const& task) {
+  if (task->has_error() || !task->needs_post_process()) {
+    complete(event_id, task);
+    return;
+  }
+
+  post([this, event_id, task]() {
+    Tracer::Scope scope("post_process");
+    task->post_process(event_id, post_process_callback_.load());
+    complete(event_id, task);
+  });
+}
+
+void Plugin::complete(EventId event_id, std::shared_ptr<BaseTask> const& task) {
+  task->set_done();
+  if (!task->mark_completed()) return;
+  stats_.on_completed(stats_.frame() - task->submit_frame(), task->size(), task->has_error());
+  stats_.on_stalls(task->flag_stalls(stall_threshold_ns_.load(std::memory_order_relaxed)));
+  notify_done(event_id);
+  // only now can update_once() release the request, so its destruct callback cannot overtake the ones above
+  task->mark_delivered();
+}
+
+void Plugin::notify_done(EventId event_id) {
+  if (on_complete_batch_.load() != nullptr) {
+    std::scoped_lock guard(main_thread_mutex_);
+    completed_.push_back(event_id);
+  }
+  if (RequestCallbackPtr on_complete = on_complete_; on_complete != nullptr) on_complete(event_id);
+}
+
+void Plugin::when_done(EventId event_id, Executor executor, std::function<void(ReadbackResult)> continuation) {
+  std::shared_ptr<BaseTask> task;
+  {
+    std::shared_lock guard(mutex_);
+    auto iter = find(event_id);
+    if (iter != requests_.cend()) task = iter->task;
+  }
+
+  if (task == nullptr) [[unlikely]] {
+    dispatch(executor, [event_id, continuation = std::move(continuation)]() { continuation({event_id, nullptr}); });
+    return;
+  }
+
+  // weak so that a request that never completes does not keep itself alive through its own continuation
+  task->add_continuation([this, event_id, executor, weak_task = std::weak_ptr<BaseTask>(task),
+                          continuation = std::move(continuation)]() {
+    dispatch(executor, [event_id, task = weak_task.lock(), continuation]() { continuation({event_id, task}); });
+  });
+}
+
+void Plugin::dispatch(Executor executor, std::function<void()> job) {
+  if (executor == Executor::kWorkerPool) {
+    post(std::move(job));
+    return;
+  }
+  std::scoped_lock guard(main_thread_mutex_);
+  main_thread_jobs_.emplace_back(std::move(job));
+}
+
+ReadbackResult::ReadbackResult(EventId event_id, std::shared_ptr<BaseTask> task)
+    : event_id_(event_id), task_(std::move(task)) {
+  if (task_ == nullptr) return;
+  data_ = task_->get_data(size_);
+  error_ = data_ == nullptr;
+}
+
+void ReadbackAwaitable::await_suspend(std::coroutine_handle<> handle) {
+  Plugin::instance().when_done(event_id_, executor_, [this, handle](ReadbackResult result) {
+    result_ = std::move(result);
+    handle.resume();
+  });
+}
+
+void Plugin::set_worker_count(size_t count) {
+  std::shared_ptr<WorkerPool> old;
+  {
+    std::scoped_lock guard(workers_mutex_);
+    worker_count_ = count;
+    old = std::move(workers_);
+  }
+  // joined outside of the lock so that running jobs can still post
+  old.reset();
+}
+
+void Plugin::post(std::function<void()> job) {
+  std::scoped_lock guard(workers_mutex_);
+  if (workers_ == nullptr) workers_ = std::make_shared<WorkerPool>(worker_count_);
+  workers_->submit(std::move(job));
+}
+
+void Plugin::shutdown() {
+  readback_thread_.reset();
+  readback_thread_active_ = false;
+#ifdef READBACK_LEAK_CHECK
+  // the context is about to go, objects still alive are leaked
+  LeakCheck::report(stderr);
+#endif
+}
+
+void Plugin::device_shutdown() {
+  // the driver would otherwise call into the unloaded plugin
+  debug_messages_.uninstall();
+}
+
+void Plugin::update_readback_thread() {
+  bool enabled = readback_thread_enabled_;
+  if (enabled && readback_thread_ == nullptr && !readback_thread_failed_) {
+    // Unity's context is current on the render thread so this is the only place the shared context can be created
+    readback_thread_ = ReadbackThread<BaseTask>::start(
+        SharedContext::create(),
+        [this](EventId event_id, std::shared_ptr<BaseTask> const& task) { finish(event_id, task); });
+    readback_thread_failed_ = readback_thread_ == nullptr;
+  } else if (!enabled) {
+    // retrieves the requests it still holds before returning
+    readback_thread_.reset();
+    readback_thread_failed_ = false;
+  }
+  readback_thread_active_ = readback_thread_ != nullptr;
+}
+
+void Plugin::update_debug_messages() {
+  bool enabled = debug_message_capture_;
+  if (enabled == debug_messages_.is_installed()) return;
+  if (enabled) {
+    // stays off until requested again if the context has no KHR_debug
+    if (!debug_messages_.install()) debug_message_capture_ = false;
+  } else {
+    debug_messages_.uninstall();
+  }
+}
+
+auto Plugin::performance_message(size_t index, std::string& message) const -> bool {
+  return debug_messages_.message(index, message);
+}
+
+auto Plugin::get_stalls(EventId event_id, RequestStalls& stalls) const -> bool {
+  std::shared_lock guard(mutex_);
+  auto iter = find(event_id);
+  if (iter == requests_.cend()) return false;
+  stalls = iter->task->stalls();
+  return true;
+}
+
+auto Plugin::start(std::shared_ptr<BaseTask> const& task) -> bool {
+  if (task->is_started()) return false;
+  // waits start their requests ahead of the scheduler
+  scheduler_.remove(*task);
+  task->set_issue_order(issue_count_++);
+  // marked before starting so that the copy is not timed with queries the readback thread cannot read
+  if (readback_thread_ != nullptr) task->set_threaded();
+  task->start_request([this]() { return gpu_clock_offset(); });
+  if (!task->is_initialized()) {
+    // failed before the copy was issued, nothing else will complete it
+    if (task->has_error()) complete(task->event_id(), task);
+    return false;
+  }
+  if (readback_thread_ == nullptr) {
+    in_flight_.push_back(task);
+    return false;
+  }
+
+  readback_thread_->push(task->event_id(), task);
+  return true;
+}
+
+auto Plugin::gpu_clock_offset() -> int64_t {
+#ifdef READBACK_TIMINGS
+  if (!gpu_clock_calibrated_) {
+    GLint64 gpu_now = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+    gpu_clock_offset_ = static_cast<int64_t>(now_ns()) - gpu_now;
+    gpu_clock_calibrated_ = true;
+  }
+#endif
+  return gpu_clock_offset_;
+}
+
+void Plugin::issue_pending() {
+  Tracer::Scope scope("issue_pending");
+  bool threaded = false;
+  scheduler_.issue([this, &threaded](std::shared_ptr<BaseTask> const& task) { threaded |= start(task); });
+
+  // the fences are waited on from another context, which cannot flush this one
+  if (threaded) glFlush();
+}
+
 auto Plugin::insert_pos(EventId event_id) const -> Plugin::request_iterator {
   return std::lower_bound(requests_.cbegin(), requests_.cend(), event_id,
                           [](Request const& task, EventId id) noexcept { return task.id < id; });
@@ -407,39 +1678,65 @@ auto Plugin::find(EventId event_id) const -> Plugin::request_iterator {
   return requests_.cend();
 }
 
-auto Plugin::insert(std::shared_ptr<BaseTask> task) -> EventId {
-  EventId event_id = next_event_id_++;
+auto Plugin::find_sink(SinkId sink) const -> std::shared_ptr<MappedFile> {
+  std::shared_lock guard(mutex_);
+  auto iter = std::find_if(sinks_.cbegin(), sinks_.cend(), [sink](auto const& item) { return item.first == sink; });
+  if (iter == sinks_.cend()) [[unlikely]]
+    return nullptr;
+  return iter->second;
+}
+
+auto Plugin::find_stream(StreamId stream) const -> std::shared_ptr<CaptureStream> {
+  std::shared_lock guard(mutex_);
+  auto iter =
+      std::find_if(streams_.cbegin(), streams_.cend(), [stream](auto const& item) { return item.first == stream; });
+  if (iter == streams_.cend()) [[unlikely]]
+    return nullptr;
+  return iter->second;
+}
+
+auto Plugin::insert(std::shared_ptr<BaseTask> task, RequestOptions const& options) -> EventId {
+  // set before the task is published, a wait on its id may start it on the render thread right away
+  task->set_options(options);
 
+  EventId event_id = 0;
   {
     std::scoped_lock guard(mutex_);
 
-    if (requests_.empty() || requests_.back().id < event_id) [[likely]] {
-      requests_.emplace_back(Request{
-          .id = event_id,
-          .task = std::move(task),
-      });
-    } else {
-      // in the unlikely event of overflow
-      requests_.insert(insert_pos(event_id), Request{
-                                                 .id = event_id,
-                                                 .task = std::move(task),
-                                             });
+    while (true) {
+      event_id = next_event_id_++;
+      task->set_event_id(event_id);
+      if (requests_.empty() || requests_.back().id < event_id) [[likely]] {
+        requests_.emplace_back(Request{
+            .id = event_id,
+            .task = task,
+        });
+        break;
+      }
+
+      // in the unlikely event of overflow, ids still held by long-lived requests are skipped
+      auto pos = insert_pos(event_id);
+      if (pos != requests_.cend() && pos->id == event_id) continue;
+      requests_.insert(pos, Request{
+                                .id = event_id,
+                                .task = task,
+                            });
+      break;
     }
+
+    task->stamp(Stage::kSubmitted);
+    task->set_statistics(&stats_, stats_.frame());
+    stats_.on_submitted();
   }
 
+  // requests that fail on creation are never started, they are reported like any other so that batch callbacks and
+  // waiters see them, outside of the lock as the callbacks may query them
+  if (task->is_done()) complete(event_id, task);
+
+  scheduler_.push(std::move(task), options);
+
   assert(issue_plugin_event_ != nullptr);
-  issue_plugin_event_(
-      [](EventId id) {
-        Plugin& plugin = instance();
-
-        std::shared_ptr<BaseTask> task;
-        {
-          std::scoped_lock guard(plugin.mutex_);
-          task = plugin.find(id)->task;  // always valid id
-        }
-        task->start_request();
-      },
-      event_id);
+  issue_plugin_event_([](EventId /* event_id */) { instance().issue_pending(); }, event_id);
 
   return event_id;
 }
@@ -1,14 +1,29 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
+#include <string>
 #include <vector>
 
+#include "DebugMessages.hpp"
 #include "OpenGLAsyncGPUReadbackPluginAPI.hpp"
+#include "ReadbackAwaitable.hpp"
+#include "ReadbackThread.hpp"
+#include "RequestScheduler.hpp"
+#include "Statistics.hpp"
 
 struct Request;
 class BaseTask;
+class CaptureStream;
+class MappedFile;
+class WaitGroup;
+class WorkerPool;
 
 class Plugin {
  public:
@@ -17,11 +32,12 @@ class Plugin {
   /** @brief Request data readback from a texture. Data will be destroyed on the next call to update_once() after the
    * request is complete
    *
-   * @param texture OpenGL texture id
+   * @param texture OpenGL texture id, only 2D textures can be read back, requests for other targets fail
    * @param miplevel
+   * @param options scheduling options
    * @return event_id request handle
    */
-  [[nodiscard]] auto request_texture(GLuint texture, int miplevel) -> EventId;
+  [[nodiscard]] auto request_texture(GLuint texture, int miplevel, RequestOptions const& options = {}) -> EventId;
 
   /**
    * @brief Request data readback from a texture into an existing array
@@ -29,18 +45,44 @@ class Plugin {
    * @param size size in bytes of buffer
    * @param texture OpenGL texture id
    * @param miplevel
+   * @param options scheduling options
    * @return event_id request handle
    */
-  [[nodiscard]] auto request_texture(void* buffer, size_t size, GLuint texture, int miplevel) -> EventId;
+  [[nodiscard]] auto request_texture(void* buffer, size_t size, GLuint texture, int miplevel,
+                                     RequestOptions const& options = {}) -> EventId;
+
+  /**
+   * @brief Request data readback from a texture straight into the next free region of an output file
+   * @param sink output file handle returned by open_sink()
+   * @param texture OpenGL texture id
+   * @param miplevel
+   * @param options scheduling options
+   * @return event_id request handle, the request has an error if the sink does not exist or is full
+   */
+  [[nodiscard]] auto request_texture_into_sink(SinkId sink, GLuint texture, int miplevel,
+                                               RequestOptions const& options = {}) -> EventId;
+
+  /**
+   * @brief Request data readback from a texture, encode it on a worker thread and write the image to a file
+   * @param path file path, existing files are overwritten
+   * @param texture OpenGL texture id
+   * @param miplevel
+   * @param options scheduling options, the encoding is picked from the extension of path if it is kEncodingNone
+   * @return event_id request handle, the request has an error if no encoding is given or known for the extension
+   */
+  [[nodiscard]] auto request_texture_to_file(std::filesystem::path const& path, GLuint texture, int miplevel,
+                                             RequestOptions options = {}) -> EventId;
 
   /**
    * @brief Request data readback from a compute buffer. Data will be destroyed on the next call to update_once() after
    * the request is complete
    * @param compute_buffer OpenGL compute buffer id
    * @param buffer_size compute buffer size in bytes
+   * @param options scheduling options
    * @return event_id request handle
    */
-  [[nodiscard]] auto request_compute_buffer(GLuint compute_buffer, GLint buffer_size) -> EventId;
+  [[nodiscard]] auto request_compute_buffer(GLuint compute_buffer, GLsizeiptr buffer_size,
+                                            RequestOptions const& options = {}) -> EventId;
 
   /**
    * @brief Request data readback from a compute buffer into an existing array.
@@ -48,10 +90,132 @@ class Plugin {
    * @param size size in bytes of buffer
    * @param compute_buffer OpenGL compute buffer id
    * @param buffer_size compute buffer size in bytes
+   * @param options scheduling options
    * @return
    */
-  [[nodiscard]] auto request_compute_buffer(void* buffer, size_t size, GLuint compute_buffer, GLint buffer_size)
-      -> EventId;
+  [[nodiscard]] auto request_compute_buffer(void* buffer, size_t size, GLuint compute_buffer, GLsizeiptr buffer_size,
+                                            RequestOptions const& options = {}) -> EventId;
+
+  /**
+   * @brief Request data readback from a compute buffer straight into the next free region of an output file
+   * @param sink output file handle returned by open_sink()
+   * @param compute_buffer OpenGL compute buffer id
+   * @param buffer_size compute buffer size in bytes
+   * @param options scheduling options
+   * @return event_id request handle, the request has an error if the sink does not exist or is full
+   */
+  [[nodiscard]] auto request_compute_buffer_into_sink(SinkId sink, GLuint compute_buffer, GLsizeiptr buffer_size,
+                                                      RequestOptions const& options = {}) -> EventId;
+
+  /**
+   * @brief Request data readback from a texture and await its completion, for use with co_await
+   * @param texture OpenGL texture id
+   * @param miplevel
+   * @param executor where the awaiting coroutine resumes
+   * @param options scheduling options
+   * @return awaitable for the request
+   */
+  [[nodiscard]] auto request_texture_async(GLuint texture, int miplevel, Executor executor = Executor::kWorkerPool,
+                                           RequestOptions const& options = {}) -> ReadbackAwaitable {
+    return completion(request_texture(texture, miplevel, options), executor);
+  }
+
+  /**
+   * @brief Request data readback from a compute buffer and await its completion, for use with co_await
+   * @param compute_buffer OpenGL compute buffer id
+   * @param buffer_size compute buffer size in bytes
+   * @param executor where the awaiting coroutine resumes
+   * @param options scheduling options
+   * @return awaitable for the request
+   */
+  [[nodiscard]] auto request_compute_buffer_async(GLuint compute_buffer, GLsizeiptr buffer_size,
+                                                  Executor executor = Executor::kWorkerPool,
+                                                  RequestOptions const& options = {}) -> ReadbackAwaitable {
+    return completion(request_compute_buffer(compute_buffer, buffer_size, options), executor);
+  }
+
+  /**
+   * @brief Await the completion of any request, for use with co_await
+   * @param event_id request id
+   * @param executor where the awaiting coroutine resumes
+   * @return awaitable for the request
+   */
+  [[nodiscard]] static auto completion(EventId event_id, Executor executor = Executor::kWorkerPool) noexcept
+      -> ReadbackAwaitable {
+    return {event_id, executor};
+  }
+
+  /**
+   * @brief Run a function once a request is done, requests that do not exist count as done with an error
+   * @param event_id request id
+   * @param executor where the function runs
+   * @param continuation function called with the result of the request
+   */
+  void when_done(EventId event_id, Executor executor, std::function<void(ReadbackResult)> continuation);
+
+  /**
+   * @brief Create a memory-mapped output file that completed readbacks are appended to
+   * @param path file path, existing files are overwritten
+   * @param capacity maximum size of the file in bytes
+   * @return sink handle or kInvalidSinkId if the file could not be created
+   */
+  [[nodiscard]] auto open_sink(std::filesystem::path const& path, size_t capacity) -> SinkId;
+
+  /**
+   * @brief Close an output file, it is truncated to the appended size once all requests writing to it are released
+   * @param sink sink handle
+   */
+  void close_sink(SinkId sink);
+
+  /**
+   * @param sink sink handle
+   * @return number of bytes appended to the output file so far
+   */
+  [[nodiscard]] auto sink_size(SinkId sink) const -> size_t;
+
+  /**
+   * @brief Read a texture back on every update_once() into a fixed ring of slots, whose staging buffers and result
+   * storage are reused from capture to capture
+   * @param texture OpenGL texture id
+   * @param miplevel
+   * @param slots number of frames in flight and waiting for the consumer, at least 1
+   * @param policy what to do when every slot is in use
+   * @param block_timeout longest time update_once() waits for a slot with kStreamBlock
+   * @param options options of every capture
+   * @return stream handle
+   */
+  [[nodiscard]] auto open_stream(GLuint texture, int miplevel, size_t slots, StreamDropPolicy policy,
+                                 std::chrono::nanoseconds block_timeout, RequestOptions const& options = {})
+      -> StreamId;
+
+  /**
+   * @brief Stop capturing, the staging buffers are deleted once the captures in flight are done
+   * @param stream stream handle
+   */
+  void close_stream(StreamId stream);
+
+  /**
+   * @brief Take the oldest captured frame of a stream that has not been acquired yet
+   * @param stream stream handle
+   * @param frame
+   * @return false if the stream does not exist or has no frame ready
+   */
+  auto acquire_stream_frame(StreamId stream, StreamFrame& frame) -> bool;
+
+  /**
+   * @brief Hand an acquired frame back to its stream so that its slot can be captured into again
+   * @param stream stream handle
+   * @param sequence sequence number of the frame
+   * @return false if the stream does not exist or the frame is not acquired
+   */
+  auto release_stream_frame(StreamId stream, uint64_t sequence) -> bool;
+
+  /**
+   * @param stream stream handle
+   * @param stats
+   * @return false if the stream does not exist
+   */
+  auto stream_stats(StreamId stream, StreamStats& stats) const -> bool;
 
   /**
    * @brief Set the pointer to GL.IssuePluginEvent as the interface does not export it, must be called prior to
@@ -61,17 +225,117 @@ class Plugin {
   void set_issue_plugin_event(GL_IssuePluginEventPtr ptr) noexcept { issue_plugin_event_ = ptr; }
 
   /**
-   * @brief Set callback function when a request is completed, called from the render thread
+   * @brief Limit how much readback work is issued per frame. Requests over the budget are held back and issued in
+   * priority order in later frames. 0 means unlimited, which is the default
+   * @param bytes maximum number of bytes issued per frame
+   * @param count maximum number of requests issued per frame
+   */
+  void set_frame_budget(size_t bytes, size_t count) noexcept { scheduler_.set_budget(bytes, count); }
+
+  /**
+   * @brief Retrieve completed requests on a dedicated thread with its own context shared with Unity's, so that the
+   * render thread only issues the copies and fences. Takes effect on the next update, falls back to retrieving on the
+   * render thread if the shared context cannot be created. Disabling it blocks the render thread until the requests
+   * held by the readback thread are retrieved, for at most a second after which the rest fail
+   * @param enabled
+   */
+  void set_readback_thread_enabled(bool enabled) noexcept { readback_thread_enabled_ = enabled; }
+
+  /**
+   * @brief Only poll the newest in-flight fence each frame and retrieve all requests at once when it has signalled.
+   * Saves a fence query per completed request at the cost of older requests completing up to a frame later
+   * @param enabled
+   */
+  void set_poll_newest_only(bool enabled) noexcept { poll_newest_only_ = enabled; }
+
+  /**
+   * @brief Flag requests that spend longer than the threshold in a single kind of blocking GL call as stalled, see
+   * RequestStalls
+   * @param threshold_ns in nanoseconds, 0 disables flagging
+   */
+  void set_stall_threshold(uint64_t threshold_ns) noexcept { stall_threshold_ns_ = threshold_ns; }
+
+  /**
+   * @brief Capture KHR_debug performance messages of the render thread context, installed and removed on the next
+   * render thread update
+   * @param enabled
+   */
+  void set_debug_message_capture(bool enabled) noexcept { debug_message_capture_ = enabled; }
+
+  /**
+   * @param index 0 for the most recent captured message
+   * @param message
+   * @return false if fewer messages were captured
+   */
+  auto performance_message(size_t index, std::string& message) const -> bool;
+
+  /**
+   * @brief Set the id given to the next request, lets tests reach the wraparound without 2^32 requests
+   * @param event_id
+   */
+  void set_next_event_id(EventId event_id) noexcept { next_event_id_ = event_id; }
+
+  /**
+   * @return true if the readback thread is running
+   */
+  [[nodiscard]] auto is_readback_thread_active() const noexcept -> bool { return readback_thread_active_; }
+
+  /**
+   * @brief Stop the readback thread, called when the plugin is unloaded. Builds with READBACK_LEAK_CHECK report the GL
+   * objects still alive here
+   */
+  void shutdown();
+
+  /**
+   * @brief Remove the GL state pointing into the plugin before Unity's context goes away, called on the render thread
+   * with the context current. Debug message capture is installed again on the next update if it is still enabled
+   */
+  void device_shutdown();
+
+  /**
+   * @brief Set callback function when a request is completed, called from the render thread, the readback thread or
+   * from a worker thread for post-processed requests
    * @param ptr
    */
   void set_on_complete(RequestCallbackPtr ptr) noexcept { on_complete_ = ptr; }
 
+  /**
+   * @brief Set callback function for requests completed since the previous update, called from update_once() on the
+   * main thread with all of their ids at once instead of once per request from the thread that completed them
+   * @param ptr
+   */
+  void set_on_complete_batch(RequestBatchCallbackPtr ptr);
+
+  /**
+   * @brief Set callback function run on a worker thread for requests with kPostProcessCallback, before they are
+   * reported as done
+   * @param ptr
+   */
+  void set_post_process_callback(PostProcessCallbackPtr ptr) noexcept { post_process_callback_ = ptr; }
+
+  /**
+   * @brief Set the number of worker threads used for post-processing, the pool is recreated on next use
+   * @param count number of threads, 0 picks half of the hardware threads
+   */
+  void set_worker_count(size_t count);
+
+  /**
+   * @brief Run a job on the post-processing worker pool
+   * @param job
+   */
+  void post(std::function<void()> job);
+
   /**
    * @brief Set callback function when a request is disposed
    * @param ptr
    */
   void set_on_destruct(RequestCallbackPtr ptr) noexcept { on_destruct_ = ptr; }
 
+  /**
+   * @return aggregate statistics, updated without locks
+   */
+  [[nodiscard]] auto statistics() noexcept -> Statistics& { return stats_; }
+
   /** @brief Update in main thread.
    * This will erase tasks that are marked as done in last frame.
    * Also save tasks that are done this frame.
@@ -89,6 +353,47 @@ class Plugin {
    */
   auto get_data(EventId event_id, void*& buffer, size_t& length) -> bool;
 
+  /**
+   * @brief Get the location of the request data in its output file
+   * @param event_id request id
+   * @param offset offset in bytes of the data from the start of the file
+   * @return true if the request is done and was written to an output file
+   */
+  auto get_sink_offset(EventId event_id, size_t& offset) -> bool;
+
+  /**
+   * @brief Get the hash of the request data
+   * @param event_id request id
+   * @param hash XXH64 hash of the data
+   * @return true if the request is done and was created with kPostProcessHash
+   */
+  auto get_hash(EventId event_id, uint64_t& hash) -> bool;
+
+  /**
+   * @brief Get the encoded image of a texture request
+   * @param event_id request id
+   * @param buffer pointer to the encoded image
+   * @param length size in bytes of the encoded image
+   * @return true if the request is done and was created with an encoding
+   */
+  auto get_encoded_data(EventId event_id, void*& buffer, size_t& length) -> bool;
+
+  /**
+   * @brief Get the lifecycle timestamps of a request
+   * @param event_id request id, the timings of the last kReleasedTimingsHistory released requests are kept
+   * @param timings
+   * @return true if the request was found and the plugin is built with READBACK_TIMINGS
+   */
+  auto get_timings(EventId event_id, RequestTimings& timings) const -> bool;
+
+  /**
+   * @brief Get the time a request spent in blocking GL calls
+   * @param event_id request id
+   * @param stalls
+   * @return true if the request exists
+   */
+  auto get_stalls(EventId event_id, RequestStalls& stalls) const -> bool;
+
   /**
    * @brief Check if the request exists
    * @param event_id request id
@@ -111,27 +416,144 @@ class Plugin {
   [[nodiscard]] auto has_error(EventId event_id) const -> bool;
 
   /**
-   * @brief Block and wait for the request to complete
+   * @brief Block and wait for the request to complete. The render thread never blocks on the request for longer than a
+   * millisecond at a time
    * @param event_id request id
+   * @param timeout maximum time to wait
+   * @return true if the request is done or no longer exists, false if the wait timed out
+   */
+  auto wait_for_completion(EventId event_id, std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max())
+      -> bool;
+
+  /**
+   * @brief Block until all of the requests are complete. A single render thread wait on the newest fence covers the
+   * whole set
+   * @param event_ids request ids
+   * @param count number of request ids
+   * @param timeout maximum time to wait
+   * @param completed optional array of count flags, set to whether each request is done when the wait returns
+   * @return true if all requests are done or no longer exist, false if the wait timed out
+   */
+  auto wait_all(EventId const* event_ids, size_t count, std::chrono::nanoseconds timeout, bool* completed = nullptr)
+      -> bool;
+
+  /**
+   * @brief Block until any of the requests is complete
+   * @param event_ids request ids
+   * @param count number of request ids
+   * @param timeout maximum time to wait
+   * @param completed optional array of count flags, set to whether each request is done when the wait returns
+   * @return true if a request is done or no longer exists, false if the wait timed out
    */
-  void wait_for_completion(EventId event_id) const;
+  auto wait_any(EventId const* event_ids, size_t count, std::chrono::nanoseconds timeout, bool* completed = nullptr)
+      -> bool;
 
  private:
   Plugin() noexcept = default;
 
-  mutable std::mutex mutex_;
+  // guards the request registry, sinks and streams, queries only take it shared and no GL or copy work happens under it
+  mutable std::shared_mutex mutex_;
   std::vector<Request> requests_;
   std::vector<EventId> pending_release_;
+  // timings of released requests, oldest first, only recorded with READBACK_TIMINGS
+  static constexpr size_t kReleasedTimingsHistory = 256;
+  std::deque<std::pair<EventId, RequestTimings>> released_timings_;
+  // wraps around to negative ids, only incremented under mutex_
   std::atomic<EventId> next_event_id_ = 0;
+  std::vector<std::pair<SinkId, std::shared_ptr<MappedFile>>> sinks_;
+  SinkId next_sink_id_ = 0;
+  std::vector<std::pair<StreamId, std::shared_ptr<CaptureStream>>> streams_;
+  StreamId next_stream_id_ = 0;
+  // closed streams with captures in flight, their staging buffers are deleted once these are done
+  std::vector<std::shared_ptr<CaptureStream>> closed_streams_;
+  // staging buffers of closed streams with their size, deleted on the next render thread update
+  std::vector<std::pair<GLuint, GLsizeiptr>> retired_staging_;
   GL_IssuePluginEventPtr issue_plugin_event_ = nullptr;
-  RequestCallbackPtr on_complete_ = nullptr;
-  RequestCallbackPtr on_destruct_ = nullptr;
+  // set from the main thread, called from the render thread and the worker pool
+  std::atomic<RequestCallbackPtr> on_complete_ = nullptr;
+  std::atomic<RequestCallbackPtr> on_destruct_ = nullptr;
+  std::atomic<RequestBatchCallbackPtr> on_complete_batch_ = nullptr;
+  std::atomic<PostProcessCallbackPtr> post_process_callback_ = nullptr;
+  RequestScheduler<BaseTask> scheduler_;
+  Statistics stats_;
+
+  std::mutex workers_mutex_;
+  std::shared_ptr<WorkerPool> workers_;
+  size_t worker_count_ = 0;
+
+  // threads blocked in wait(), found by id from the render thread wait events
+  std::vector<std::pair<int, std::shared_ptr<WaitGroup>>> wait_groups_;
+  int next_wait_group_id_ = 0;
+
+  std::atomic<bool> poll_newest_only_ = false;
+  // a millisecond inside a call that should return right away is well past any driver bookkeeping
+  static constexpr uint64_t kDefaultStallThreshold = 1'000'000;
+  std::atomic<uint64_t> stall_threshold_ns_ = kDefaultStallThreshold;
+  std::atomic<bool> debug_message_capture_ = false;
+  // only installed and removed on the render thread
+  DebugMessages debug_messages_{stats_};
+
+  // work handed to the main thread for the next update_once(), separate from mutex_ so that completing threads never
+  // wait on the registry: ids completed while a batch callback is set and continuations awaiting requests
+  std::mutex main_thread_mutex_;
+  std::vector<EventId> completed_;
+  std::vector<std::function<void()>> main_thread_jobs_;
+
+  // owned by the render thread
+  uint64_t issue_count_ = 0;
+  // GL_TIMESTAMP is a synchronous round-trip on many drivers, so the offset converting GPU timestamps to now_ns() is
+  // queried by the first request timed in a render update and shared by the rest
+  int64_t gpu_clock_offset_ = 0;
+  bool gpu_clock_calibrated_ = false;
+  // requests retrieved on the render thread in the order they were issued
+  std::deque<std::shared_ptr<BaseTask>> in_flight_;
+  std::unique_ptr<ReadbackThread<BaseTask>> readback_thread_;
+  bool readback_thread_failed_ = false;
+  std::atomic<bool> readback_thread_enabled_ = false;
+  std::atomic<bool> readback_thread_active_ = false;
 
   void update_render_thread_once();
+  auto gpu_clock_offset() -> int64_t;
+  /**
+   * @brief Submit the captures of the streams for this frame, called from update_once()
+   */
+  void arm_streams();
+  void delete_retired_staging();
+  void poll_in_flight();
+  auto wait(EventId const* event_ids, size_t count, bool wait_all, std::chrono::nanoseconds timeout, bool* completed)
+      -> bool;
+  void wait_on_render_thread(int group_id);
+  void update_readback_thread();
+  void update_debug_messages();
+  /**
+   * @brief Start a task that has not been started yet and hand it to the readback thread if there is one
+   * @return true if the readback thread took the task over
+   */
+  auto start(std::shared_ptr<BaseTask> const& task) -> bool;
+  void issue_pending();
+  void finish(EventId event_id, std::shared_ptr<BaseTask> const& task);
+
+  /**
+   * @brief Mark a task done, account for it and notify, only then can update_once() release it
+   */
+  void complete(EventId event_id, std::shared_ptr<BaseTask> const& task);
+  void notify_done(EventId event_id);
+
+  /**
+   * @brief Keep the timings of a request that is being released for get_timings()
+   */
+  void record_released_timings(Request const& request);
+
+  /**
+   * @brief Run a job on the worker pool or queue it for the next update_once()
+   */
+  void dispatch(Executor executor, std::function<void()> job);
 
   using request_iterator = typename std::vector<Request>::const_iterator;
 
   [[nodiscard]] auto insert_pos(EventId event_id) const -> request_iterator;
   [[nodiscard]] auto find(EventId event_id) const -> request_iterator;
-  auto insert(std::shared_ptr<BaseTask> task) -> EventId;
+  [[nodiscard]] auto find_sink(SinkId sink) const -> std::shared_ptr<MappedFile>;
+  [[nodiscard]] auto find_stream(StreamId stream) const -> std::shared_ptr<CaptureStream>;
+  auto insert(std::shared_ptr<BaseTask> task, RequestOptions const& options) -> EventId;
 };
@@ -1,6 +1,12 @@
 #include "OpenGLAsyncGPUReadbackPluginAPI.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+
 #include "OpenGLAsyncGPUReadbackPlugin.hpp"
+#include "Tracer.hpp"
 
 static IUnityGraphics* graphics = nullptr;
 static UnityGfxRenderer renderer = kUnityGfxRendererNull;
@@ -21,18 +27,29 @@ void UnityPluginLoad(IUnityInterfaces* unityInterfaces) {
   if (CheckCompatible()) { glewInit(); }
 }
 
-void UnityPluginUnload() { graphics->UnregisterDeviceEventCallback(OnGraphicsDeviceEvent); }
+void UnityPluginUnload() {
+  Plugin::instance().shutdown();
+  graphics->UnregisterDeviceEventCallback(OnGraphicsDeviceEvent);
+}
 
 void OnGraphicsDeviceEvent(UnityGfxDeviceEventType eventType) {
   // Create graphics API implementation upon initialization
   if (eventType == kUnityGfxDeviceEventInitialize) { renderer = graphics->GetRenderer(); }
 
   // Cleanup graphics API implementation upon shutdown
-  if (eventType == kUnityGfxDeviceEventShutdown) { renderer = kUnityGfxRendererNull; }
+  if (eventType == kUnityGfxDeviceEventShutdown) {
+    // runs on the render thread with the context still current
+    if (CheckCompatible()) Plugin::instance().device_shutdown();
+    renderer = kUnityGfxRendererNull;
+  }
 }
 
 auto CheckCompatible() -> bool { return (renderer == kUnityGfxRendererOpenGLCore); }
 
+static auto to_timeout(uint64_t timeout_ns) -> std::chrono::nanoseconds {
+  return std::chrono::nanoseconds(std::min<uint64_t>(timeout_ns, std::chrono::nanoseconds::max().count()));
+}
+
 auto Request_Texture(GLuint texture, int miplevel) -> EventId {
   return Plugin::instance().request_texture(texture, miplevel);
 }
@@ -41,20 +58,97 @@ auto Request_TextureIntoArray(void* data, size_t size, GLuint texture, int miple
   return Plugin::instance().request_texture(data, size, texture, miplevel);
 }
 
-auto Request_ComputeBuffer(GLuint computeBuffer, GLint bufferSize) -> EventId {
+auto Request_ComputeBuffer(GLuint computeBuffer, GLsizeiptr bufferSize) -> EventId {
   return Plugin::instance().request_compute_buffer(computeBuffer, bufferSize);
 }
 
-auto Request_ComputeBufferIntoArray(void* data, size_t size, GLuint computeBuffer, GLint bufferSize) -> EventId {
+auto Request_ComputeBufferIntoArray(void* data, size_t size, GLuint computeBuffer, GLsizeiptr bufferSize) -> EventId {
   return Plugin::instance().request_compute_buffer(data, size, computeBuffer, bufferSize);
 }
 
+auto Request_TextureWithOptions(void* data, size_t size, GLuint texture, int miplevel, RequestOptions const* options)
+    -> EventId {
+  RequestOptions opts = options != nullptr ? *options : RequestOptions{};
+  if (data == nullptr) return Plugin::instance().request_texture(texture, miplevel, opts);
+  return Plugin::instance().request_texture(data, size, texture, miplevel, opts);
+}
+
+auto Request_ComputeBufferWithOptions(void* data, size_t size, GLuint computeBuffer, GLsizeiptr bufferSize,
+                                      RequestOptions const* options) -> EventId {
+  RequestOptions opts = options != nullptr ? *options : RequestOptions{};
+  if (data == nullptr) return Plugin::instance().request_compute_buffer(computeBuffer, bufferSize, opts);
+  return Plugin::instance().request_compute_buffer(data, size, computeBuffer, bufferSize, opts);
+}
+
+auto Request_TextureIntoSink(SinkId sink, GLuint texture, int miplevel) -> EventId {
+  return Plugin::instance().request_texture_into_sink(sink, texture, miplevel);
+}
+
+auto Request_ComputeBufferIntoSink(SinkId sink, GLuint computeBuffer, GLsizeiptr bufferSize) -> EventId {
+  return Plugin::instance().request_compute_buffer_into_sink(sink, computeBuffer, bufferSize);
+}
+
+auto Request_TextureToFile(char const* path, GLuint texture, int miplevel, RequestOptions const* options) -> EventId {
+  RequestOptions opts = options != nullptr ? *options : RequestOptions{};
+  std::filesystem::path file;
+  if (path != nullptr) file = std::u8string(reinterpret_cast<char8_t const*>(path));  // NOLINT: utf-8 path
+  return Plugin::instance().request_texture_to_file(file, texture, miplevel, opts);
+}
+
+auto Sink_Open(char const* path, size_t capacity) -> SinkId {
+  if (path == nullptr) return kInvalidSinkId;
+  std::filesystem::path file(std::u8string(reinterpret_cast<char8_t const*>(path)));  // NOLINT: utf-8 path
+  return Plugin::instance().open_sink(file, capacity);
+}
+
+void Sink_Close(SinkId sink) { Plugin::instance().close_sink(sink); }
+
+auto Sink_Size(SinkId sink) -> size_t { return Plugin::instance().sink_size(sink); }
+
+auto Stream_Open(GLuint texture, int miplevel, size_t slots, unsigned drop_policy, uint64_t block_timeout_ns,
+                 RequestOptions const* options) -> StreamId {
+  if (drop_policy > kStreamBlock) return kInvalidStreamId;
+  RequestOptions opts = options != nullptr ? *options : RequestOptions{};
+  return Plugin::instance().open_stream(texture, miplevel, slots, static_cast<StreamDropPolicy>(drop_policy),
+                                        to_timeout(block_timeout_ns), opts);
+}
+
+void Stream_Close(StreamId stream) { Plugin::instance().close_stream(stream); }
+
+auto Stream_AcquireFrame(StreamId stream, StreamFrame* frame) -> bool {
+  if (frame == nullptr) return false;
+  return Plugin::instance().acquire_stream_frame(stream, *frame);
+}
+
+auto Stream_ReleaseFrame(StreamId stream, uint64_t sequence) -> bool {
+  return Plugin::instance().release_stream_frame(stream, sequence);
+}
+
+auto Stream_GetStats(StreamId stream, StreamStats* stats) -> bool {
+  if (stats == nullptr) return false;
+  return Plugin::instance().stream_stats(stream, *stats);
+}
+
 void SetGLIssuePluginEventPtr(GL_IssuePluginEventPtr ptr) { Plugin::instance().set_issue_plugin_event(ptr); }
 
 void SetOnCompleteCallbackPtr(RequestCallbackPtr ptr) { Plugin::instance().set_on_complete(ptr); }
 
+void SetOnCompleteBatchCallbackPtr(RequestBatchCallbackPtr ptr) { Plugin::instance().set_on_complete_batch(ptr); }
+
 void SetOnDestructCallbackPtr(RequestCallbackPtr ptr) { Plugin::instance().set_on_destruct(ptr); }
 
+void SetFrameBudget(size_t bytes, size_t count) { Plugin::instance().set_frame_budget(bytes, count); }
+
+void SetPostProcessCallbackPtr(PostProcessCallbackPtr ptr) { Plugin::instance().set_post_process_callback(ptr); }
+
+void SetWorkerThreadCount(size_t count) { Plugin::instance().set_worker_count(count); }
+
+void SetReadbackThreadEnabled(bool enabled) { Plugin::instance().set_readback_thread_enabled(enabled); }
+
+void SetPollNewestFenceOnly(bool enabled) { Plugin::instance().set_poll_newest_only(enabled); }
+
+auto IsReadbackThreadActive() -> bool { return Plugin::instance().is_readback_thread_active(); }
+
 void MainThread_UpdateOnce() { Plugin::instance().update_once(); }
 
 auto Request_GetData(EventId event_id, void** buffer, size_t* length) -> bool {
@@ -62,6 +156,59 @@ auto Request_GetData(EventId event_id, void** buffer, size_t* length) -> bool {
   return Plugin::instance().get_data(event_id, *buffer, *length);
 }
 
+auto Request_GetSinkOffset(EventId event_id, size_t* offset) -> bool {
+  if (offset == nullptr) return false;
+  return Plugin::instance().get_sink_offset(event_id, *offset);
+}
+
+auto Request_GetHash(EventId event_id, uint64_t* hash) -> bool {
+  if (hash == nullptr) return false;
+  return Plugin::instance().get_hash(event_id, *hash);
+}
+
+auto Request_GetEncodedData(EventId event_id, void** buffer, size_t* length) -> bool {
+  if (buffer == nullptr || length == nullptr) return false;
+  return Plugin::instance().get_encoded_data(event_id, *buffer, *length);
+}
+
+auto Plugin_GetStats(PluginStats* stats) -> bool {
+  if (stats == nullptr) return false;
+  *stats = Plugin::instance().statistics().snapshot();
+  return true;
+}
+
+void Plugin_SetTracing(bool enabled) { Tracer::set_enabled(enabled); }
+
+auto Plugin_DumpTrace(char const* path) -> bool {
+  if (path == nullptr) return false;
+  return Tracer::dump(std::filesystem::path(std::u8string(reinterpret_cast<char8_t const*>(path))));  // NOLINT
+}
+
+void Plugin_SetStallThreshold(uint64_t threshold_ns) { Plugin::instance().set_stall_threshold(threshold_ns); }
+
+void Plugin_SetDebugMessageCapture(bool enabled) { Plugin::instance().set_debug_message_capture(enabled); }
+
+auto Plugin_GetPerformanceMessage(size_t index, char* buffer, size_t size) -> size_t {
+  std::string message;
+  if (!Plugin::instance().performance_message(index, message)) return 0;
+  if (buffer != nullptr && size > 0) {
+    size_t length = std::min(message.size(), size - 1);
+    std::memcpy(buffer, message.data(), length);
+    buffer[length] = '\0';
+  }
+  return message.size();
+}
+
+auto Request_GetTimings(EventId event_id, RequestTimings* timings) -> bool {
+  if (timings == nullptr) return false;
+  return Plugin::instance().get_timings(event_id, *timings);
+}
+
+auto Request_GetStalls(EventId event_id, RequestStalls* stalls) -> bool {
+  if (stalls == nullptr) return false;
+  return Plugin::instance().get_stalls(event_id, *stalls);
+}
+
 auto Request_Exists(EventId event_id) -> bool { return Plugin::instance().exists(event_id); }
 
 auto Request_Done(EventId event_id) -> bool { return Plugin::instance().is_done(event_id); }
@@ -69,3 +216,17 @@ auto Request_Done(EventId event_id) -> bool { return Plugin::instance().is_done(
 auto Request_Error(EventId event_id) -> bool { return Plugin::instance().has_error(event_id); }
 
 void Request_WaitForCompletion(EventId event_id) { Plugin::instance().wait_for_completion(event_id); }
+
+auto Request_WaitForCompletionTimeout(EventId event_id, uint64_t timeout_ns) -> bool {
+  return Plugin::instance().wait_for_completion(event_id, to_timeout(timeout_ns));
+}
+
+auto Request_WaitAll(EventId const* event_ids, size_t count, uint64_t timeout_ns, bool* completed) -> bool {
+  if (event_ids == nullptr) return count == 0;
+  return Plugin::instance().wait_all(event_ids, count, to_timeout(timeout_ns), completed);
+}
+
+auto Request_WaitAny(EventId const* event_ids, size_t count, uint64_t timeout_ns, bool* completed) -> bool {
+  if (event_ids == nullptr) return false;
+  return Plugin::instance().wait_any(event_ids, count, to_timeout(timeout_ns), completed);
+}
@@ -6,11 +6,239 @@
 #include "Unity/IUnityInterface.h"
 
 using EventId = int;
+using SinkId = int;
+constexpr SinkId kInvalidSinkId = -1;
+using StreamId = int;
+constexpr StreamId kInvalidStreamId = -1;
 using GL_IssuePluginEventPtr = void(UNITY_INTERFACE_API*)(UnityRenderingEvent, EventId);
 using RequestCallbackPtr = void(UNITY_INTERFACE_API*)(EventId);
+using RequestBatchCallbackPtr = void(UNITY_INTERFACE_API*)(EventId const* event_ids, size_t count);
+using PostProcessCallbackPtr = void(UNITY_INTERFACE_API*)(EventId, void* data, size_t length);
 
 #define EXPORT_API UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API
 
+/**
+ * @brief Post-processing steps run on a worker thread before a request is reported as done
+ */
+enum PostProcessFlags : unsigned {
+  kPostProcessNone = 0,
+  /** @brief swap the red and blue components of texture data, RGB(A) <-> BGR(A) */
+  kPostProcessSwapRedBlue = 1U << 0U,
+  /** @brief compute the XXH64 hash of the data, see Request_GetHash */
+  kPostProcessHash = 1U << 1U,
+  /** @brief pass the data to the callback set with SetPostProcessCallbackPtr */
+  kPostProcessCallback = 1U << 2U,
+};
+
+/**
+ * @brief Changes to the data made while it is copied out of the staging buffer, at no extra cost
+ */
+enum CopyFlags : unsigned {
+  kCopyNone = 0,
+  /** @brief store texture rows top row first as images are, instead of bottom-up as OpenGL reads them. Ignored for
+   * buffers */
+  kCopyFlipRows = 1U << 0U,
+};
+
+/**
+ * @brief Image formats texture readbacks can be encoded to on a worker thread, see Request_GetEncodedData. Only
+ * textures with 8-bit unsigned components can be encoded, single component textures are encoded as grey
+ */
+enum ImageEncoding : unsigned {
+  kEncodingNone = 0,
+  /** @brief lossless and fastest to encode */
+  kEncodingQoi = 1,
+  /** @brief lossless */
+  kEncodingPng = 2,
+  /** @brief baseline with 4:2:0 chroma subsampling, drops alpha */
+  kEncodingJpeg = 3,
+};
+
+/**
+ * @brief 4:2:0 layouts texture readbacks can be converted to for video encoders, the data is replaced by the converted
+ * frame with the top row first. Only textures with 8-bit unsigned RGB(A) components can be converted
+ */
+enum YuvFormat : unsigned {
+  kYuvNone = 0,
+  /** @brief luma plane followed by one plane of interleaved U and V samples */
+  kYuvNv12 = 1,
+  /** @brief luma plane followed by the U and the V planes */
+  kYuvI420 = 2,
+};
+
+/**
+ * @brief Matrix and range of the YUV conversion
+ */
+enum YuvColorSpace : unsigned {
+  /** @brief BT.601 with luma in 16..235 and chroma in 16..240 */
+  kYuvBt601Limited = 0,
+  kYuvBt601Full = 1,
+  /** @brief BT.709 with luma in 16..235 and chroma in 16..240 */
+  kYuvBt709Limited = 2,
+  kYuvBt709Full = 3,
+};
+
+/**
+ * @brief Conversion of texture components to 32-bit floats, the data is replaced by the floats. Float textures are
+ * left as they are, integer textures fail
+ */
+enum FloatConversion : unsigned {
+  kFloatNone = 0,
+  /** @brief widen halves, scale normalized integers to [0, 1] or [-1, 1] and decode sRGB textures to linear */
+  kFloatConvert = 1,
+  /** @brief as kFloatConvert, but colour components of 8-bit unsigned normalized textures are always decoded from sRGB,
+   * for sRGB data in textures without an sRGB format. Alpha stays linear */
+  kFloatDecodeSrgb = 2,
+};
+
+/**
+ * @brief Per-request options, zero initialized options match the plain request functions
+ */
+struct RequestOptions {
+  /** @brief requests with higher priority are issued first when the frame budget is limited */
+  int priority = 0;
+  /** @brief number of frames after which the request is issued regardless of the frame budget, 0 for no deadline */
+  int deadline_frames = 0;
+  /** @brief combination of PostProcessFlags */
+  unsigned post_process = kPostProcessNone;
+  /** @brief ImageEncoding the texture data is encoded to after the post-processing steps */
+  unsigned encoding = kEncodingNone;
+  /** @brief JPEG quality from 1 to 100, 0 for the default of 90 */
+  int encode_quality = 0;
+  /** @brief combination of CopyFlags */
+  unsigned copy_flags = kCopyNone;
+  /** @brief YuvFormat the texture data is converted to before the other steps, fails with kPostProcessSwapRedBlue */
+  unsigned yuv_format = kYuvNone;
+  /** @brief YuvColorSpace of the conversion */
+  unsigned yuv_color_space = kYuvBt601Limited;
+  /** @brief FloatConversion of the texture data, after swapping red and blue and before the other steps */
+  unsigned float_conversion = kFloatNone;
+};
+
+/**
+ * @brief What a capture stream does when all of its slots are in use because the consumer falls behind. Frames are
+ * always skipped while captures in flight take up every slot
+ */
+enum StreamDropPolicy : unsigned {
+  /** @brief overwrite the oldest frame the consumer has not acquired yet */
+  kStreamDropOldest = 0,
+  /** @brief skip capturing the new frame */
+  kStreamDropNewest = 1,
+  /** @brief block MainThread_UpdateOnce until the consumer releases a frame, the new frame is skipped if none is
+   * released within the timeout. Frames have to be released from another thread for this to help */
+  kStreamBlock = 2,
+};
+
+/**
+ * @brief Frame of a capture stream handed to the consumer by Stream_AcquireFrame
+ */
+struct StreamFrame {
+  /** @brief frame data, valid until the frame is released or the stream is closed */
+  void* data = nullptr;
+  size_t length = 0;
+  /** @brief number of the capture since the stream was opened, passed to Stream_ReleaseFrame */
+  uint64_t sequence = 0;
+  /** @brief request that captured the frame, its queries work until it is released as for any other request */
+  EventId event_id = 0;
+};
+
+/**
+ * @brief Counters of a capture stream, see Stream_GetStats
+ */
+struct StreamStats {
+  /** @brief frames captured without error */
+  uint64_t captured = 0;
+  /** @brief frames lost to the drop policy, either overwritten or never captured */
+  uint64_t dropped = 0;
+  /** @brief captures that failed */
+  uint64_t errors = 0;
+  /** @brief frames waiting to be acquired */
+  uint64_t ready = 0;
+  /** @brief captures being read back */
+  uint64_t in_flight = 0;
+};
+
+/**
+ * @brief Lifecycle timestamps of a request in nanoseconds of a monotonic clock, 0 for stages that were not reached.
+ * Only recorded when the plugin is built with READBACK_TIMINGS
+ */
+struct RequestTimings {
+  /** @brief request created */
+  uint64_t submitted = 0;
+  /** @brief copy issued on the render thread */
+  uint64_t started = 0;
+  /** @brief GPU started and finished the copy, from GL_TIMESTAMP queries. Not recorded for requests retrieved by the
+   * readback thread as queries are not shared between contexts */
+  uint64_t gpu_copy_start = 0;
+  uint64_t gpu_copy_end = 0;
+  /** @brief fence observed as signalled */
+  uint64_t signalled = 0;
+  /** @brief staging buffer mapped */
+  uint64_t mapped = 0;
+  /** @brief data copied out of the staging buffer */
+  uint64_t copied = 0;
+  /** @brief reported as done, after post-processing */
+  uint64_t done = 0;
+  /** @brief erased by MainThread_UpdateOnce */
+  uint64_t released = 0;
+};
+
+/**
+ * @brief Time a request spent inside GL calls that return immediately while the readback stays asynchronous, see
+ * Request_GetStalls. Long times point at formats and sizes the driver cannot read back without stalling
+ */
+struct RequestStalls {
+  /** @brief nanoseconds in glMapBufferRange, summed over chunks */
+  uint64_t map_ns = 0;
+  /** @brief nanoseconds in glReadPixels, summed over bands of rows, only for textures */
+  uint64_t read_pixels_ns = 0;
+  /** @brief nanoseconds in glClientWaitSync, includes explicit waits such as Request_WaitForCompletion */
+  uint64_t client_wait_ns = 0;
+  /** @brief any of the above took longer than the threshold set with Plugin_SetStallThreshold, set once done */
+  bool stalled = false;
+};
+
+/**
+ * @brief Aggregate plugin statistics, see Plugin_GetStats. Rates and frames-to-done cover the last full second of
+ * MainThread_UpdateOnce calls
+ */
+struct PluginStats {
+  /** @brief requests created and not done yet */
+  uint64_t in_flight = 0;
+  /** @brief totals since the plugin was loaded */
+  uint64_t submitted = 0;
+  uint64_t completed = 0;
+  uint64_t errors = 0;
+  uint64_t bytes_completed = 0;
+  double completions_per_second = 0;
+  double bytes_per_second = 0;
+  /** @brief number of MainThread_UpdateOnce calls from creating a request until it is done */
+  double average_frames_to_done = 0;
+  uint64_t p99_frames_to_done = 0;
+  /** @brief size of the staging buffers currently allocated on the GPU */
+  uint64_t staging_bytes = 0;
+  /** @brief staging buffers created and result buffers allocated by the plugin since it was loaded */
+  uint64_t staging_allocations = 0;
+  uint64_t result_allocations = 0;
+  /** @brief GL objects currently held by requests */
+  uint64_t live_pbos = 0;
+  uint64_t live_fbos = 0;
+  uint64_t live_fences = 0;
+  /** @brief high-water marks of the above and of staging_bytes since the plugin was loaded */
+  uint64_t peak_pbos = 0;
+  uint64_t peak_fbos = 0;
+  uint64_t peak_fences = 0;
+  uint64_t peak_staging_bytes = 0;
+  /** @brief done requests flagged as stalled, see RequestStalls */
+  uint64_t stalled_requests = 0;
+  /** @brief RequestStalls times summed over all done requests */
+  uint64_t map_ns = 0;
+  uint64_t read_pixels_ns = 0;
+  uint64_t client_wait_ns = 0;
+  /** @brief KHR_debug performance messages captured, see Plugin_SetDebugMessageCapture */
+  uint64_t performance_messages = 0;
+};
+
 extern "C" {
 // plugin interface
 
@@ -30,23 +258,82 @@ void EXPORT_API UnityPluginUnload();
  */
 auto EXPORT_API CheckCompatible() -> bool;
 
-// requests
+// requests, textures have to be 2D, requests for other targets fail
 auto EXPORT_API Request_Texture(GLuint texture, int miplevel) -> EventId;
 auto EXPORT_API Request_TextureIntoArray(void* data, size_t size, GLuint texture, int miplevel) -> EventId;
-auto EXPORT_API Request_ComputeBuffer(GLuint computeBuffer, GLint bufferSize) -> EventId;
-auto EXPORT_API Request_ComputeBufferIntoArray(void* data, size_t size, GLuint computeBuffer, GLint bufferSize)
+auto EXPORT_API Request_ComputeBuffer(GLuint computeBuffer, GLsizeiptr bufferSize) -> EventId;
+auto EXPORT_API Request_ComputeBufferIntoArray(void* data, size_t size, GLuint computeBuffer, GLsizeiptr bufferSize)
+    -> EventId;
+auto EXPORT_API Request_TextureWithOptions(void* data, size_t size, GLuint texture, int miplevel,
+                                          RequestOptions const* options) -> EventId;
+auto EXPORT_API Request_ComputeBufferWithOptions(void* data, size_t size, GLuint computeBuffer, GLsizeiptr bufferSize,
+                                                RequestOptions const* options) -> EventId;
+auto EXPORT_API Request_TextureIntoSink(SinkId sink, GLuint texture, int miplevel) -> EventId;
+auto EXPORT_API Request_ComputeBufferIntoSink(SinkId sink, GLuint computeBuffer, GLsizeiptr bufferSize) -> EventId;
+// encodes the texture and writes the image to a UTF-8 encoded path, the encoding defaults to the file extension's
+auto EXPORT_API Request_TextureToFile(char const* path, GLuint texture, int miplevel, RequestOptions const* options)
     -> EventId;
 
+// memory-mapped output files, path is UTF-8 encoded
+auto EXPORT_API Sink_Open(char const* path, size_t capacity) -> SinkId;
+void EXPORT_API Sink_Close(SinkId sink);
+auto EXPORT_API Sink_Size(SinkId sink) -> size_t;
+
+// capture streams read a texture back every MainThread_UpdateOnce into a fixed ring of slots whose staging buffers
+// and result storage are reused, slots is the number of frames in flight and waiting for the consumer
+auto EXPORT_API Stream_Open(GLuint texture, int miplevel, size_t slots, unsigned drop_policy,
+                            uint64_t block_timeout_ns, RequestOptions const* options) -> StreamId;
+// frames still acquired are invalid afterwards, captures in flight complete and are discarded
+void EXPORT_API Stream_Close(StreamId stream);
+// takes the oldest ready frame, which keeps its slot until it is released
+auto EXPORT_API Stream_AcquireFrame(StreamId stream, StreamFrame* frame) -> bool;
+auto EXPORT_API Stream_ReleaseFrame(StreamId stream, uint64_t sequence) -> bool;
+auto EXPORT_API Stream_GetStats(StreamId stream, StreamStats* stats) -> bool;
+
 // plugin methods
 void EXPORT_API SetGLIssuePluginEventPtr(GL_IssuePluginEventPtr ptr);
 void EXPORT_API SetOnCompleteCallbackPtr(RequestCallbackPtr ptr);
+// called from MainThread_UpdateOnce with every request completed since the previous update
+void EXPORT_API SetOnCompleteBatchCallbackPtr(RequestBatchCallbackPtr ptr);
 void EXPORT_API SetOnDestructCallbackPtr(RequestCallbackPtr ptr);
+void EXPORT_API SetFrameBudget(size_t bytes, size_t count);
+void EXPORT_API SetPostProcessCallbackPtr(PostProcessCallbackPtr ptr);
+void EXPORT_API SetWorkerThreadCount(size_t count);
+void EXPORT_API SetReadbackThreadEnabled(bool enabled);
+void EXPORT_API SetPollNewestFenceOnly(bool enabled);
+auto EXPORT_API IsReadbackThreadActive() -> bool;
 void EXPORT_API MainThread_UpdateOnce();
+// lock-free, safe to poll from any thread
+auto EXPORT_API Plugin_GetStats(PluginStats* stats) -> bool;
+// records the request lifecycle and plugin threads until disabled
+void EXPORT_API Plugin_SetTracing(bool enabled);
+// writes the recorded events as Chrome trace_event JSON to a UTF-8 encoded path, with tracing on or off
+auto EXPORT_API Plugin_DumpTrace(char const* path) -> bool;
+// requests spending longer than threshold_ns in a single kind of blocking GL call are flagged as stalled, 0 disables
+void EXPORT_API Plugin_SetStallThreshold(uint64_t threshold_ns);
+// captures KHR_debug performance messages of Unity's context from the next render thread update, chains any callback
+// that was installed before, turn it off before the plugin is unloaded
+void EXPORT_API Plugin_SetDebugMessageCapture(bool enabled);
+// copies the index-th most recent captured message as a null-terminated string, returns its full length or 0 if there
+// is no such message
+auto EXPORT_API Plugin_GetPerformanceMessage(size_t index, char* buffer, size_t size) -> size_t;
 
 // request queries
 auto EXPORT_API Request_GetData(EventId event_id, void** buffer, size_t* length) -> bool;
+auto EXPORT_API Request_GetSinkOffset(EventId event_id, size_t* offset) -> bool;
+auto EXPORT_API Request_GetHash(EventId event_id, uint64_t* hash) -> bool;
+// the image encoded with RequestOptions::encoding, valid until the request is released
+auto EXPORT_API Request_GetEncodedData(EventId event_id, void** buffer, size_t* length) -> bool;
+// also available for recently released requests, false if the plugin is built without READBACK_TIMINGS
+auto EXPORT_API Request_GetTimings(EventId event_id, RequestTimings* timings) -> bool;
+auto EXPORT_API Request_GetStalls(EventId event_id, RequestStalls* stalls) -> bool;
 auto EXPORT_API Request_Exists(EventId event_id) -> bool;
 auto EXPORT_API Request_Done(EventId event_id) -> bool;
 auto EXPORT_API Request_Error(EventId event_id) -> bool;
 void EXPORT_API Request_WaitForCompletion(EventId event_id);
+// returns false if the request is still pending after timeout_ns nanoseconds
+auto EXPORT_API Request_WaitForCompletionTimeout(EventId event_id, uint64_t timeout_ns) -> bool;
+// completed is optional, filled with whether each of the count requests is done when the wait returns
+auto EXPORT_API Request_WaitAll(EventId const* event_ids, size_t count, uint64_t timeout_ns, bool* completed) -> bool;
+auto EXPORT_API Request_WaitAny(EventId const* event_ids, size_t count, uint64_t timeout_ns, bool* completed) -> bool;
 }
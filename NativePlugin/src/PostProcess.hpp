@@ -0,0 +1,167 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief Pixel layout of a texture readback, components of all zero for buffer readbacks
+ */
+struct PixelLayout {
+  int width = 0;
+  int height = 0;
+  /** @brief number of components per pixel */
+  int components = 0;
+  /** @brief size of a single component in bytes */
+  int component_size = 0;
+  /** @brief GL type of the components */
+  int type = 0;
+  /** @brief whether integer components stand for values in [0, 1] or [-1, 1] */
+  bool normalized = false;
+  /** @brief whether the colour components are sRGB encoded */
+  bool srgb = false;
+
+  [[nodiscard]] constexpr auto pixel_size() const noexcept -> size_t {
+    return static_cast<size_t>(components) * component_size;
+  }
+  [[nodiscard]] constexpr auto row_size() const noexcept -> size_t { return pixel_size() * width; }
+  [[nodiscard]] constexpr auto is_valid() const noexcept -> bool { return components > 0 && component_size > 0; }
+};
+
+namespace detail {
+template <class T>
+void swap_components(char* data, size_t count, size_t stride) noexcept {
+  for (size_t i = 0; i < count; ++i) {
+    T first;
+    T third;
+    std::memcpy(&first, data, sizeof(T));
+    std::memcpy(&third, data + 2 * sizeof(T), sizeof(T));
+    std::memcpy(data, &third, sizeof(T));
+    std::memcpy(data + 2 * sizeof(T), &first, sizeof(T));
+    data += stride;
+  }
+}
+}  // namespace detail
+
+/**
+ * @brief Swap the first and third components of every pixel in place, RGB(A) <-> BGR(A)
+ * @return false if the layout has fewer than 3 components
+ */
+inline auto swap_red_blue(void* data, size_t length, PixelLayout const& layout) noexcept -> bool {
+  if (layout.components < 3) return false;
+
+  auto* bytes = static_cast<char*>(data);
+  size_t stride = layout.pixel_size();
+  size_t count = length / stride;
+  switch (layout.component_size) {
+    case 1: detail::swap_components<uint8_t>(bytes, count, stride); return true;
+    case 2: detail::swap_components<uint16_t>(bytes, count, stride); return true;
+    case 4: detail::swap_components<uint32_t>(bytes, count, stride); return true;
+    default: return false;
+  }
+}
+
+/**
+ * @brief Copy a chunk of an image into dst with the order of its rows reversed, so that rows read back bottom-up end
+ * up top row first
+ * @param dst flipped image, bytes past size are cut off
+ * @param size size in bytes of dst
+ * @param rows number of rows of the image
+ * @param row_size size in bytes of a row
+ * @param offset offset in bytes of the chunk from the start of the unflipped image
+ * @param src chunk of the unflipped image, it may start and end mid-row
+ * @param length size in bytes of the chunk
+ */
+inline void copy_flipped(void* dst, size_t size, size_t rows, size_t row_size, size_t offset, void const* src,
+                         size_t length) noexcept {
+  if (row_size == 0) return;
+  auto* out = static_cast<char*>(dst);
+  auto const* in = static_cast<char const*>(src);
+  size_t end = std::min(offset + length, rows * row_size);
+  while (offset < end) {
+    // a single copy per row
+    size_t row = offset / row_size;
+    size_t column = offset % row_size;
+    size_t count = std::min(row_size - column, end - offset);
+    size_t target = (rows - 1 - row) * row_size + column;
+    if (target < size) std::memcpy(out + target, in, std::min(count, size - target));
+    in += count;
+    offset += count;
+  }
+}
+
+/**
+ * @brief 64-bit xxHash (XXH64) of a block of memory
+ */
+[[nodiscard]] inline auto xxh64(void const* data, size_t length, uint64_t seed = 0) noexcept -> uint64_t {
+  constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+  constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+  constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+  constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+  constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+  auto read64 = [](unsigned char const* p) noexcept {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+  };
+  auto read32 = [](unsigned char const* p) noexcept {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+  };
+  auto round = [](uint64_t acc, uint64_t input) noexcept {
+    acc += input * kPrime2;
+    acc = std::rotl(acc, 31);
+    return acc * kPrime1;
+  };
+  auto merge = [&round](uint64_t acc, uint64_t val) noexcept {
+    acc ^= round(0, val);
+    return acc * kPrime1 + kPrime4;
+  };
+
+  auto const* p = static_cast<unsigned char const*>(data);
+  auto const* const end = p + length;
+  uint64_t hash;
+
+  if (length >= 32) {
+    uint64_t v1 = seed + kPrime1 + kPrime2;
+    uint64_t v2 = seed + kPrime2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - kPrime1;
+    auto const* const limit = end - 32;
+    do {
+      v1 = round(v1, read64(p));
+      v2 = round(v2, read64(p + 8));
+      v3 = round(v3, read64(p + 16));
+      v4 = round(v4, read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+
+    hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+    hash = merge(hash, v1);
+    hash = merge(hash, v2);
+    hash = merge(hash, v3);
+    hash = merge(hash, v4);
+  } else {
+    hash = seed + kPrime5;
+  }
+
+  hash += static_cast<uint64_t>(length);
+
+  for (; p + 8 <= end; p += 8) hash = std::rotl(hash ^ round(0, read64(p)), 27) * kPrime1 + kPrime4;
+  if (p + 4 <= end) {
+    hash = std::rotl(hash ^ (static_cast<uint64_t>(read32(p)) * kPrime1), 23) * kPrime2 + kPrime3;
+    p += 4;
+  }
+  for (; p < end; ++p) hash = std::rotl(hash ^ (*p * kPrime5), 11) * kPrime1;
+
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  hash *= kPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "OpenGLAsyncGPUReadbackPluginAPI.hpp"
+
+class BaseTask;
+
+/**
+ * @brief Where code waiting on a request continues once it is done
+ */
+enum class Executor {
+  // post-processing worker pool
+  kWorkerPool,
+  // main thread, from the next Plugin::update_once()
+  kMainThread,
+};
+
+/**
+ * @brief Outcome of a completed request. Holds on to the request so that its data stays valid after the request is
+ * released by Plugin::update_once()
+ */
+class ReadbackResult {
+ public:
+  ReadbackResult() noexcept = default;
+  ReadbackResult(EventId event_id, std::shared_ptr<BaseTask> task);
+
+  [[nodiscard]] auto event_id() const noexcept -> EventId { return event_id_; }
+
+  /**
+   * @return true if the request failed or no longer existed when it was awaited
+   */
+  [[nodiscard]] auto has_error() const noexcept -> bool { return error_; }
+  [[nodiscard]] auto data() const noexcept -> void* { return data_; }
+  [[nodiscard]] auto size() const noexcept -> size_t { return size_; }
+
+ private:
+  EventId event_id_ = -1;
+  std::shared_ptr<BaseTask> task_ = nullptr;
+  void* data_ = nullptr;
+  size_t size_ = 0;
+  bool error_ = true;
+};
+
+/**
+ * @brief Awaitable for a request, returned by Plugin::completion() and the Plugin::*_async() requests
+ *
+ * The awaiting coroutine always resumes on the chosen executor, even if the request is already done, so that code
+ * after co_await never runs on the render thread or holds up the thread that awaited.
+ */
+class ReadbackAwaitable {
+ public:
+  ReadbackAwaitable(EventId event_id, Executor executor) noexcept : event_id_(event_id), executor_(executor) {}
+
+  [[nodiscard]] auto event_id() const noexcept -> EventId { return event_id_; }
+
+  [[nodiscard]] auto await_ready() const noexcept -> bool { return false; }
+  void await_suspend(std::coroutine_handle<> handle);
+  [[nodiscard]] auto await_resume() noexcept -> ReadbackResult { return std::move(result_); }
+
+ private:
+  EventId event_id_;
+  Executor executor_;
+  ReadbackResult result_;
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#include "OpenGLAsyncGPUReadbackPluginAPI.hpp"
+#include "SharedContext.hpp"
+#include "Tracer.hpp"
+
+/**
+ * @brief Thread owning a context shared with the render thread that waits for issued requests and retrieves their data
+ *
+ * Requests are retrieved in the order they were pushed, which is the order their fences were issued in. The render
+ * thread has to flush after issuing so that the fences can signal.
+ *
+ * @tparam Task task type, must provide wait_for_completion(GLuint64 timeout) returning false on timeout and abandon()
+ * failing a request whose fence has not signalled when the thread gives up on it
+ */
+template <class Task>
+class ReadbackThread {
+ public:
+  using Callback = std::function<void(EventId, std::shared_ptr<Task> const&)>;
+
+  /**
+   * @brief Start the thread and make the context current on it
+   * @param context context shared with the render thread
+   * @param on_retrieved called from the readback thread once the data of a request has been retrieved
+   * @return nullptr if the context could not be made current
+   */
+  [[nodiscard]] static auto start(std::unique_ptr<SharedContext> context, Callback on_retrieved)
+      -> std::unique_ptr<ReadbackThread> {
+    if (context == nullptr) return nullptr;
+
+    auto thread = std::unique_ptr<ReadbackThread>(new ReadbackThread(std::move(context), std::move(on_retrieved)));
+    std::promise<bool> current;
+    std::future<bool> started = current.get_future();
+    thread->thread_ = std::thread([self = thread.get(), current = std::move(current)]() mutable {
+      bool ok = self->context_->make_current();
+      if (!ok) self->context_.reset();
+      current.set_value(ok);
+      if (ok) self->run();
+    });
+
+    if (!started.get()) {
+      thread->thread_.join();
+      return nullptr;
+    }
+    return thread;
+  }
+
+  ReadbackThread(ReadbackThread const&) = delete;
+  ReadbackThread(ReadbackThread&&) = delete;
+  auto operator=(ReadbackThread const&) = delete;
+  auto operator=(ReadbackThread&&) = delete;
+
+  /**
+   * @brief Retrieves the pushed requests, failing those still pending after kShutdownTimeout, then joins the thread
+   * which destroys the context
+   */
+  ~ReadbackThread() noexcept {
+    {
+      std::scoped_lock guard(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_one();
+    if (thread_.joinable()) thread_.join();
+  }
+
+  /**
+   * @brief Hand over a started request
+   * @param event_id request id passed to the callback
+   * @param task
+   */
+  void push(EventId event_id, std::shared_ptr<Task> task) {
+    {
+      std::scoped_lock guard(mutex_);
+      queue_.emplace_back(event_id, std::move(task));
+    }
+    wake_.notify_one();
+  }
+
+ private:
+  /**
+   * @brief Upper bound of a single fence wait, the thread keeps waiting on the oldest request until it signals
+   */
+  static constexpr GLuint64 kWaitTimeout = 10'000'000;  // 10 ms in ns
+  /**
+   * @brief How long shutting down waits for the remaining requests, so that a hung GPU or lost context cannot block it
+   */
+  static constexpr std::chrono::seconds kShutdownTimeout{1};
+
+  std::unique_ptr<SharedContext> context_;
+  Callback on_retrieved_;
+  std::thread thread_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<std::pair<EventId, std::shared_ptr<Task>>> queue_;
+  bool stopping_ = false;
+
+  ReadbackThread(std::unique_ptr<SharedContext> context, Callback on_retrieved) noexcept
+      : context_(std::move(context)), on_retrieved_(std::move(on_retrieved)) {}
+
+  void run() {
+    Tracer::name_thread("readback");
+    std::optional<std::chrono::steady_clock::time_point> give_up;
+    while (true) {
+      std::pair<EventId, std::shared_ptr<Task>> front;
+      {
+        std::unique_lock lock(mutex_);
+        wake_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) break;
+        front = queue_.front();
+        if (stopping_ && !give_up) give_up = std::chrono::steady_clock::now() + kShutdownTimeout;
+      }
+
+      if (!front.second->wait_for_completion(kWaitTimeout)) {
+        if (!give_up || std::chrono::steady_clock::now() < *give_up) continue;
+        front.second->abandon();
+      }
+
+      {
+        std::scoped_lock guard(mutex_);
+        queue_.pop_front();
+      }
+      on_retrieved_(front.first, front.second);
+    }
+
+    context_->release();
+    // destroyed where it was current, the objects of its window system connection are only ever used from this thread
+    context_.reset();
+  }
+};
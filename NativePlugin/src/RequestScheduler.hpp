@@ -0,0 +1,179 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <unordered_map>
+
+#include "OpenGLAsyncGPUReadbackPluginAPI.hpp"
+
+/**
+ * @brief Holds requests until they can be issued on the render thread within per-frame byte and count budgets
+ *
+ * Requests are issued in priority order, first come first served within the same priority. A request that has waited
+ * longer than its deadline is issued regardless of the budgets, and the first request of a frame is always issued so
+ * that requests larger than the byte budget still make progress.
+ *
+ * @tparam Task task type, must provide prepare() returning the request size in bytes and has_error()
+ */
+template <class Task>
+class RequestScheduler {
+ public:
+  /**
+   * @brief Set per-frame budgets, 0 means unlimited
+   * @param bytes maximum number of bytes issued per frame
+   * @param count maximum number of requests issued per frame
+   */
+  void set_budget(size_t bytes, size_t count) noexcept {
+    max_bytes_ = bytes;
+    max_count_ = count;
+  }
+
+  void push(std::shared_ptr<Task> task, RequestOptions const& options) {
+    std::scoped_lock guard(mutex_);
+    Task const* key = task.get();
+    insert(key, Entry{
+                    .task = std::move(task),
+                    .priority = options.priority,
+                    .sequence = sequence_++,
+                    .deadline = options.deadline_frames > 0
+                                    ? std::optional(frame_ + static_cast<uint64_t>(options.deadline_frames))
+                                    : std::nullopt,
+                });
+  }
+
+  /**
+   * @brief Drop a task that was started without being issued from here, so that its result is not kept alive
+   */
+  void remove(Task const& task) {
+    std::scoped_lock guard(mutex_);
+    if (auto iter = entries_.find(&task); iter != entries_.end()) take(iter);
+  }
+
+  /**
+   * @brief Start a new frame and reset the budgets, called from the render thread
+   */
+  void begin_frame() {
+    std::scoped_lock guard(mutex_);
+    ++frame_;
+    bytes_ = 0;
+    count_ = 0;
+  }
+
+  /**
+   * @brief Issue as many pending requests as the budgets allow, called from the render thread
+   * @param start function starting a single task, called with std::shared_ptr<Task> const&
+   */
+  template <class Start>
+  void issue(Start&& start) {
+    // overdue requests ignore the budgets
+    while (std::optional<Entry> entry = pop_overdue()) {
+      GLsizeiptr size = entry->task->prepare();
+      start(entry->task);
+      account(*entry->task, size);
+    }
+
+    while (std::optional<Entry> entry = pop()) {
+      GLsizeiptr size = entry->task->prepare();
+      if (!entry->task->has_error() && !fits(size)) {
+        // put it back, its sequence keeps it at the front of its priority
+        std::scoped_lock guard(mutex_);
+        Task const* key = entry->task.get();
+        insert(key, std::move(*entry));
+        break;
+      }
+      start(entry->task);
+      account(*entry->task, size);
+    }
+  }
+
+  /**
+   * @return number of requests waiting to be issued
+   */
+  [[nodiscard]] auto pending() const -> size_t {
+    std::scoped_lock guard(mutex_);
+    return entries_.size();
+  }
+
+ private:
+  struct Entry {
+    std::shared_ptr<Task> task;
+    int priority;
+    uint64_t sequence;
+    std::optional<uint64_t> deadline;
+  };
+
+  struct IssuedBefore {
+    auto operator()(Entry const* lhs, Entry const* rhs) const noexcept -> bool {
+      if (lhs->priority != rhs->priority) return lhs->priority > rhs->priority;
+      return lhs->sequence < rhs->sequence;
+    }
+  };
+
+  struct DueBefore {
+    auto operator()(Entry const* lhs, Entry const* rhs) const noexcept -> bool {
+      if (*lhs->deadline != *rhs->deadline) return *lhs->deadline < *rhs->deadline;
+      return lhs->sequence < rhs->sequence;
+    }
+  };
+
+  using EntryMap = std::unordered_map<Task const*, Entry>;
+
+  mutable std::mutex mutex_;
+  // owns the waiting tasks, both orders point into it so that a task can be dropped from them once it starts
+  EntryMap entries_;
+  std::set<Entry const*, IssuedBefore> queue_;
+  // only tasks with a deadline
+  std::set<Entry const*, DueBefore> deadlines_;
+  uint64_t frame_ = 0;
+  uint64_t sequence_ = 0;
+
+  std::atomic<size_t> max_bytes_ = 0;
+  std::atomic<size_t> max_count_ = 0;
+  size_t bytes_ = 0;
+  size_t count_ = 0;
+
+  void insert(Task const* key, Entry entry) {
+    Entry const& stored = entries_.try_emplace(key, std::move(entry)).first->second;
+    queue_.insert(&stored);
+    if (stored.deadline) deadlines_.insert(&stored);
+  }
+
+  auto take(typename EntryMap::iterator iter) -> Entry {
+    queue_.erase(&iter->second);
+    if (iter->second.deadline) deadlines_.erase(&iter->second);
+    Entry entry = std::move(iter->second);
+    entries_.erase(iter);
+    return entry;
+  }
+
+  auto pop_overdue() -> std::optional<Entry> {
+    std::scoped_lock guard(mutex_);
+    if (deadlines_.empty() || *(*deadlines_.begin())->deadline > frame_) return std::nullopt;
+    return take(entries_.find((*deadlines_.begin())->task.get()));
+  }
+
+  auto pop() -> std::optional<Entry> {
+    std::scoped_lock guard(mutex_);
+    if (queue_.empty()) return std::nullopt;
+    return take(entries_.find((*queue_.begin())->task.get()));
+  }
+
+  [[nodiscard]] auto fits(GLsizeiptr size) const noexcept -> bool {
+    if (count_ == 0) return true;
+
+    size_t max_count = max_count_;
+    size_t max_bytes = max_bytes_;
+    if (max_count != 0 && count_ >= max_count) return false;
+    return max_bytes == 0 || bytes_ + static_cast<size_t>(size) <= max_bytes;
+  }
+
+  void account(Task const& task, GLsizeiptr size) noexcept {
+    if (task.has_error()) return;
+    ++count_;
+    bytes_ += static_cast<size_t>(size);
+  }
+};
@@ -0,0 +1,336 @@
+#include "SharedContext.hpp"
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+#if defined(_WIN32)
+#  include <GL/wglew.h>
+#elif defined(__APPLE__)
+#  include <OpenGL/OpenGL.h>
+#else
+#  include <GL/glxew.h>
+#endif
+
+#if defined(READBACK_HAS_EGL)
+#  include <EGL/egl.h>
+#endif
+
+namespace {
+
+/**
+ * @brief Version and profile of the current context so that the shared context matches it
+ */
+struct ContextVersion {
+  GLint major = 0;
+  GLint minor = 0;
+  GLint profile = 0;
+
+  static auto current() noexcept -> ContextVersion {
+    ContextVersion version;
+    glGetIntegerv(GL_MAJOR_VERSION, &version.major);
+    glGetIntegerv(GL_MINOR_VERSION, &version.minor);
+    glGetIntegerv(GL_CONTEXT_PROFILE_MASK, &version.profile);
+    return version;
+  }
+};
+
+#if defined(READBACK_HAS_EGL)
+class EglContext final : public SharedContext {
+ public:
+  static auto create() -> std::unique_ptr<SharedContext> {
+    EGLDisplay display = eglGetCurrentDisplay();
+    EGLContext shared = eglGetCurrentContext();
+    if (display == EGL_NO_DISPLAY || shared == EGL_NO_CONTEXT) return nullptr;
+
+    EGLint config_id = 0;
+    EGLint config_count = 0;
+    EGLConfig config = nullptr;
+    eglQueryContext(display, shared, EGL_CONFIG_ID, &config_id);
+    EGLint const config_attribs[] = {EGL_CONFIG_ID, config_id, EGL_NONE};
+    if (eglChooseConfig(display, config_attribs, &config, 1, &config_count) != EGL_TRUE || config_count == 0) {
+      return nullptr;
+    }
+
+    ContextVersion version = ContextVersion::current();
+    EGLint const context_attribs[] = {EGL_CONTEXT_MAJOR_VERSION,     version.major, EGL_CONTEXT_MINOR_VERSION,
+                                      version.minor, EGL_CONTEXT_OPENGL_PROFILE_MASK, version.profile,
+                                      EGL_NONE};
+    EGLContext context = eglCreateContext(display, config, shared, context_attribs);
+    if (context == EGL_NO_CONTEXT) return nullptr;
+
+    // a 1x1 pbuffer stands in for the missing surface on implementations without surfaceless contexts
+    EGLSurface surface = EGL_NO_SURFACE;
+    char const* extensions = eglQueryString(display, EGL_EXTENSIONS);
+    if (extensions == nullptr || std::strstr(extensions, "EGL_KHR_surfaceless_context") == nullptr) {
+      EGLint const surface_attribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+      surface = eglCreatePbufferSurface(display, config, surface_attribs);
+      if (surface == EGL_NO_SURFACE) {
+        eglDestroyContext(display, context);
+        return nullptr;
+      }
+    }
+
+    return std::make_unique<EglContext>(display, context, surface);
+  }
+
+  EglContext(EGLDisplay display, EGLContext context, EGLSurface surface) noexcept
+      : display_(display), context_(context), surface_(surface) {}
+
+  ~EglContext() noexcept override {
+    if (surface_ != EGL_NO_SURFACE) eglDestroySurface(display_, surface_);
+    eglDestroyContext(display_, context_);
+  }
+
+  auto make_current() -> bool override {
+    // the bound API is per thread
+    eglBindAPI(EGL_OPENGL_API);
+    return eglMakeCurrent(display_, surface_, surface_, context_) == EGL_TRUE;
+  }
+
+  void release() override { eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT); }
+
+ private:
+  EGLDisplay display_;
+  EGLContext context_;
+  EGLSurface surface_;
+};
+#endif
+
+#if defined(_WIN32)
+class WglContext final : public SharedContext {
+ public:
+  static auto create() -> std::unique_ptr<SharedContext> {
+    HDC dc = wglGetCurrentDC();
+    HGLRC shared = wglGetCurrentContext();
+    if (dc == nullptr || shared == nullptr) return nullptr;
+
+    HGLRC context = nullptr;
+    if (WGLEW_ARB_create_context) {
+      ContextVersion version = ContextVersion::current();
+      int const attribs[] = {WGL_CONTEXT_MAJOR_VERSION_ARB, version.major, WGL_CONTEXT_MINOR_VERSION_ARB, version.minor,
+                             WGL_CONTEXT_PROFILE_MASK_ARB,  version.profile, 0};
+      context = wglCreateContextAttribsARB(dc, shared, attribs);
+    } else {
+      context = wglCreateContext(dc);
+      if (context != nullptr && wglShareLists(shared, context) == FALSE) {
+        wglDeleteContext(context);
+        context = nullptr;
+      }
+    }
+    if (context == nullptr) return nullptr;
+
+    return std::make_unique<WglContext>(dc, context);
+  }
+
+  WglContext(HDC dc, HGLRC context) noexcept : dc_(dc), context_(context) {}
+
+  ~WglContext() noexcept override { wglDeleteContext(context_); }
+
+  auto make_current() -> bool override { return wglMakeCurrent(dc_, context_) != FALSE; }
+
+  void release() override { wglMakeCurrent(nullptr, nullptr); }
+
+ private:
+  HDC dc_;
+  HGLRC context_;
+};
+#elif defined(__APPLE__)
+class CglContext final : public SharedContext {
+ public:
+  static auto create() -> std::unique_ptr<SharedContext> {
+    CGLContextObj shared = CGLGetCurrentContext();
+    if (shared == nullptr) return nullptr;
+
+    CGLContextObj context = nullptr;
+    if (CGLCreateContext(CGLGetPixelFormat(shared), shared, &context) != kCGLNoError) return nullptr;
+
+    return std::make_unique<CglContext>(context);
+  }
+
+  explicit CglContext(CGLContextObj context) noexcept : context_(context) {}
+
+  ~CglContext() noexcept override { CGLDestroyContext(context_); }
+
+  auto make_current() -> bool override { return CGLSetCurrentContext(context_) == kCGLNoError; }
+
+  void release() override { CGLSetCurrentContext(nullptr); }
+
+ private:
+  CGLContextObj context_;
+};
+#else
+/**
+ * @brief Catches the X errors of one connection while it is alive rather than leaving them to the default handler,
+ * which exits the process. The handler is global, so errors of other connections go on to the one installed before
+ */
+class XErrorTrap {
+ public:
+  explicit XErrorTrap(Display* display) noexcept : lock_(trap_mutex()) {
+    display_ = display;
+    failed_ = false;
+    previous_ = XSetErrorHandler(&XErrorTrap::on_error);
+  }
+  XErrorTrap(XErrorTrap const&) = delete;
+  XErrorTrap(XErrorTrap&&) = delete;
+  auto operator=(XErrorTrap const&) = delete;
+  auto operator=(XErrorTrap&&) = delete;
+
+  ~XErrorTrap() noexcept {
+    XSync(display_, False);
+    XSetErrorHandler(previous_);
+    display_ = nullptr;
+  }
+
+  /**
+   * @return true if any request sent since the trap was set or last checked failed
+   */
+  auto failed() noexcept -> bool {
+    XSync(display_, False);
+    return failed_.exchange(false);
+  }
+
+ private:
+  std::scoped_lock<std::mutex> lock_;
+
+  static inline Display* display_ = nullptr;
+  static inline XErrorHandler previous_ = nullptr;
+  static inline std::atomic<bool> failed_ = false;
+
+  static auto trap_mutex() noexcept -> std::mutex& {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  static auto on_error(Display* display, XErrorEvent* event) -> int {
+    if (display != display_ && previous_ != nullptr) return previous_(display, event);
+    failed_ = true;
+    return 0;
+  }
+};
+
+/**
+ * @brief GLX context on a private connection to the X server of the original context where the driver can share
+ * objects across connections, the readback thread is then the only user of that connection. Direct rendering drivers
+ * such as Mesa's cannot, the context is then created on Unity's own connection, which requires the host process to have
+ * called XInitThreads as two threads use it from then on
+ */
+class GlxContext final : public SharedContext {
+ public:
+  static auto create() -> std::unique_ptr<SharedContext> {
+    GLXContext shared = glXGetCurrentContext();
+    if (shared == nullptr || !GLXEW_VERSION_1_3 || !GLXEW_ARB_create_context) return nullptr;
+    Display* unity_display = glXGetCurrentDisplay();
+
+    // only a name that has been bound is a buffer object
+    GLint previous_binding = 0;
+    GLuint probe = 0;
+    glGetIntegerv(GL_COPY_WRITE_BUFFER_BINDING, &previous_binding);
+    glGenBuffers(1, &probe);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, probe);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, static_cast<GLuint>(previous_binding));
+
+    std::unique_ptr<GlxContext> context;
+    Display* display = XOpenDisplay(DisplayString(unity_display));
+    if (display != nullptr) {
+      context = create_on(display, true, unity_display, shared);
+      if (context != nullptr && !context->shares(probe, unity_display, shared)) context.reset();
+    }
+    if (context == nullptr) {
+      context = create_on(unity_display, false, unity_display, shared);
+      if (context != nullptr && !context->shares(probe, unity_display, shared)) context.reset();
+    }
+
+    glDeleteBuffers(1, &probe);
+    return context;
+  }
+
+  GlxContext(Display* display, bool owns_display) noexcept : display_(display), owns_display_(owns_display) {}
+
+  ~GlxContext() noexcept override {
+    if (pbuffer_ != None) glXDestroyPbuffer(display_, pbuffer_);
+    if (context_ != nullptr) glXDestroyContext(display_, context_);
+    if (owns_display_) XCloseDisplay(display_);
+  }
+
+  auto make_current() -> bool override { return glXMakeContextCurrent(display_, pbuffer_, pbuffer_, context_) == True; }
+
+  void release() override { glXMakeContextCurrent(display_, None, None, nullptr); }
+
+ private:
+  Display* display_;
+  bool owns_display_;
+  GLXContext context_ = nullptr;
+  GLXPbuffer pbuffer_ = None;
+
+  /**
+   * @brief Create a context on display sharing with the current one, closes display on failure if owns_display
+   */
+  static auto create_on(Display* display, bool owns_display, Display* unity_display, GLXContext shared)
+      -> std::unique_ptr<GlxContext> {
+    int config_id = 0;
+    int screen = 0;
+    glXQueryContext(unity_display, shared, GLX_FBCONFIG_ID, &config_id);
+    glXQueryContext(unity_display, shared, GLX_SCREEN, &screen);
+
+    std::unique_ptr<GlxContext> context = std::make_unique<GlxContext>(display, owns_display);
+    XErrorTrap errors(display);
+
+    int config_count = 0;
+    int const config_attribs[] = {GLX_FBCONFIG_ID, config_id, None};
+    GLXFBConfig* configs = glXChooseFBConfig(display, screen, config_attribs, &config_count);
+    if (configs == nullptr) return nullptr;
+    GLXFBConfig config = configs[0];
+    XFree(configs);
+    if (config_count == 0) return nullptr;
+
+    ContextVersion version = ContextVersion::current();
+    int const context_attribs[] = {GLX_CONTEXT_MAJOR_VERSION_ARB, version.major,   GLX_CONTEXT_MINOR_VERSION_ARB,
+                                   version.minor, GLX_CONTEXT_PROFILE_MASK_ARB,  version.profile,
+                                   None};
+    context->context_ = glXCreateContextAttribsARB(display, config, shared, True, context_attribs);
+    if (errors.failed() || context->context_ == nullptr) return nullptr;
+
+    // contexts are made current without a drawable where the config cannot back a pbuffer, which is allowed for the
+    // 3.0+ contexts created above
+    int const pbuffer_attribs[] = {GLX_PBUFFER_WIDTH, 1, GLX_PBUFFER_HEIGHT, 1, None};
+    context->pbuffer_ = glXCreatePbuffer(display, config, pbuffer_attribs);
+    if (errors.failed()) context->pbuffer_ = None;
+
+    return context;
+  }
+
+  /**
+   * @brief Check on the calling thread that the buffer probe of the shared context is visible here, a context created
+   * without error can still have its own namespace. The shared context is current again on return
+   */
+  auto shares(GLuint probe, Display* unity_display, GLXContext shared) -> bool {
+    GLXDrawable draw = glXGetCurrentDrawable();
+    GLXDrawable read = glXGetCurrentReadDrawable();
+    if (!make_current()) return false;
+    bool visible = glIsBuffer(probe) == GL_TRUE;
+    release();
+    glXMakeContextCurrent(unity_display, draw, read, shared);
+    return visible;
+  }
+};
+#endif
+
+}  // namespace
+
+auto SharedContext::create() -> std::unique_ptr<SharedContext> {
+#if defined(READBACK_HAS_EGL)
+  if (eglGetCurrentContext() != EGL_NO_CONTEXT) return EglContext::create();
+#endif
+
+#if defined(_WIN32)
+  return WglContext::create();
+#elif defined(__APPLE__)
+  return CglContext::create();
+#else
+  return GlxContext::create();
+#endif
+}
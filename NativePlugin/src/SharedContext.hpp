@@ -0,0 +1,42 @@
+#pragma once
+
+#include <memory>
+
+/**
+ * @brief OpenGL context sharing objects with the context that was current when it was created
+ *
+ * Buffers, textures and sync objects are shared between the two contexts, container objects such as framebuffers and
+ * vertex arrays are not. The context is created on the thread that owns the original context and can then be made
+ * current on any single other thread.
+ */
+class SharedContext {
+ public:
+  /**
+   * @brief Create a context sharing with the one current on the calling thread, using the same window system API,
+   * version and profile
+   * @return nullptr if there is no current context or the platform does not support creating one
+   */
+  [[nodiscard]] static auto create() -> std::unique_ptr<SharedContext>;
+
+  SharedContext() noexcept = default;
+  SharedContext(SharedContext const&) = delete;
+  SharedContext(SharedContext&&) = delete;
+  auto operator=(SharedContext const&) = delete;
+  auto operator=(SharedContext&&) = delete;
+
+  /**
+   * @brief Destroys the context, it must not be current on any thread
+   */
+  virtual ~SharedContext() noexcept = default;
+
+  /**
+   * @brief Make the context current on the calling thread
+   * @return false on failure
+   */
+  virtual auto make_current() -> bool = 0;
+
+  /**
+   * @brief Release the context from the calling thread
+   */
+  virtual void release() = 0;
+};
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "OpenGLAsyncGPUReadbackPluginAPI.hpp"
+
+/**
+ * @brief GL objects created by requests, counted by Statistics and tracked by LeakCheck
+ */
+enum class GLResource : size_t {
+  kPbo,
+  kFbo,
+  kFence,
+  kCount,
+};
+
+/**
+ * @brief Lock-free counters behind Plugin_GetStats
+ *
+ * Counters are updated with relaxed atomics from whichever thread the event happens on, so snapshot() may see them a
+ * few events apart. Rates and frames-to-done are computed by update() over windows of at least a second and published
+ * when a window closes.
+ */
+class Statistics {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /** @brief frames-to-done histogram size, requests taking longer are counted in the last bucket */
+  static constexpr size_t kFrameBuckets = 64;
+  static constexpr Clock::duration kWindow = std::chrono::seconds(1);
+
+  /**
+   * @return number of update() calls so far, used to timestamp requests in frames
+   */
+  [[nodiscard]] auto frame() const noexcept -> uint64_t { return frame_.load(std::memory_order_relaxed); }
+
+  void on_submitted() noexcept { submitted_.fetch_add(1, std::memory_order_relaxed); }
+
+  /**
+   * @param frames number of updates since the request was submitted
+   * @param bytes size of the retrieved data
+   * @param error whether the request failed
+   */
+  void on_completed(uint64_t frames, size_t bytes, bool error) noexcept {
+    if (error) {
+      errors_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    frames_to_done_[std::min<uint64_t>(frames, kFrameBuckets - 1)].fetch_add(1, std::memory_order_relaxed);
+    frames_sum_.fetch_add(frames, std::memory_order_relaxed);
+    completed_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void on_staging_allocated(size_t bytes) noexcept {
+    raise_peak(peak_staging_bytes_, staging_bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+    staging_allocations_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void on_staging_released(size_t bytes) noexcept { staging_bytes_.fetch_sub(bytes, std::memory_order_relaxed); }
+
+  void on_result_allocated() noexcept { result_allocations_.fetch_add(1, std::memory_order_relaxed); }
+
+  /**
+   * @brief Account the time a done request spent in blocking GL calls
+   */
+  void on_stalls(RequestStalls const& stalls) noexcept {
+    map_ns_.fetch_add(stalls.map_ns, std::memory_order_relaxed);
+    read_pixels_ns_.fetch_add(stalls.read_pixels_ns, std::memory_order_relaxed);
+    client_wait_ns_.fetch_add(stalls.client_wait_ns, std::memory_order_relaxed);
+    if (stalls.stalled) stalled_requests_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void on_performance_message() noexcept { performance_messages_.fetch_add(1, std::memory_order_relaxed); }
+
+  void on_created(GLResource resource) noexcept {
+    auto index = static_cast<size_t>(resource);
+    raise_peak(peak_resources_[index], live_resources_[index].fetch_add(1, std::memory_order_relaxed) + 1);
+  }
+
+  void on_deleted(GLResource resource) noexcept {
+    live_resources_[static_cast<size_t>(resource)].fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Advance the frame counter and publish the rates once a window has passed, called from the main thread
+   */
+  void update(Clock::time_point now = Clock::now()) {
+    frame_.fetch_add(1, std::memory_order_relaxed);
+    if (window_start_ == Clock::time_point{}) {
+      window_start_ = now;
+      return;
+    }
+    if (now - window_start_ < kWindow) return;
+
+    double seconds = std::chrono::duration<double>(now - window_start_).count();
+    uint64_t completed = completed_.load(std::memory_order_relaxed);
+    uint64_t bytes = bytes_.load(std::memory_order_relaxed);
+    uint64_t frames_sum = frames_sum_.load(std::memory_order_relaxed);
+    uint64_t window_count = completed - window_.completed;
+
+    completions_per_second_.store(static_cast<double>(window_count) / seconds, std::memory_order_relaxed);
+    bytes_per_second_.store(static_cast<double>(bytes - window_.bytes) / seconds, std::memory_order_relaxed);
+    double frames = static_cast<double>(frames_sum - window_.frames_sum);
+    average_frames_to_done_.store(window_count == 0 ? 0.0 : frames / static_cast<double>(window_count),
+                                  std::memory_order_relaxed);
+
+    // the histogram is read bucket by bucket so its total may differ slightly from window_count
+    std::array<uint64_t, kFrameBuckets> histogram{};
+    uint64_t total = 0;
+    for (size_t i = 0; i < kFrameBuckets; ++i) {
+      uint64_t count = frames_to_done_[i].load(std::memory_order_relaxed);
+      histogram[i] = count - window_.frames_to_done[i];
+      window_.frames_to_done[i] = count;
+      total += histogram[i];
+    }
+    uint64_t p99 = 0;
+    for (uint64_t seen = histogram[0]; seen * 100 < total * 99 && p99 + 1 < kFrameBuckets;) seen += histogram[++p99];
+    p99_frames_to_done_.store(p99, std::memory_order_relaxed);
+
+    window_.completed = completed;
+    window_.bytes = bytes;
+    window_.frames_sum = frames_sum;
+    window_start_ = now;
+  }
+
+  [[nodiscard]] auto snapshot() const noexcept -> PluginStats {
+    PluginStats stats;
+    stats.completed = completed_.load(std::memory_order_relaxed);
+    stats.submitted = std::max(submitted_.load(std::memory_order_relaxed), stats.completed);
+    stats.in_flight = stats.submitted - stats.completed;
+    stats.errors = errors_.load(std::memory_order_relaxed);
+    stats.bytes_completed = bytes_.load(std::memory_order_relaxed);
+    stats.completions_per_second = completions_per_second_.load(std::memory_order_relaxed);
+    stats.bytes_per_second = bytes_per_second_.load(std::memory_order_relaxed);
+    stats.average_frames_to_done = average_frames_to_done_.load(std::memory_order_relaxed);
+    stats.p99_frames_to_done = p99_frames_to_done_.load(std::memory_order_relaxed);
+    stats.staging_bytes = staging_bytes_.load(std::memory_order_relaxed);
+    stats.staging_allocations = staging_allocations_.load(std::memory_order_relaxed);
+    stats.result_allocations = result_allocations_.load(std::memory_order_relaxed);
+    auto live = [this](GLResource resource) {
+      return live_resources_[static_cast<size_t>(resource)].load(std::memory_order_relaxed);
+    };
+    auto peak = [this](GLResource resource) {
+      return peak_resources_[static_cast<size_t>(resource)].load(std::memory_order_relaxed);
+    };
+    stats.live_pbos = live(GLResource::kPbo);
+    stats.live_fbos = live(GLResource::kFbo);
+    stats.live_fences = live(GLResource::kFence);
+    stats.peak_pbos = peak(GLResource::kPbo);
+    stats.peak_fbos = peak(GLResource::kFbo);
+    stats.peak_fences = peak(GLResource::kFence);
+    stats.peak_staging_bytes = peak_staging_bytes_.load(std::memory_order_relaxed);
+    stats.stalled_requests = stalled_requests_.load(std::memory_order_relaxed);
+    stats.map_ns = map_ns_.load(std::memory_order_relaxed);
+    stats.read_pixels_ns = read_pixels_ns_.load(std::memory_order_relaxed);
+    stats.client_wait_ns = client_wait_ns_.load(std::memory_order_relaxed);
+    stats.performance_messages = performance_messages_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+ private:
+  std::atomic<uint64_t> frame_ = 0;
+  std::atomic<uint64_t> submitted_ = 0;
+  std::atomic<uint64_t> completed_ = 0;
+  std::atomic<uint64_t> errors_ = 0;
+  std::atomic<uint64_t> bytes_ = 0;
+  std::atomic<uint64_t> frames_sum_ = 0;
+  std::array<std::atomic<uint64_t>, kFrameBuckets> frames_to_done_{};
+  std::atomic<uint64_t> staging_bytes_ = 0;
+  std::atomic<uint64_t> staging_allocations_ = 0;
+  std::atomic<uint64_t> result_allocations_ = 0;
+  std::atomic<uint64_t> peak_staging_bytes_ = 0;
+  std::array<std::atomic<uint64_t>, static_cast<size_t>(GLResource::kCount)> live_resources_{};
+  std::array<std::atomic<uint64_t>, static_cast<size_t>(GLResource::kCount)> peak_resources_{};
+  std::atomic<uint64_t> stalled_requests_ = 0;
+  std::atomic<uint64_t> map_ns_ = 0;
+  std::atomic<uint64_t> read_pixels_ns_ = 0;
+  std::atomic<uint64_t> client_wait_ns_ = 0;
+  std::atomic<uint64_t> performance_messages_ = 0;
+
+  // published by update()
+  std::atomic<double> completions_per_second_ = 0;
+  std::atomic<double> bytes_per_second_ = 0;
+  std::atomic<double> average_frames_to_done_ = 0;
+  std::atomic<uint64_t> p99_frames_to_done_ = 0;
+
+  // counters at the start of the current window, only used by update()
+  struct Window {
+    uint64_t completed = 0;
+    uint64_t bytes = 0;
+    uint64_t frames_sum = 0;
+    std::array<uint64_t, kFrameBuckets> frames_to_done{};
+  };
+  Window window_;
+  Clock::time_point window_start_{};
+
+  static void raise_peak(std::atomic<uint64_t>& peak, uint64_t value) noexcept {
+    uint64_t current = peak.load(std::memory_order_relaxed);
+    while (current < value && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+  }
+};
@@ -0,0 +1,165 @@
+#include "Tracer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief One slot of a ring, guarded by a sequence number so that the dump can skip slots being overwritten. The
+ * sequence is odd while the slot is written and 2 * (index + 1) once event number index is complete
+ */
+struct Slot {
+  std::atomic<uint64_t> sequence = 0;
+  std::atomic<uint64_t> time = 0;
+  std::atomic<int64_t> id = 0;
+  std::atomic<char const*> name = nullptr;
+  std::atomic<char> phase = 0;
+};
+
+struct ThreadRing {
+  uint32_t tid = 0;
+  std::atomic<char const*> name = nullptr;
+  // only written by the owning thread
+  std::atomic<uint64_t> written = 0;
+  std::array<Slot, Tracer::kEventsPerThread> slots;
+};
+
+struct Event {
+  uint64_t time;
+  int64_t id;
+  char const* name;
+  uint32_t tid;
+  char phase;
+};
+
+std::mutex rings_mutex;
+std::vector<std::unique_ptr<ThreadRing>> rings;
+
+thread_local ThreadRing* current_ring = nullptr;
+thread_local char const* current_name = nullptr;
+thread_local bool allocation_failed = false;
+
+auto now_ns() noexcept -> uint64_t {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+auto ring() noexcept -> ThreadRing* {
+  if (current_ring != nullptr || allocation_failed) return current_ring;
+  try {
+    auto owned = std::make_unique<ThreadRing>();
+    owned->name.store(current_name, std::memory_order_relaxed);
+    std::scoped_lock guard(rings_mutex);
+    owned->tid = static_cast<uint32_t>(rings.size() + 1);
+    current_ring = owned.get();
+    rings.push_back(std::move(owned));
+  } catch (...) {
+    // tracing is best effort, the thread just goes without
+    allocation_failed = true;
+  }
+  return current_ring;
+}
+
+/**
+ * @brief Copy the complete events out of a ring, skipping slots overwritten while reading
+ */
+void collect(ThreadRing const& ring, std::vector<Event>& events) {
+  uint64_t written = ring.written.load(std::memory_order_acquire);
+  uint64_t first = written > Tracer::kEventsPerThread ? written - Tracer::kEventsPerThread : 0;
+  for (uint64_t index = first; index < written; ++index) {
+    Slot const& slot = ring.slots[index % Tracer::kEventsPerThread];
+    uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence != 2 * (index + 1)) continue;
+    Event event{
+        .time = slot.time.load(std::memory_order_relaxed),
+        .id = slot.id.load(std::memory_order_relaxed),
+        .name = slot.name.load(std::memory_order_relaxed),
+        .tid = ring.tid,
+        .phase = slot.phase.load(std::memory_order_relaxed),
+    };
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != sequence) continue;
+    events.push_back(event);
+  }
+}
+
+}  // namespace
+
+void Tracer::write(Phase phase, char const* name, int64_t id) noexcept {
+  ThreadRing* ring = ::ring();
+  if (ring == nullptr) return;
+
+  uint64_t index = ring->written.load(std::memory_order_relaxed);
+  Slot& slot = ring->slots[index % kEventsPerThread];
+  slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.time.store(now_ns(), std::memory_order_relaxed);
+  slot.id.store(id, std::memory_order_relaxed);
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.phase.store(static_cast<char>(phase), std::memory_order_relaxed);
+  slot.sequence.store(2 * (index + 1), std::memory_order_release);
+  ring->written.store(index + 1, std::memory_order_release);
+}
+
+void Tracer::name_thread(char const* name) noexcept {
+  current_name = name;
+  if (current_ring != nullptr) current_ring->name.store(name, std::memory_order_relaxed);
+}
+
+auto Tracer::dump(std::filesystem::path const& path) -> bool {
+  std::vector<Event> events;
+  std::vector<std::pair<uint32_t, char const*>> names;
+  {
+    // rings are never removed, the lock only keeps the list stable while threads register
+    std::scoped_lock guard(rings_mutex);
+    for (auto const& ring : rings) {
+      collect(*ring, events);
+      if (char const* name = ring->name.load(std::memory_order_relaxed)) names.emplace_back(ring->tid, name);
+    }
+  }
+  std::stable_sort(events.begin(), events.end(),
+                   [](Event const& lhs, Event const& rhs) { return lhs.time < rhs.time; });
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) return false;
+
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  char line[256];
+  bool first = true;
+  auto emit = [&file, &first, &line](int length) {
+    if (length <= 0) return;
+    if (!first) file << ",\n";
+    file.write(line, std::min<std::streamsize>(length, sizeof(line) - 1));
+    first = false;
+  };
+  for (auto const& [tid, name] : names) {
+    emit(std::snprintf(line, sizeof(line),
+                       R"({"ph":"M","name":"thread_name","pid":1,"tid":%)" PRIu32 R"(,"args":{"name":"%s"}})", tid,
+                       name));
+  }
+  for (Event const& event : events) {
+    // timestamps are in microseconds
+    double ts = static_cast<double>(event.time) * 1e-3;
+    if (event.phase == static_cast<char>(Phase::kBegin) || event.phase == static_cast<char>(Phase::kEnd)) {
+      emit(std::snprintf(line, sizeof(line),
+                         R"({"ph":"%c","name":"%s","cat":"plugin","pid":1,"tid":%)" PRIu32 R"(,"ts":%.3f})",
+                         event.phase, event.name, event.tid, ts));
+    } else {
+      emit(std::snprintf(line, sizeof(line),
+                         R"({"ph":"%c","name":"%s","cat":"request","id":%)" PRId64
+                         R"(,"pid":1,"tid":%)" PRIu32 R"(,"ts":%.3f,"args":{"event_id":%)" PRId64 "}}",
+                         event.phase, event.name, event.id, event.tid, ts, event.id));
+    }
+  }
+  file << "\n]}\n";
+  return static_cast<bool>(file);
+}
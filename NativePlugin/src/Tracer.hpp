@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+
+/**
+ * @brief Records the readback pipeline as Chrome trace events, see Plugin_DumpTrace
+ *
+ * Every thread writes into its own fixed size ring of events without locking, so the oldest events of a thread are
+ * overwritten once it has recorded kEventsPerThread of them. Rings are allocated on a thread's first event after
+ * tracing is enabled and kept until the process exits so that events of finished threads can still be dumped. With
+ * tracing off every hook costs a single relaxed load.
+ */
+class Tracer {
+ public:
+  /** @brief trace_event phases */
+  enum class Phase : char {
+    kBegin = 'B',
+    kEnd = 'E',
+    kAsyncBegin = 'b',
+    kAsyncInstant = 'n',
+    kAsyncEnd = 'e',
+  };
+
+  static constexpr size_t kEventsPerThread = size_t{1} << 16;
+
+  [[nodiscard]] static auto enabled() noexcept -> bool { return enabled_.load(std::memory_order_relaxed); }
+  static void set_enabled(bool enabled) noexcept { enabled_.store(enabled, std::memory_order_relaxed); }
+
+  /**
+   * @brief Record an event on the calling thread's ring if tracing is enabled
+   * @param name must outlive the tracer, i.e. a string literal
+   * @param id request the event belongs to, only used by the async phases
+   */
+  static void record(Phase phase, char const* name, int64_t id = 0) noexcept {
+    if (enabled()) write(phase, name, id);
+  }
+
+  /**
+   * @brief Name the calling thread in the trace, applies to events recorded before and after
+   * @param name must outlive the tracer, i.e. a string literal
+   */
+  static void name_thread(char const* name) noexcept;
+
+  /**
+   * @brief Write the recorded events as Chrome trace_event JSON, may be called while events are being recorded
+   * @return false if the file could not be written
+   */
+  static auto dump(std::filesystem::path const& path) -> bool;
+
+  /**
+   * @brief Records a span on the calling thread for the lifetime of the scope
+   */
+  class Scope {
+   public:
+    explicit Scope(char const* name) noexcept : name_(enabled() ? name : nullptr) {
+      if (name_ != nullptr) write(Phase::kBegin, name_, 0);
+    }
+    Scope(Scope const&) = delete;
+    Scope(Scope&&) = delete;
+    auto operator=(Scope const&) = delete;
+    auto operator=(Scope&&) = delete;
+    // ended even if tracing was turned off in the meantime so that spans stay balanced
+    ~Scope() noexcept {
+      if (name_ != nullptr) write(Phase::kEnd, name_, 0);
+    }
+
+   private:
+    char const* name_;
+  };
+
+ private:
+  static inline std::atomic<bool> enabled_ = false;
+
+  static void write(Phase phase, char const* name, int64_t id) noexcept;
+};
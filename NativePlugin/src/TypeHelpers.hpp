@@ -220,3 +220,75 @@
     default: return 0;
   }
 }
+
+/**
+ * @brief Get the number of components of a pixel format
+ *
+ * @param format format returned by getFormatFromInternalFormat
+ * @return int The number of components per pixel. 0 if not found
+ */
+[[nodiscard]] constexpr auto getComponentCountFromFormat(int format) noexcept -> int {
+  switch (format) {
+    case GL_RED: [[fallthrough]];
+    case GL_RED_INTEGER: return 1;
+
+    case GL_RG: [[fallthrough]];
+    case GL_RG_INTEGER: return 2;
+
+    case GL_RGB: [[fallthrough]];
+    case GL_RGB_INTEGER: return 3;
+
+    case GL_RGBA: [[fallthrough]];
+    case GL_RGBA_INTEGER: return 4;
+
+    default: return 0;
+  }
+}
+
+/**
+ * @brief Get the size of a single component of the given type
+ *
+ * @param type type returned by getTypeFromInternalFormat
+ * @return int The size of the component in number of bytes. 0 if not found
+ */
+[[nodiscard]] constexpr auto getComponentSizeFromType(int type) noexcept -> int {
+  switch (type) {
+    case GL_UNSIGNED_BYTE: [[fallthrough]];
+    case GL_BYTE: return 1;
+
+    case GL_UNSIGNED_SHORT: [[fallthrough]];
+    case GL_SHORT: [[fallthrough]];
+    case GL_HALF_FLOAT: return 2;
+
+    case GL_UNSIGNED_INT: [[fallthrough]];
+    case GL_INT: [[fallthrough]];
+    case GL_FLOAT: return 4;
+
+    default: return 0;
+  }
+}
+
+/**
+ * @brief Whether the components of a pixel format are read back as integers rather than normalized values
+ *
+ * @param format format returned by getFormatFromInternalFormat
+ */
+[[nodiscard]] constexpr auto isIntegerFormat(int format) noexcept -> bool {
+  switch (format) {
+    case GL_RED_INTEGER: [[fallthrough]];
+    case GL_RG_INTEGER: [[fallthrough]];
+    case GL_RGB_INTEGER: [[fallthrough]];
+    case GL_RGBA_INTEGER: return true;
+
+    default: return false;
+  }
+}
+
+/**
+ * @brief Whether the colour components of the internal format are stored sRGB encoded
+ *
+ * @param internalFormat
+ */
+[[nodiscard]] constexpr auto isSrgbInternalFormat(int internalFormat) noexcept -> bool {
+  return internalFormat == GL_SRGB8 || internalFormat == GL_SRGB8_ALPHA8;
+}
@@ -0,0 +1,93 @@
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+
+#include "Tracer.hpp"
+
+namespace {
+// pool and queue owned by the current thread
+thread_local WorkerPool const* current_pool = nullptr;
+thread_local size_t current_index = 0;
+}  // namespace
+
+WorkerPool::WorkerPool(size_t thread_count) {
+  if (thread_count == 0) thread_count = std::max(1U, std::thread::hardware_concurrency() / 2);
+
+  queues_.reserve(thread_count);
+  for (size_t i = 0; i < thread_count; ++i) queues_.emplace_back(std::make_unique<Queue>());
+
+  threads_.reserve(thread_count);
+  for (size_t i = 0; i < thread_count; ++i) threads_.emplace_back([this, i]() { run(i); });
+}
+
+WorkerPool::~WorkerPool() noexcept {
+  {
+    std::scoped_lock guard(sleep_mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (auto& thread : threads_) thread.join();
+}
+
+void WorkerPool::submit(Job job) {
+  size_t index = current_pool == this ? current_index : next_queue_++ % queues_.size();
+
+  {
+    Queue& queue = *queues_[index];
+    std::scoped_lock guard(queue.mutex);
+    queue.jobs.emplace_back(std::move(job));
+    // counted once it is queued so that woken workers find it, and before the queue is unlocked so that taking it can
+    // never underflow, the lock pairs with the predicate check in run() so that the wakeup cannot be missed
+    std::scoped_lock sleep_guard(sleep_mutex_);
+    ++queued_;
+  }
+  wake_.notify_one();
+}
+
+void WorkerPool::run(size_t index) {
+  current_pool = this;
+  current_index = index;
+  Tracer::name_thread("worker");
+
+  while (true) {
+    if (Job job = take(index)) {
+      job();
+      --running_;
+      continue;
+    }
+
+    std::unique_lock lock(sleep_mutex_);
+    wake_.wait(lock, [this]() { return stopping_ || queued_ != 0; });
+    if (stopping_ && queued_ == 0) return;
+  }
+}
+
+auto WorkerPool::take(size_t index) -> Job {
+  Job job;
+
+  {
+    Queue& own = *queues_[index];
+    std::scoped_lock guard(own.mutex);
+    if (!own.jobs.empty()) {
+      job = std::move(own.jobs.front());
+      own.jobs.pop_front();
+      ++running_;
+      --queued_;
+      return job;
+    }
+  }
+
+  for (size_t i = 1; i < queues_.size(); ++i) {
+    Queue& other = *queues_[(index + i) % queues_.size()];
+    std::scoped_lock guard(other.mutex);
+    if (!other.jobs.empty()) {
+      job = std::move(other.jobs.front());
+      other.jobs.pop_front();
+      ++running_;
+      --queued_;
+      return job;
+    }
+  }
+
+  return job;
+}
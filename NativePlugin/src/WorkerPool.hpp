@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed size pool of worker threads with per-worker queues and work stealing
+ *
+ * Jobs submitted from outside the pool are distributed round-robin over the worker queues, jobs submitted from a worker
+ * go to its own queue. Workers run their own queue in submission order and steal from the front of the others when it
+ * is empty, so a burst of large jobs on one queue is spread over all threads.
+ */
+class WorkerPool {
+ public:
+  using Job = std::function<void()>;
+
+  /**
+   * @param thread_count number of worker threads, 0 picks half of the hardware threads
+   */
+  explicit WorkerPool(size_t thread_count = 0);
+  WorkerPool(WorkerPool const&) = delete;
+  WorkerPool(WorkerPool&&) = delete;
+  auto operator=(WorkerPool const&) = delete;
+  auto operator=(WorkerPool&&) = delete;
+
+  /**
+   * @brief Finishes all queued jobs and joins the workers
+   */
+  ~WorkerPool() noexcept;
+
+  void submit(Job job);
+
+  [[nodiscard]] auto thread_count() const noexcept -> size_t { return queues_.size(); }
+
+  /**
+   * @return number of jobs that are queued or running
+   */
+  [[nodiscard]] auto pending() const noexcept -> size_t { return queued_ + running_; }
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+  };
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+  std::atomic<size_t> next_queue_ = 0;
+  std::atomic<size_t> queued_ = 0;
+  std::atomic<size_t> running_ = 0;
+  std::atomic<bool> stopping_ = false;
+
+  // only used to sleep when every queue is empty
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_;
+
+  void run(size_t index);
+  auto take(size_t index) -> Job;
+};
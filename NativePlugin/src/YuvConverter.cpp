@@ -0,0 +1,214 @@
+#include "YuvConverter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "CpuFeatures.hpp"
+
+namespace {
+
+/** @brief fractional bits of the luma coefficients, chroma is computed from sums of 4 pixels and shifted by 2 more */
+constexpr int kShift = 14;
+
+/**
+ * @brief Fixed-point matrix, rounding and offset of a colour space, shared by the scalar and vector code so that both
+ * produce the same bytes
+ */
+struct Coefficients {
+  int16_t yr, yg, yb;
+  int16_t ur, ug, ub;
+  int16_t vr, vg, vb;
+  int32_t y_bias;
+  int32_t c_bias;
+};
+
+auto coefficients(YuvColorSpace color_space) noexcept -> Coefficients {
+  bool bt709 = color_space == kYuvBt709Limited || color_space == kYuvBt709Full;
+  bool full = color_space == kYuvBt601Full || color_space == kYuvBt709Full;
+  double kr = bt709 ? 0.2126 : 0.299;
+  double kb = bt709 ? 0.0722 : 0.114;
+  double scale = 1 << kShift;
+  double y_scale = (full ? 1.0 : 219.0 / 255.0) * scale;
+  double c_scale = (full ? 1.0 : 224.0 / 255.0) * scale;
+  auto fixed = [](double value) { return static_cast<int16_t>(std::lround(value)); };
+
+  Coefficients c{};
+  c.yr = fixed(kr * y_scale);
+  c.yb = fixed(kb * y_scale);
+  // the rows sum up exactly, so that grey stays grey and maps onto the ends of the range
+  c.yg = static_cast<int16_t>(fixed(y_scale) - c.yr - c.yb);
+  c.ur = fixed(-kr / (2 * (1 - kb)) * c_scale);
+  c.ub = fixed(0.5 * c_scale);
+  c.ug = static_cast<int16_t>(-c.ur - c.ub);
+  c.vr = fixed(0.5 * c_scale);
+  c.vb = fixed(-kb / (2 * (1 - kr)) * c_scale);
+  c.vg = static_cast<int16_t>(-c.vr - c.vb);
+  c.y_bias = ((full ? 0 : 16) << kShift) + (1 << (kShift - 1));
+  c.c_bias = (128 << (kShift + 2)) + (1 << (kShift + 1));
+  return c;
+}
+
+/**
+ * @brief Destination of one pair of rows, u and v advance by chroma_step per sample
+ */
+struct RowPair {
+  unsigned char const* src0;
+  unsigned char const* src1;
+  unsigned char* y0;
+  /** @brief nullptr for the last row of an odd height, src1 then repeats src0 */
+  unsigned char* y1;
+  unsigned char* u;
+  unsigned char* v;
+  int chroma_step;
+};
+
+auto clamp_byte(int32_t value) noexcept -> unsigned char {
+  return static_cast<unsigned char>(std::clamp(value, 0, 255));
+}
+
+void convert_scalar(RowPair const& rows, Coefficients const& c, int components, int x_begin, int width) noexcept {
+  auto luma = [&c](unsigned char const* p) {
+    return clamp_byte((c.yr * p[0] + c.yg * p[1] + c.yb * p[2] + c.y_bias) >> kShift);
+  };
+  for (int x0 = x_begin; x0 < width; x0 += 2) {
+    int x1 = std::min(x0 + 1, width - 1);
+    unsigned char const* p[4] = {
+        rows.src0 + static_cast<ptrdiff_t>(x0) * components, rows.src0 + static_cast<ptrdiff_t>(x1) * components,
+        rows.src1 + static_cast<ptrdiff_t>(x0) * components, rows.src1 + static_cast<ptrdiff_t>(x1) * components};
+    rows.y0[x0] = luma(p[0]);
+    rows.y0[x1] = luma(p[1]);
+    if (rows.y1 != nullptr) {
+      rows.y1[x0] = luma(p[2]);
+      rows.y1[x1] = luma(p[3]);
+    }
+
+    int32_t r = p[0][0] + p[1][0] + p[2][0] + p[3][0];
+    int32_t g = p[0][1] + p[1][1] + p[2][1] + p[3][1];
+    int32_t b = p[0][2] + p[1][2] + p[2][2] + p[3][2];
+    ptrdiff_t sample = static_cast<ptrdiff_t>(x0 / 2) * rows.chroma_step;
+    rows.u[sample] = clamp_byte((c.ur * r + c.ug * g + c.ub * b + c.c_bias) >> (kShift + 2));
+    rows.v[sample] = clamp_byte((c.vr * r + c.vg * g + c.vb * b + c.c_bias) >> (kShift + 2));
+  }
+}
+
+#ifdef READBACK_X86
+// horizontal adds interleave the 128-bit lanes, this puts 8 of their results back in order
+READBACK_TARGET("avx2") inline auto in_order(__m256i value) noexcept -> __m256i {
+  return _mm256_permutevar8x32_epi32(value, _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7));
+}
+
+/** @return 4 pixels widened to 16 bits per component */
+READBACK_TARGET("avx2") inline auto load4(unsigned char const* p) noexcept -> __m256i {
+  return _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<__m128i const*>(p)));
+}
+
+/** @return 8 32-bit values saturated to bytes in the low half */
+READBACK_TARGET("avx2") inline auto pack_bytes(__m256i value) noexcept -> __m128i {
+  __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1));
+  return _mm_packus_epi16(words, words);
+}
+
+/**
+ * @return dot products of pairs of 4 pixels with 4 coefficients each, bias added and shifted down
+ */
+READBACK_TARGET("avx2")
+inline auto dot8(__m256i first, __m256i second, __m256i coefficients, __m256i bias, int shift) noexcept -> __m256i {
+  __m256i sum = _mm256_hadd_epi32(_mm256_madd_epi16(first, coefficients), _mm256_madd_epi16(second, coefficients));
+  return in_order(_mm256_sra_epi32(_mm256_add_epi32(sum, bias), _mm_cvtsi32_si128(shift)));
+}
+
+/** @return sums of the 2x2 blocks of 4 pixels, each duplicated so that u and v are computed in one go */
+READBACK_TARGET("avx2") inline auto block_sums(__m256i top, __m256i bottom) noexcept -> __m256i {
+  __m256i sum = _mm256_add_epi16(top, bottom);
+  sum = _mm256_add_epi16(sum, _mm256_srli_si256(sum, 8));
+  return _mm256_unpacklo_epi64(sum, sum);
+}
+
+/**
+ * @brief Convert RGBA pixels 8 at a time, the tail is left to the scalar code
+ * @return first pixel that was not converted
+ */
+READBACK_TARGET("avx2")
+auto convert_avx2(RowPair const& rows, Coefficients const& c, int width) noexcept -> int {
+  // per pixel (r, g, b, a) coefficients, chroma has u and v of the same block side by side
+  __m256i const y_coefficients = _mm256_setr_epi16(c.yr, c.yg, c.yb, 0, c.yr, c.yg, c.yb, 0, c.yr, c.yg, c.yb, 0,
+                                                   c.yr, c.yg, c.yb, 0);
+  __m256i const uv_coefficients = _mm256_setr_epi16(c.ur, c.ug, c.ub, 0, c.vr, c.vg, c.vb, 0, c.ur, c.ug, c.ub, 0,
+                                                    c.vr, c.vg, c.vb, 0);
+  __m256i const y_bias = _mm256_set1_epi32(c.y_bias);
+  __m256i const c_bias = _mm256_set1_epi32(c.c_bias);
+  __m128i const split_uv = _mm_setr_epi8(0, 2, 4, 6, 1, 3, 5, 7, -1, -1, -1, -1, -1, -1, -1, -1);
+
+  int x = 0;
+  for (; x + 8 <= width; x += 8) {
+    ptrdiff_t offset = static_cast<ptrdiff_t>(x) * 4;
+    __m256i a0 = load4(rows.src0 + offset);
+    __m256i b0 = load4(rows.src0 + offset + 16);
+    __m256i a1 = load4(rows.src1 + offset);
+    __m256i b1 = load4(rows.src1 + offset + 16);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(rows.y0 + x),
+                     pack_bytes(dot8(a0, b0, y_coefficients, y_bias, kShift)));
+    if (rows.y1 != nullptr) {
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(rows.y1 + x),
+                       pack_bytes(dot8(a1, b1, y_coefficients, y_bias, kShift)));
+    }
+
+    // u0 v0 u1 v1 u2 v2 u3 v3
+    __m128i uv = pack_bytes(dot8(block_sums(a0, a1), block_sums(b0, b1), uv_coefficients, c_bias, kShift + 2));
+    ptrdiff_t sample = static_cast<ptrdiff_t>(x / 2) * rows.chroma_step;
+    if (rows.chroma_step == 2) {
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(rows.u + sample), uv);
+      continue;
+    }
+    uv = _mm_shuffle_epi8(uv, split_uv);
+    int32_t u = _mm_cvtsi128_si32(uv);
+    int32_t v = _mm_cvtsi128_si32(_mm_srli_si128(uv, 4));
+    std::memcpy(rows.u + sample, &u, sizeof(u));
+    std::memcpy(rows.v + sample, &v, sizeof(v));
+  }
+  return x;
+}
+#endif
+
+}  // namespace
+
+auto yuv_frame_size(YuvFormat format, int width, int height) noexcept -> size_t {
+  if (format == kYuvNone || width <= 0 || height <= 0) return 0;
+  size_t chroma = static_cast<size_t>((width + 1) / 2) * static_cast<size_t>((height + 1) / 2);
+  return static_cast<size_t>(width) * static_cast<size_t>(height) + 2 * chroma;
+}
+
+auto convert_to_yuv(YuvFormat format, YuvColorSpace color_space, ImageView const& image, unsigned char* out) noexcept
+    -> bool {
+  if ((format != kYuvNv12 && format != kYuvI420) || (image.components != 3 && image.components != 4)) return false;
+
+  Coefficients c = coefficients(color_space);
+  auto luma_size = static_cast<ptrdiff_t>(image.width) * image.height;
+  ptrdiff_t chroma_width = (image.width + 1) / 2;
+  ptrdiff_t chroma_size = chroma_width * ((image.height + 1) / 2);
+  bool nv12 = format == kYuvNv12;
+  bool vectorised = image.components == 4 && cpu::has_avx2();
+
+  for (int y = 0; y < image.height; y += 2) {
+    bool has_second = y + 1 < image.height;
+    ptrdiff_t chroma_row = static_cast<ptrdiff_t>(y / 2) * chroma_width;
+    RowPair rows{
+        .src0 = image.row(y),
+        .src1 = image.row(has_second ? y + 1 : y),
+        .y0 = out + static_cast<ptrdiff_t>(y) * image.width,
+        .y1 = has_second ? out + static_cast<ptrdiff_t>(y + 1) * image.width : nullptr,
+        .u = out + luma_size + (nv12 ? 2 * chroma_row : chroma_row),
+        .v = out + luma_size + (nv12 ? 2 * chroma_row + 1 : chroma_size + chroma_row),
+        .chroma_step = nv12 ? 2 : 1,
+    };
+    int x = 0;
+#ifdef READBACK_X86
+    if (vectorised) x = convert_avx2(rows, c, image.width);
+#endif
+    convert_scalar(rows, c, image.components, x, image.width);
+  }
+  static_cast<void>(vectorised);
+  return true;
+}
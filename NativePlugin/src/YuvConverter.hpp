@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+
+#include "ImageEncoder.hpp"
+#include "OpenGLAsyncGPUReadbackPluginAPI.hpp"
+
+/**
+ * @return size in bytes of a frame in a 4:2:0 format, planes of odd sized frames are rounded up to whole chroma
+ * samples, 0 for kYuvNone
+ */
+[[nodiscard]] auto yuv_frame_size(YuvFormat format, int width, int height) noexcept -> size_t;
+
+/**
+ * @brief Convert RGB(A) pixels to a 4:2:0 frame with the luma plane followed by the chroma planes, top row first.
+ * Chroma is averaged over 2x2 blocks, edges of odd sized images repeat the last row or column. RGBA pixels are
+ * converted 8 at a time with AVX2 where the CPU supports it, with the same result as the scalar code
+ * @param format output layout
+ * @param color_space matrix and range of the output
+ * @param image pixels with 3 or 4 components, alpha is ignored
+ * @param out yuv_frame_size() bytes
+ * @return false if the image does not have 3 or 4 components or the format is kYuvNone
+ */
+[[nodiscard]] auto convert_to_yuv(YuvFormat format, YuvColorSpace color_space, ImageView const& image,
+                                  unsigned char* out) noexcept -> bool;
@@ -0,0 +1,454 @@
+#include "MockGL.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "TypeHelpers.hpp"
+
+namespace {
+
+using std::chrono::nanoseconds;
+
+struct Texture {
+  GLsizei width = 0;
+  GLsizei height = 0;
+  GLenum internal_format = 0;
+  GLenum target = GL_TEXTURE_2D;
+  std::vector<uint8_t> data;
+};
+
+/**
+ * @brief Everything behind the entry points, calls may come from any thread
+ */
+struct State {
+  std::recursive_mutex mutex;
+  mock_gl::Config config;
+  nanoseconds now{0};
+  // the simulated GPU runs the copies in order, fences signal after all work issued before them
+  nanoseconds gpu_busy_until{0};
+  nanoseconds pending_work{0};
+  std::map<std::string, size_t> calls;
+
+  GLuint next_name = 1;
+  std::map<GLuint, std::vector<uint8_t>> buffers;
+  std::vector<GLuint> external_buffers;
+  std::map<GLuint, Texture> textures;
+  std::map<GLuint, GLuint> framebuffers;
+  std::map<GLuint, nanoseconds> queries;
+  std::map<uintptr_t, nanoseconds> fences;
+  uintptr_t next_fence = 1;
+
+  std::map<GLenum, GLuint> buffer_bindings;
+  GLuint texture_binding = 0;
+  GLuint framebuffer_binding = 0;
+  GLint pack_alignment = 4;
+
+  bool debug_output = false;
+  GLDEBUGPROC debug_callback = nullptr;
+  void const* debug_user_param = nullptr;
+
+  auto enter(char const* name) -> std::unique_lock<std::recursive_mutex> {
+    std::unique_lock lock(mutex);
+    ++calls[name];
+    return lock;
+  }
+
+  void add_work(size_t bytes) {
+    pending_work += config.copy_cost_per_mib * static_cast<int64_t>(bytes) / (1 << 20);
+  }
+
+  auto bound_buffer(GLenum target) -> std::vector<uint8_t>* {
+    auto binding = buffer_bindings.find(target);
+    if (binding == buffer_bindings.end()) return nullptr;
+    auto buffer = buffers.find(binding->second);
+    return buffer == buffers.end() ? nullptr : &buffer->second;
+  }
+
+  [[nodiscard]] auto is_signalled(uintptr_t fence) const -> bool { return now >= fences.at(fence); }
+};
+
+State state;
+
+auto to_fence(GLsync sync) -> uintptr_t { return reinterpret_cast<uintptr_t>(sync); }
+
+// GLEW loaded entry points
+
+void GLAPIENTRY gen_buffers(GLsizei n, GLuint* names) {
+  auto lock = state.enter("GenBuffers");
+  for (GLsizei i = 0; i < n; ++i) {
+    names[i] = state.next_name++;
+    state.buffers[names[i]];
+  }
+}
+
+void GLAPIENTRY delete_buffers(GLsizei n, GLuint const* names) {
+  auto lock = state.enter("DeleteBuffers");
+  for (GLsizei i = 0; i < n; ++i) state.buffers.erase(names[i]);
+}
+
+void GLAPIENTRY bind_buffer(GLenum target, GLuint name) {
+  auto lock = state.enter("BindBuffer");
+  state.buffer_bindings[target] = name;
+}
+
+void GLAPIENTRY buffer_data(GLenum target, GLsizeiptr size, void const* data, GLenum /* usage */) {
+  auto lock = state.enter("BufferData");
+  if (auto* buffer = state.bound_buffer(target)) {
+    buffer->assign(static_cast<size_t>(size), 0);
+    if (data != nullptr) std::memcpy(buffer->data(), data, static_cast<size_t>(size));
+  }
+}
+
+void GLAPIENTRY copy_buffer_sub_data(GLenum read_target, GLenum write_target, GLintptr read_offset,
+                                     GLintptr write_offset, GLsizeiptr size) {
+  auto lock = state.enter("CopyBufferSubData");
+  auto* source = state.bound_buffer(read_target);
+  auto* destination = state.bound_buffer(write_target);
+  if (source == nullptr || destination == nullptr) return;
+  if (static_cast<size_t>(read_offset + size) > source->size()) return;
+  if (static_cast<size_t>(write_offset + size) > destination->size()) return;
+  std::memcpy(destination->data() + write_offset, source->data() + read_offset, static_cast<size_t>(size));
+  state.add_work(static_cast<size_t>(size));
+}
+
+auto GLAPIENTRY map_buffer_range(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield /* access */)
+    -> void* {
+  auto lock = state.enter("MapBufferRange");
+  std::this_thread::sleep_for(state.config.map_stall);
+  auto* buffer = state.bound_buffer(target);
+  if (state.config.fail_maps || buffer == nullptr) return nullptr;
+  if (static_cast<size_t>(offset + length) > buffer->size()) return nullptr;
+  return buffer->data() + offset;
+}
+
+auto GLAPIENTRY unmap_buffer(GLenum /* target */) -> GLboolean {
+  auto lock = state.enter("UnmapBuffer");
+  return GL_TRUE;
+}
+
+auto GLAPIENTRY fence_sync(GLenum /* condition */, GLbitfield /* flags */) -> GLsync {
+  auto lock = state.enter("FenceSync");
+  state.gpu_busy_until = std::max(state.gpu_busy_until, state.now) + state.pending_work;
+  state.pending_work = nanoseconds{0};
+  uintptr_t fence = state.next_fence++;
+  state.fences[fence] = state.gpu_busy_until + state.config.fence_delay;
+  return reinterpret_cast<GLsync>(fence);
+}
+
+void GLAPIENTRY delete_sync(GLsync sync) {
+  auto lock = state.enter("DeleteSync");
+  state.fences.erase(to_fence(sync));
+}
+
+auto GLAPIENTRY client_wait_sync(GLsync sync, GLbitfield /* flags */, GLuint64 timeout) -> GLenum {
+  auto lock = state.enter("ClientWaitSync");
+  auto fence = state.fences.find(to_fence(sync));
+  if (fence == state.fences.end() || state.config.fail_waits) return GL_WAIT_FAILED;
+  if (state.now >= fence->second) return GL_ALREADY_SIGNALED;
+
+  // waiting is what moves the clock forward
+  nanoseconds remaining = fence->second - state.now;
+  if (timeout < static_cast<GLuint64>(remaining.count())) {
+    state.now += nanoseconds(static_cast<int64_t>(timeout));
+    return GL_TIMEOUT_EXPIRED;
+  }
+  state.now = fence->second;
+  return GL_CONDITION_SATISFIED;
+}
+
+void GLAPIENTRY get_synciv(GLsync sync, GLenum pname, GLsizei count, GLsizei* length, GLint* values) {
+  auto lock = state.enter("GetSynciv");
+  auto fence = state.fences.find(to_fence(sync));
+  if (fence == state.fences.end() || pname != GL_SYNC_STATUS || count < 1) {
+    if (length != nullptr) *length = 0;
+    return;
+  }
+  *values = state.is_signalled(fence->first) ? GL_SIGNALED : GL_UNSIGNALED;
+  if (length != nullptr) *length = 1;
+}
+
+void GLAPIENTRY gen_framebuffers(GLsizei n, GLuint* names) {
+  auto lock = state.enter("GenFramebuffers");
+  for (GLsizei i = 0; i < n; ++i) {
+    names[i] = state.next_name++;
+    state.framebuffers[names[i]] = 0;
+  }
+}
+
+void GLAPIENTRY delete_framebuffers(GLsizei n, GLuint const* names) {
+  auto lock = state.enter("DeleteFramebuffers");
+  for (GLsizei i = 0; i < n; ++i) state.framebuffers.erase(names[i]);
+}
+
+void GLAPIENTRY bind_framebuffer(GLenum /* target */, GLuint name) {
+  auto lock = state.enter("BindFramebuffer");
+  state.framebuffer_binding = name;
+}
+
+void GLAPIENTRY framebuffer_texture(GLenum /* target */, GLenum /* attachment */, GLuint texture, GLint /* level */) {
+  auto lock = state.enter("FramebufferTexture");
+  state.framebuffers[state.framebuffer_binding] = texture;
+}
+
+auto GLAPIENTRY check_framebuffer_status(GLenum /* target */) -> GLenum {
+  auto lock = state.enter("CheckFramebufferStatus");
+  auto framebuffer = state.framebuffers.find(state.framebuffer_binding);
+  if (state.config.incomplete_framebuffers || framebuffer == state.framebuffers.end()) return GL_FRAMEBUFFER_UNDEFINED;
+  return state.textures.contains(framebuffer->second) ? GL_FRAMEBUFFER_COMPLETE
+                                                      : GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT;
+}
+
+void GLAPIENTRY debug_message_callback(GLDEBUGPROC callback, void const* user_param) {
+  auto lock = state.enter("DebugMessageCallback");
+  state.debug_callback = callback;
+  state.debug_user_param = user_param;
+}
+
+void GLAPIENTRY debug_message_control(GLenum /* source */, GLenum /* type */, GLenum /* severity */,
+                                      GLsizei /* count */, GLuint const* /* ids */, GLboolean /* enabled */) {
+  auto lock = state.enter("DebugMessageControl");
+}
+
+void GLAPIENTRY gen_queries(GLsizei n, GLuint* names) {
+  auto lock = state.enter("GenQueries");
+  for (GLsizei i = 0; i < n; ++i) {
+    names[i] = state.next_name++;
+    state.queries[names[i]] = nanoseconds{0};
+  }
+}
+
+void GLAPIENTRY delete_queries(GLsizei n, GLuint const* names) {
+  auto lock = state.enter("DeleteQueries");
+  for (GLsizei i = 0; i < n; ++i) state.queries.erase(names[i]);
+}
+
+void GLAPIENTRY query_counter(GLuint name, GLenum /* target */) {
+  auto lock = state.enter("QueryCounter");
+  state.queries[name] = std::max(state.gpu_busy_until, state.now) + state.pending_work;
+}
+
+void GLAPIENTRY get_query_objectui64v(GLuint name, GLenum /* pname */, GLuint64* value) {
+  auto lock = state.enter("GetQueryObjectui64v");
+  *value = static_cast<GLuint64>(state.queries[name].count());
+}
+
+void GLAPIENTRY get_integer64v(GLenum pname, GLint64* value) {
+  auto lock = state.enter("GetInteger64v");
+  *value = pname == GL_TIMESTAMP ? state.now.count() : 0;
+}
+
+}  // namespace
+
+// OpenGL 1.1 entry points, linked directly instead of loaded by GLEW
+
+void GLAPIENTRY glBindTexture(GLenum target, GLuint texture) {
+  auto lock = state.enter("BindTexture");
+  // textures cannot be bound to another target than the one they were created for
+  auto iter = state.textures.find(texture);
+  if (iter != state.textures.end() && iter->second.target != target) return;
+  state.texture_binding = texture;
+}
+
+void GLAPIENTRY glFlush() { auto lock = state.enter("Flush"); }
+
+void GLAPIENTRY glEnable(GLenum cap) {
+  auto lock = state.enter("Enable");
+  if (cap == GL_DEBUG_OUTPUT) state.debug_output = true;
+}
+
+void GLAPIENTRY glDisable(GLenum cap) {
+  auto lock = state.enter("Disable");
+  if (cap == GL_DEBUG_OUTPUT) state.debug_output = false;
+}
+
+auto GLAPIENTRY glIsEnabled(GLenum cap) -> GLboolean {
+  auto lock = state.enter("IsEnabled");
+  return cap == GL_DEBUG_OUTPUT && state.debug_output ? GL_TRUE : GL_FALSE;
+}
+
+void GLAPIENTRY glGetPointerv(GLenum pname, void** params) {
+  auto lock = state.enter("GetPointerv");
+  if (pname == GL_DEBUG_CALLBACK_FUNCTION) {
+    *params = reinterpret_cast<void*>(state.debug_callback);  // NOLINT: returned as a data pointer by GL
+  } else if (pname == GL_DEBUG_CALLBACK_USER_PARAM) {
+    *params = const_cast<void*>(state.debug_user_param);  // NOLINT
+  } else {
+    *params = nullptr;
+  }
+}
+
+void GLAPIENTRY glGetIntegerv(GLenum pname, GLint* params) {
+  auto lock = state.enter("GetIntegerv");
+  switch (pname) {
+    case GL_PACK_ALIGNMENT: *params = state.pack_alignment; break;
+    case GL_TEXTURE_BINDING_2D: *params = static_cast<GLint>(state.texture_binding); break;
+    default: *params = 0; break;
+  }
+}
+
+void GLAPIENTRY glPixelStorei(GLenum pname, GLint param) {
+  auto lock = state.enter("PixelStorei");
+  if (pname == GL_PACK_ALIGNMENT) state.pack_alignment = param;
+}
+
+void GLAPIENTRY glGetTexLevelParameteriv(GLenum /* target */, GLint level, GLenum pname, GLint* params) {
+  auto lock = state.enter("GetTexLevelParameteriv");
+  auto texture = state.textures.find(state.texture_binding);
+  *params = 0;
+  if (texture == state.textures.end() || level != 0) return;
+  switch (pname) {
+    case GL_TEXTURE_WIDTH: *params = texture->second.width; break;
+    case GL_TEXTURE_HEIGHT: *params = texture->second.height; break;
+    case GL_TEXTURE_DEPTH: *params = 1; break;
+    case GL_TEXTURE_INTERNAL_FORMAT: *params = static_cast<GLint>(texture->second.internal_format); break;
+    default: break;
+  }
+}
+
+void GLAPIENTRY glReadBuffer(GLenum /* mode */) { auto lock = state.enter("ReadBuffer"); }
+
+void GLAPIENTRY glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum /* format */, GLenum /* type */,
+                             void* pixels) {
+  auto lock = state.enter("ReadPixels");
+  auto attachment = state.framebuffers.find(state.framebuffer_binding);
+  auto* pack_buffer = state.bound_buffer(GL_PIXEL_PACK_BUFFER);
+  if (attachment == state.framebuffers.end() || pack_buffer == nullptr) return;
+  auto texture = state.textures.find(attachment->second);
+  if (texture == state.textures.end()) return;
+
+  // reads the stored format as is, the plugin always asks for the texture's own format and type
+  Texture const& source = texture->second;
+  auto pixel_size = static_cast<size_t>(getPixelSizeFromInternalFormat(static_cast<int>(source.internal_format)) / 8);
+  auto alignment = static_cast<size_t>(state.pack_alignment);
+  size_t row_size = pixel_size * static_cast<size_t>(width);
+  size_t stride = (row_size + alignment - 1) / alignment * alignment;
+  auto offset = reinterpret_cast<uintptr_t>(pixels);
+  for (GLsizei row = 0; row < height; ++row) {
+    size_t to = offset + static_cast<size_t>(row) * stride;
+    size_t from = (static_cast<size_t>(y + row) * static_cast<size_t>(source.width) + static_cast<size_t>(x));
+    from *= pixel_size;
+    if (to + row_size > pack_buffer->size() || from + row_size > source.data.size()) return;
+    std::memcpy(pack_buffer->data() + to, source.data.data() + from, row_size);
+  }
+  state.add_work(row_size * static_cast<size_t>(height));
+}
+
+namespace mock_gl {
+
+void install(Config const& config) {
+  std::scoped_lock guard(state.mutex);
+  state.config = config;
+  state.now = state.gpu_busy_until = state.pending_work = nanoseconds{0};
+  state.calls.clear();
+  state.buffers.clear();
+  state.external_buffers.clear();
+  state.textures.clear();
+  state.framebuffers.clear();
+  state.queries.clear();
+  state.fences.clear();
+  state.buffer_bindings.clear();
+  state.texture_binding = state.framebuffer_binding = 0;
+  state.pack_alignment = 4;
+  state.debug_output = false;
+  state.debug_callback = nullptr;
+  state.debug_user_param = nullptr;
+
+  __glewGenBuffers = gen_buffers;
+  __glewDeleteBuffers = delete_buffers;
+  __glewBindBuffer = bind_buffer;
+  __glewBufferData = buffer_data;
+  __glewCopyBufferSubData = copy_buffer_sub_data;
+  __glewMapBufferRange = map_buffer_range;
+  __glewUnmapBuffer = unmap_buffer;
+  __glewFenceSync = fence_sync;
+  __glewDeleteSync = delete_sync;
+  __glewClientWaitSync = client_wait_sync;
+  __glewGetSynciv = get_synciv;
+  __glewGenFramebuffers = gen_framebuffers;
+  __glewDeleteFramebuffers = delete_framebuffers;
+  __glewBindFramebuffer = bind_framebuffer;
+  __glewFramebufferTexture = framebuffer_texture;
+  __glewCheckFramebufferStatus = check_framebuffer_status;
+  __glewDebugMessageCallback = debug_message_callback;
+  __glewDebugMessageControl = debug_message_control;
+  __glewGenQueries = gen_queries;
+  __glewDeleteQueries = delete_queries;
+  __glewQueryCounter = query_counter;
+  __glewGetQueryObjectui64v = get_query_objectui64v;
+  __glewGetInteger64v = get_integer64v;
+}
+
+auto create_texture(GLsizei width, GLsizei height, GLenum internal_format, std::vector<uint8_t> data, GLenum target)
+    -> GLuint {
+  std::scoped_lock guard(state.mutex);
+  GLuint name = state.next_name++;
+  state.textures[name] = Texture{
+      .width = width,
+      .height = height,
+      .internal_format = internal_format,
+      .target = target,
+      .data = std::move(data),
+  };
+  return name;
+}
+
+auto create_buffer(std::vector<uint8_t> data) -> GLuint {
+  std::scoped_lock guard(state.mutex);
+  GLuint name = state.next_name++;
+  state.buffers[name] = std::move(data);
+  state.external_buffers.push_back(name);
+  return name;
+}
+
+void advance(nanoseconds duration) {
+  std::scoped_lock guard(state.mutex);
+  state.now += duration;
+}
+
+auto now() -> nanoseconds {
+  std::scoped_lock guard(state.mutex);
+  return state.now;
+}
+
+auto calls(std::string const& name) -> size_t {
+  std::scoped_lock guard(state.mutex);
+  auto iter = state.calls.find(name);
+  return iter == state.calls.end() ? 0 : iter->second;
+}
+
+auto live_buffers() -> size_t {
+  std::scoped_lock guard(state.mutex);
+  return state.buffers.size() - static_cast<size_t>(std::count_if(
+                                    state.external_buffers.begin(), state.external_buffers.end(),
+                                    [](GLuint name) { return state.buffers.contains(name); }));
+}
+
+auto live_fences() -> size_t {
+  std::scoped_lock guard(state.mutex);
+  return state.fences.size();
+}
+
+auto live_framebuffers() -> size_t {
+  std::scoped_lock guard(state.mutex);
+  return state.framebuffers.size();
+}
+
+void debug_message(GLenum type, std::string const& message) {
+  GLDEBUGPROC callback = nullptr;
+  void const* user_param = nullptr;
+  {
+    std::scoped_lock guard(state.mutex);
+    if (!state.debug_output) return;
+    callback = state.debug_callback;
+    user_param = state.debug_user_param;
+  }
+  if (callback != nullptr) {
+    callback(GL_DEBUG_SOURCE_API, type, 0, GL_DEBUG_SEVERITY_MEDIUM, static_cast<GLsizei>(message.size()),
+             message.c_str(), user_param);
+  }
+}
+
+}  // namespace mock_gl
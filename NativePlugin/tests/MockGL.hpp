@@ -0,0 +1,73 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Fake OpenGL implementation for running the plugin without a driver
+ *
+ * install() points GLEW's function pointers at the mock, the OpenGL 1.1 entry points GLEW does not load are defined
+ * by MockGL.cpp itself and take the place of the system library at link time. Buffers and textures live in host
+ * memory and copies happen immediately, but fences only signal once the simulated GPU has finished the copies issued
+ * before them. GPU time is a virtual clock that only moves forward through advance() and client waits, so tests are
+ * deterministic regardless of how fast they run.
+ */
+namespace mock_gl {
+
+struct Config {
+  /** @brief time from the end of the copies to the fence signalling */
+  std::chrono::nanoseconds fence_delay{0};
+  /** @brief simulated GPU time per MiB of buffer copies and pixel reads */
+  std::chrono::nanoseconds copy_cost_per_mib{0};
+  /** @brief make glMapBufferRange fail */
+  bool fail_maps = false;
+  /** @brief make glClientWaitSync fail */
+  bool fail_waits = false;
+  /** @brief report framebuffers as incomplete */
+  bool incomplete_framebuffers = false;
+  /** @brief real time glMapBufferRange blocks for, as drivers do when a buffer is mapped before its copy finished */
+  std::chrono::nanoseconds map_stall{0};
+};
+
+/**
+ * @brief Reset all objects, counters and the clock and point GLEW at the mock
+ */
+void install(Config const& config = {});
+
+/**
+ * @brief Create a texture with tightly packed pixel data for the given sized internal format, only a 2D texture's data
+ * can be read
+ */
+auto create_texture(GLsizei width, GLsizei height, GLenum internal_format, std::vector<uint8_t> data,
+                    GLenum target = GL_TEXTURE_2D) -> GLuint;
+auto create_buffer(std::vector<uint8_t> data) -> GLuint;
+
+/**
+ * @brief Move the virtual clock forward
+ */
+void advance(std::chrono::nanoseconds duration);
+[[nodiscard]] auto now() -> std::chrono::nanoseconds;
+
+/**
+ * @return number of calls to an entry point since install(), by name without the gl prefix, e.g. "FenceSync"
+ */
+[[nodiscard]] auto calls(std::string const& name) -> size_t;
+
+/**
+ * @return number of buffers, fences and framebuffers the plugin has not deleted yet
+ */
+[[nodiscard]] auto live_buffers() -> size_t;
+[[nodiscard]] auto live_fences() -> size_t;
+[[nodiscard]] auto live_framebuffers() -> size_t;
+
+/**
+ * @brief Emit a KHR_debug message to the installed callback, if debug output is enabled
+ */
+void debug_message(GLenum type, std::string const& message);
+
+}  // namespace mock_gl
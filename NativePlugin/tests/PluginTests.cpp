@@ -0,0 +1,1962 @@
+/**
+ * Request lifecycle and scheduling tests against the mock GL backend. GPU time only moves when a test advances it, so
+ * the number of frames a request takes is exact.
+ *
+ * usage: PluginTests [test name], lists the tests without a name
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <coroutine>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "FloatConverter.hpp"
+#include "LeakCheck.hpp"
+#include "MockGL.hpp"
+#include "OpenGLAsyncGPUReadbackPlugin.hpp"
+#include "PostProcess.hpp"
+#include "ReadbackThread.hpp"
+#include "RequestScheduler.hpp"
+#include "SharedContext.hpp"
+#include "Test.hpp"
+#include "WorkerPool.hpp"
+#include "YuvConverter.hpp"
+
+namespace {
+
+using std::chrono::milliseconds;
+using std::chrono::nanoseconds;
+
+constexpr int kMaxFrames = 100;
+
+void setup(mock_gl::Config const& config = {}) {
+  mock_gl::install(config);
+  SetGLIssuePluginEventPtr(RenderQueue::issue_plugin_event);
+}
+
+/**
+ * @brief Let the GPU run for gpu_time, then update the plugin and run the render thread events of the frame
+ */
+void frame(nanoseconds gpu_time = nanoseconds{0}) {
+  mock_gl::advance(gpu_time);
+  MainThread_UpdateOnce();
+  RenderQueue::instance().pump();
+}
+
+/**
+ * @return number of frames until the request is done, kMaxFrames if it never is
+ */
+auto frames_until_done(EventId event_id, nanoseconds gpu_time_per_frame) -> int {
+  int frames = 0;
+  while (!Request_Done(event_id) && frames < kMaxFrames) {
+    frame(gpu_time_per_frame);
+    ++frames;
+  }
+  return frames;
+}
+
+auto pattern(size_t size) -> std::vector<uint8_t> {
+  std::vector<uint8_t> data(size);
+  for (size_t i = 0; i < size; ++i) data[i] = static_cast<uint8_t>(i * 7 + 3);
+  return data;
+}
+
+auto has_data(EventId event_id, std::vector<uint8_t> const& expected) -> bool {
+  void* data = nullptr;
+  size_t length = 0;
+  if (!Request_GetData(event_id, &data, &length) || length != expected.size()) return false;
+  return std::memcmp(data, expected.data(), length) == 0;
+}
+
+auto stats() -> PluginStats {
+  PluginStats stats;
+  Plugin_GetStats(&stats);
+  return stats;
+}
+
+}  // namespace
+
+TEST_CASE(buffer_readback) {
+  setup();
+  std::vector<uint8_t> expected = pattern(1000);
+  GLuint buffer = mock_gl::create_buffer(expected);
+
+  EventId event_id = Request_ComputeBuffer(buffer, static_cast<GLsizeiptr>(expected.size()));
+  RenderQueue::instance().pump();
+  CHECK(mock_gl::calls("FenceSync") == 1);
+  CHECK(frames_until_done(event_id, nanoseconds{0}) == 1);
+  CHECK(!Request_Error(event_id));
+  CHECK(has_data(event_id, expected));
+
+  // the staging buffer and fence go as soon as the data is copied out, the request two updates later
+  CHECK(mock_gl::live_buffers() == 0);
+  CHECK(mock_gl::live_fences() == 0);
+  frame();
+  CHECK(Request_Exists(event_id));
+  frame();
+  CHECK(!Request_Exists(event_id));
+}
+
+TEST_CASE(texture_readback) {
+  setup();
+  std::vector<uint8_t> expected = pattern(size_t{5} * 3 * 4);
+  GLuint texture = mock_gl::create_texture(5, 3, GL_RGBA8, expected);
+
+  EventId event_id = Request_Texture(texture, 0);
+  RenderQueue::instance().pump();
+  CHECK(frames_until_done(event_id, nanoseconds{0}) == 1);
+  CHECK(!Request_Error(event_id));
+  CHECK(has_data(event_id, expected));
+  CHECK(mock_gl::calls("GenFramebuffers") == 1);
+  CHECK(mock_gl::calls("DeleteFramebuffers") == 1);
+  CHECK(mock_gl::live_buffers() == 0);
+}
+
+TEST_CASE(non_2d_texture) {
+  setup();
+  GLuint texture = mock_gl::create_texture(4, 4, GL_RGBA8, pattern(size_t{4} * 4 * 4 * 2), GL_TEXTURE_2D_ARRAY);
+  GLuint texture_2d = mock_gl::create_texture(4, 4, GL_RGBA8, pattern(64));
+
+  // fails before anything is created, rather than reading whichever 2D texture was bound before
+  EventId event_id = Request_Texture(texture_2d, 0);
+  EventId layered = Request_Texture(texture, 0);
+  RenderQueue::instance().pump();
+  CHECK(frames_until_done(layered, nanoseconds{0}) <= 1);
+  CHECK(Request_Error(layered) && !Request_Error(event_id));
+  CHECK(mock_gl::calls("GenBuffers") == 1 && mock_gl::calls("GenFramebuffers") == 1);
+  CHECK(stats().errors == 1);
+}
+
+TEST_CASE(fence_delay) {
+  setup({.fence_delay = milliseconds(3)});
+  GLuint buffer = mock_gl::create_buffer(pattern(256));
+
+  EventId event_id = Request_ComputeBuffer(buffer, 256);
+  RenderQueue::instance().pump();
+  CHECK(frames_until_done(event_id, milliseconds(1)) == 3);
+  CHECK(!Request_Error(event_id));
+}
+
+TEST_CASE(copies_are_serialised) {
+  setup({.copy_cost_per_mib = milliseconds(1)});
+  constexpr size_t kSize = size_t{4} << 20;
+  GLuint buffer = mock_gl::create_buffer(pattern(kSize));
+
+  EventId first = Request_ComputeBuffer(buffer, kSize);
+  EventId second = Request_ComputeBuffer(buffer, kSize);
+  RenderQueue::instance().pump();
+  CHECK(frames_until_done(first, milliseconds(1)) == 4);
+  CHECK(!Request_Done(second));
+  CHECK(frames_until_done(second, milliseconds(1)) == 4);
+  CHECK(has_data(second, pattern(kSize)));
+}
+
+TEST_CASE(poll_newest_fence_only) {
+  constexpr int kRequests = 8;
+  auto run = [](bool newest_only) {
+    setup({.fence_delay = milliseconds(5)});
+    SetPollNewestFenceOnly(newest_only);
+    GLuint buffer = mock_gl::create_buffer(pattern(64));
+    std::vector<EventId> event_ids;
+    for (int i = 0; i < kRequests; ++i) event_ids.push_back(Request_ComputeBuffer(buffer, 64));
+    RenderQueue::instance().pump();
+    CHECK(frames_until_done(event_ids.back(), milliseconds(1)) == 5);
+    for (EventId event_id : event_ids) CHECK(Request_Done(event_id) && !Request_Error(event_id));
+    return mock_gl::calls("GetSynciv");
+  };
+
+  // one status query per frame either way, but only one for the whole batch once they have signalled
+  size_t every_fence = run(false);
+  size_t newest_only = run(true);
+  CHECK(newest_only == 5);
+  CHECK(every_fence == 4 + kRequests);
+}
+
+TEST_CASE(frame_budget) {
+  setup();
+  SetFrameBudget(0, 1);
+  GLuint buffer = mock_gl::create_buffer(pattern(64));
+
+  std::vector<EventId> event_ids;
+  for (int i = 0; i < 4; ++i) event_ids.push_back(Request_ComputeBuffer(buffer, 64));
+  RenderQueue::instance().pump();
+  CHECK(mock_gl::calls("FenceSync") == 1);
+  for (size_t issued = 2; issued <= event_ids.size(); ++issued) {
+    frame();
+    CHECK(mock_gl::calls("FenceSync") == issued);
+    // the previous frame's request completes in the same update
+    CHECK(Request_Done(event_ids[issued - 2]) && !Request_Error(event_ids[issued - 2]));
+  }
+  frame();
+  CHECK(Request_Done(event_ids.back()) && !Request_Error(event_ids.back()));
+}
+
+TEST_CASE(map_failure) {
+  setup({.fail_maps = true});
+  GLuint buffer = mock_gl::create_buffer(pattern(64));
+
+  EventId event_id = Request_ComputeBuffer(buffer, 64);
+  RenderQueue::instance().pump();
+  CHECK(frames_until_done(event_id, nanoseconds{0}) == 1);
+  CHECK(Request_Error(event_id));
+  CHECK(mock_gl::live_buffers() == 0);
+  CHECK(mock_gl::live_fences() == 0);
+
+  PluginStats after = stats();
+  CHECK(after.errors == 1);
+  CHECK(after.staging_bytes == 0);
+  CHECK(after.in_flight == 0);
+}
+
+TEST_CASE(wait_for_completion) {
+  setup({.fence_delay = milliseconds(20)});
+  RenderQueue::instance().start_thread();
+  std::vector<uint8_t> expected = pattern(128);
+  GLuint buffer = mock_gl::create_buffer(expected);
+
+  // blocking waits on the render thread are what moves the GPU clock here
+  EventId event_id = Request_ComputeBuffer(buffer, 128);
+  Request_WaitForCompletion(event_id);
+  RenderQueue::instance().stop_thread();
+  CHECK(Request_Done(event_id));
+  CHECK(has_data(event_id, expected));
+  CHECK(mock_gl::now() >= milliseconds(20));
+}
+
+TEST_CASE(wait_all_any) {
+  setup({.fence_delay = milliseconds(20)});
+  std::vector<uint8_t> expected = pattern(128);
+  GLuint buffer = mock_gl::create_buffer(expected);
+  EventId finished = Request_ComputeBuffer(buffer, 128);
+  RenderQueue::instance().pump();
+  CHECK(frames_until_done(finished, milliseconds(20)) == 1);
+  EventId unknown = finished + 1000;
+  EventId pending = Request_ComputeBuffer(buffer, 128);
+  RenderQueue::instance().pump();
+
+  // nothing moves the GPU clock until the render thread runs, finished and unknown requests count as done
+  std::array<EventId, 4> event_ids = {finished, unknown, pending, pending};
+  std::array<bool, 4> completed = {};
+  CHECK(!Request_WaitAll(event_ids.data(), event_ids.size(), 1'000'000, completed.data()));
+  CHECK(completed[0] && completed[1] && !completed[2] && !completed[3]);
+  completed = {};
+  CHECK(Request_WaitAny(event_ids.data(), event_ids.size(), 1'000'000, completed.data()));
+  CHECK(completed[0] && completed[1] && !completed[2] && !completed[3]);
+  CHECK(!Request_WaitAny(event_ids.data() + 2, 2, 1'000'000, completed.data()));
+  CHECK(!completed[0] && !completed[1]);
+
+  // the same request twice satisfies both kinds of wait once it is done
+  RenderQueue::instance().start_thread();
+  CHECK(Request_WaitAny(event_ids.data() + 2, 2, UINT64_MAX, completed.data()));
+  CHECK(completed[0] && completed[1]);
+  completed = {};
+  CHECK(Request_WaitAll(event_ids.data(), event_ids.size(), UINT64_MAX, completed.data()));
+  RenderQueue::instance().stop_thread();
+  CHECK(std::all_of(completed.begin(), completed.end(), [](bool done) { return done; }));
+  CHECK(has_data(pending, expected));
+  CHECK(Request_WaitAll(nullptr, 0, 0, nullptr));
+}
+
+TEST_CASE(trace_export) {
+  setup();
+  Plugin_SetTracing(true);
+  GLuint buffer = mock_gl::create_buffer(pattern(64));
+
+  EventId event_id = Request_ComputeBuffer(buffer, 64);
+  RenderQueue::instance().pump();
+  CHECK(frames_until_done(event_id, nanoseconds{0}) == 1);
+  frame();
+  frame();
+  CHECK(!Request_Exists(event_id));
+  Plugin_SetTracing(false);
+
+  std::filesystem::path path = std::filesystem::temp_directory_path() / "PluginTests_trace.json";
+  CHECK(Plugin_DumpTrace(path.string().c_str()));
+  std::stringstream contents;
+  contents << std::ifstream(path).rdbuf();
+  std::filesystem::remove(path);
+
+  std::string trace = contents.str();
+  std::string id = ",\"id\":" + std::to_string(event_id) + ",";
+  for (char const* event : {R"("ph":"b","name":"request")", R"("ph":"n","name":"started")",
+                            R"("ph":"n","name":"signalled")", R"("ph":"n","name":"copied")",
+                            R"("ph":"n","name":"done")", R"("ph":"e","name":"request")"}) {
+    CHECK(trace.find(std::string(event) + R"(,"cat":"request")" + id) != std::string::npos);
+  }
+  CHECK(trace.find(R"("ph":"B","name":"update_once")") != std::string::npos);
+  // the main and render threads are the same thread here
+  CHECK(trace.find(R"("ph":"M","name":"thread_name")") != std::string::npos);
+}
+
+TEST_CASE(event_id_wraparound) {
+  setup({.fence_delay = milliseconds(50)});
+  std::vector<uint8_t> expected = pattern(128);
+  GLuint buffer = mock_gl::create_buffer(expected);
+
+  Plugin::instance().set_next_event_id(INT_MAX);
+  EventId last = Request_ComputeBuffer(buffer, 128);
+  EventId wrapped = Request_ComputeBuffer(buffer, 128);
+  CHECK(last == INT_MAX);
+  CHECK(wrapped == INT_MIN);
+
+  // ids still in use are skipped once the counter comes around to them again
+  Plugin::instance().set_next_event_id(INT_MIN);
+  EventId next = Request_ComputeBuffer(buffer, 128);
+  CHECK(next == INT_MIN + 1);
+  Plugin::instance().set_next_event_id(INT_MAX);
+  EventId after_both = Request_ComputeBuffer(buffer, 128);
+  CHECK(after_both == INT_MIN + 2);
+
+  RenderQueue::instance().pump();
+  for (EventId event_id : {last, wrapped, next, after_both}) {
+    CHECK(Request_Exists(event_id));
+    CHECK(frames_until_done(event_id, milliseconds(1)) < kMaxFrames);
+    CHECK(!Request_Error(event_id));
+    CHECK(has_data(event_id, expected));
+  }
+}
+
+TEST_CASE(gl_resource_counters) {
+  setup({.fence_delay = milliseconds(2)});
+  GLuint buffer = mock_gl::create_buffer(pattern(256));
+  GLuint texture = mock_gl::create_texture(4, 4, GL_RGBA8, pattern(64));
+
+  std::vector<EventId> event_ids = {Request_ComputeBuffer(buffer, 256), Request_ComputeBuffer(buffer, 128),
+                                    Request_Texture(texture, 0)};
+  RenderQueue::instance().pump();
+  PluginStats during = stats();
+  CHECK(during.live_pbos == 3);
+  CHECK(during.live_fences == 3);
+  // framebuffers only live while the read is issued
+  CHECK(during.live_fbos == 0);
+  CHECK(during.peak_fbos == 1);
+  CHECK(during.peak_staging_bytes == 256 + 128 + 64);
+
+  for (EventId event_id : event_ids) CHECK(frames_until_done(event_id, milliseconds(1)) < kMaxFrames);
+  PluginStats after = stats();
+  CHECK(after.live_pbos == 0 && after.live_fbos == 0 && after.live_fences == 0);
+  CHECK(after.peak_pbos == 3 && after.peak_fences == 3);
+  CHECK(after.peak_staging_bytes == during.peak_staging_bytes);
+}
+
+TEST_CASE(incomplete_framebuffer) {
+  setup({.incomplete_framebuffers = true});
+  GLuint texture = mock_gl::create_texture(4, 4, GL_RGBA8, pattern(64));
+
+  // fails after the staging buffer was created, which has to go with it
+  EventId event_id = Request_Texture(texture, 0);
+  RenderQueue::instance().pump();
+  CHECK(Request_Done(event_id));
+  CHECK(Request_Error(event_id));
+  CHECK(mock_gl::calls("GenBuffers") == 1);
+  CHECK(mock_gl::live_buffers() == 0);
+  CHECK(mock_gl::live_framebuffers() == 0);
+  CHECK(mock_gl::live_fences() == 0);
+
+  PluginStats after = stats();
+  CHECK(after.errors == 1 && after.completed == 1 && after.in_flight == 0);
+  CHECK(after.staging_bytes == 0 && after.live_pbos == 0 && after.live_fbos == 0);
+}
+
+TEST_CASE(wait_failure) {
+  setup({.fail_waits = true});
+  SetPollNewestFenceOnly(true);
+  GLuint buffer = mock_gl::create_buffer(pattern(64));
+
+  EventId event_id = Request_ComputeBuffer(buffer, 64);
+  RenderQueue::instance().pump();
+  CHECK(frames_until_done(event_id, nanoseconds{0}) == 1);
+  CHECK(Request_Error(event_id));
+  CHECK(mock_gl::live_buffers() == 0);
+  CHECK(mock_gl::live_fences() == 0);
+
+  PluginStats after = stats();
+  CHECK(after.errors == 1 && after.completed == 1);
+  CHECK(after.staging_bytes == 0 && after.live_pbos == 0 && after.live_fences == 0);
+}
+
+TEST_CASE(leak_report) {
+  setup({.fence_delay = milliseconds(5)});
+  GLuint buffer = mock_gl::create_buffer(pattern(64));
+
+  EventId event_id = Request_ComputeBuffer(buffer, 64);
+  RenderQueue::instance().pump();
+  std::FILE* report = std::tmpfile();
+  CHECK(report != nullptr);
+  // the staging buffer and its fence
+  CHECK(LeakCheck::report(report) == 2);
+  std::rewind(report);
+  char line[256] = {};
+  CHECK(std::fgets(line, sizeof(line), report) != nullptr);
+  CHECK(std::string(line).find("of request " + std::to_string(event_id)) != std::string::npos);
+  std::fclose(report);
+
+  CHECK(frames_until_done(event_id, milliseconds(1)) < kMaxFrames);
+  CHECK(LeakCheck::report(stderr) == 0);
+}
+
+TEST_CASE(stall_detection) {
+  setup({.map_stall = milliseconds(3)});
+  Plugin_SetStallThreshold(1'000'000);
+  GLuint buffer = mock_gl::create_buffer(pattern(64));
+
+  EventId stalled = Request_ComputeBuffer(buffer, 64);
+  RenderQueue::instance().pump();
+  CHECK(frames_until_done(stalled, nanoseconds{0}) == 1);
+  RequestStalls stalls;
+  CHECK(Request_GetStalls(stalled, &stalls));
+  CHECK(stalls.stalled);
+  CHECK(stalls.map_ns >= 3'000'000);
+  CHECK(stalls.read_pixels_ns == 0);
+
+  // a threshold of 0 flags nothing, the time is still counted
+  Plugin_SetStallThreshold(0);
+  EventId unflagged = Request_ComputeBuffer(buffer, 64);
+  RenderQueue::instance().pump();
+  CHECK(frames_until_done(unflagged, nanoseconds{0}) == 1);
+  CHECK(Request_GetStalls(unflagged, &stalls));
+  CHECK(!stalls.stalled);
+
+  PluginStats after = stats();
+  CHECK(after.stalled_requests == 1);
+  CHECK(after.map_ns >= 6'000'000);
+  CHECK(!Request_GetStalls(stalled - 1000, &stalls));
+}
+
+namespace {
+
+int forwarded_messages = 0;
+
+void GLAPIENTRY count_message(GLenum /* source */, GLenum /* type */, GLuint /* id */, GLenum /* severity */,
+                              GLsizei /* length */, GLchar const* /* message */, void const* user_param) {
+  CHECK(user_param == &forwarded_messages);
+  ++forwarded_messages;
+}
+
+}  // namespace
+
+TEST_CASE(performance_messages) {
+  setup();
+  // stands in for a callback Unity installed
+  glDebugMessageCallback(count_message, &forwarded_messages);
+  Plugin_SetDebugMessageCapture(true);
+  frame();
+
+  mock_gl::debug_message(GL_DEBUG_TYPE_PERFORMANCE, "pixel transfer is synchronized with 3D rendering");
+  mock_gl::debug_message(GL_DEBUG_TYPE_OTHER, "buffer detailed info");
+  CHECK(forwarded_messages == 2);
+  CHECK(stats().performance_messages == 1);
+
+  char message[16] = {};
+  CHECK(Plugin_GetPerformanceMessage(0, message, sizeof(message)) == 48);
+  CHECK(std::string(message) == "pixel transfer ");
+  CHECK(Plugin_GetPerformanceMessage(1, message, sizeof(message)) == 0);
+
+  // the previous callback and debug output state come back
+  Plugin_SetDebugMessageCapture(false);
+  frame();
+  CHECK(glIsEnabled(GL_DEBUG_OUTPUT) == GL_FALSE);
+  glEnable(GL_DEBUG_OUTPUT);
+  mock_gl::debug_message(GL_DEBUG_TYPE_PERFORMANCE, "another");
+  CHECK(forwarded_messages == 3);
+  CHECK(stats().performance_messages == 1);
+}
+
+TEST_CASE(debug_messages_device_shutdown) {
+  setup();
+  forwarded_messages = 0;
+  glDebugMessageCallback(count_message, &forwarded_messages);
+  Plugin_SetDebugMessageCapture(true);
+  frame();
+
+  // the plugin may be unloaded before the next update, its callback must already be gone
+  Plugin::instance().device_shutdown();
+  CHECK(glIsEnabled(GL_DEBUG_OUTPUT) == GL_FALSE);
+  glEnable(GL_DEBUG_OUTPUT);
+  mock_gl::debug_message(GL_DEBUG_TYPE_PERFORMANCE, "after shutdown");
+  CHECK(forwarded_messages == 1);
+  CHECK(stats().performance_messages == 0);
+
+  // still enabled, so a new device gets it back
+  frame();
+  mock_gl::debug_message(GL_DEBUG_TYPE_PERFORMANCE, "new device");
+  CHECK(forwarded_messages == 2);
+  CHECK(stats().performance_messages == 1);
+  Plugin_SetDebugMessageCapture(false);
+  frame();
+}
+
+namespace {
+
+/**
+ * @brief Update until post-processing on the worker pool has finished the request
+ */
+auto wait_until_done(EventId event_id) -> bool {
+  for (int i = 0; i < 1000 && !Request_Done(event_id); ++i) {
+    frame();
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+  return Request_Done(event_id);
+}
+
+/**
+ * @brief Decode a QOI image to RGBA
+ */
+auto decode_qoi(std::vector<uint8_t> const& file, uint32_t& width, uint32_t& height) -> std::vector<uint8_t> {
+  auto u32 = [&file](size_t at) {
+    return uint32_t{file[at]} << 24U | uint32_t{file[at + 1]} << 16U | uint32_t{file[at + 2]} << 8U | file[at + 3];
+  };
+  CHECK(file.size() >= 22 && std::memcmp(file.data(), "qoif", 4) == 0);
+  width = u32(4);
+  height = u32(8);
+
+  std::vector<uint8_t> pixels;
+  std::array<std::array<uint8_t, 4>, 64> index{};
+  std::array<uint8_t, 4> pixel = {0, 0, 0, 255};
+  size_t at = 14;
+  while (pixels.size() < size_t{width} * height * 4) {
+    uint8_t op = file.at(at++);
+    int run = 1;
+    if (op == 0xFE) {
+      pixel = {file[at], file[at + 1], file[at + 2], pixel[3]};
+      at += 3;
+    } else if (op == 0xFF) {
+      pixel = {file[at], file[at + 1], file[at + 2], file[at + 3]};
+      at += 4;
+    } else if ((op >> 6U) == 0) {
+      pixel = index[op];
+    } else if ((op >> 6U) == 1) {
+      for (unsigned c = 0; c < 3; ++c) pixel[c] = static_cast<uint8_t>(pixel[c] + ((op >> (4U - 2 * c)) & 3U) - 2);
+    } else if ((op >> 6U) == 2) {
+      int dg = (op & 0x3F) - 32;
+      uint8_t next = file.at(at++);
+      pixel[0] = static_cast<uint8_t>(pixel[0] + dg - 8 + (next >> 4U));
+      pixel[1] = static_cast<uint8_t>(pixel[1] + dg);
+      pixel[2] = static_cast<uint8_t>(pixel[2] + dg - 8 + (next & 0xFU));
+    } else {
+      run = (op & 0x3F) + 1;
+    }
+    index[(pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64] = pixel;
+    for (int i = 0; i < run; ++i) pixels.insert(pixels.end(), pixel.begin(), pixel.end());
+  }
+  return pixels;
+}
+
+/**
+ * @brief Canonical Huffman code given by the number of codes of each length and the symbols in code order, as both
+ * deflate and JPEG describe them
+ */
+struct HuffmanCode {
+  std::array<int, 17> counts{};
+  std::vector<int> symbols;
+
+  /**
+   * @brief Code of the deflate code lengths of each symbol
+   */
+  static auto from_lengths(std::vector<int> const& lengths) -> HuffmanCode {
+    HuffmanCode code;
+    for (int length : lengths) ++code.counts.at(static_cast<size_t>(length));
+    code.counts[0] = 0;
+    for (int length = 1; length <= 16; ++length) {
+      for (size_t symbol = 0; symbol < lengths.size(); ++symbol) {
+        if (lengths[symbol] == length) code.symbols.push_back(static_cast<int>(symbol));
+      }
+    }
+    return code;
+  }
+
+  /**
+   * @param next_bit returns the next bit of the code, most significant first
+   */
+  template <typename NextBit>
+  [[nodiscard]] auto decode(NextBit&& next_bit) const -> int {
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (size_t length = 1; length <= 16; ++length) {
+      code |= next_bit();
+      if (code - counts[length] < first) return symbols.at(static_cast<size_t>(index + code - first));
+      index += counts[length];
+      first = (first + counts[length]) << 1;
+      code <<= 1;
+    }
+    throw std::runtime_error("invalid Huffman code");
+  }
+};
+
+/**
+ * @brief Inflate a zlib stream with stored and fixed Huffman blocks, checking its header and Adler-32
+ */
+auto inflate(std::vector<uint8_t> const& stream) -> std::vector<uint8_t> {
+  CHECK(stream.size() >= 6 && (stream[0] & 0x0FU) == 8 && (stream[0] << 8U | stream[1]) % 31 == 0);
+  CHECK((stream[1] & 0x20U) == 0);
+  size_t at = 2;
+  unsigned bit = 0;
+  auto bits = [&](int count) {
+    uint32_t value = 0;
+    for (int i = 0; i < count; ++i) {
+      value |= static_cast<uint32_t>((stream.at(at) >> bit) & 1U) << static_cast<unsigned>(i);
+      if (++bit == 8) {
+        bit = 0;
+        ++at;
+      }
+    }
+    return value;
+  };
+
+  constexpr std::array<int, 29> kLengthBase = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                               31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+  constexpr std::array<int, 29> kLengthExtra = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                                2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+  constexpr std::array<int, 30> kDistanceBase = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,
+                                                 33,  49,  65,  97,  129, 193,  257,  385,  513,  769,
+                                                 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+  std::vector<int> literal_lengths(288, 8);
+  std::fill(literal_lengths.begin() + 144, literal_lengths.begin() + 256, 9);
+  std::fill(literal_lengths.begin() + 256, literal_lengths.begin() + 280, 7);
+  HuffmanCode const literals = HuffmanCode::from_lengths(literal_lengths);
+  HuffmanCode const distances = HuffmanCode::from_lengths(std::vector<int>(30, 5));
+  auto next_bit = [&bits]() { return static_cast<int>(bits(1)); };
+
+  std::vector<uint8_t> out;
+  bool last = false;
+  while (!last) {
+    last = bits(1) == 1;
+    uint32_t type = bits(2);
+    if (type == 0) {
+      if (bit != 0) {
+        bit = 0;
+        ++at;
+      }
+      CHECK(at + 4 <= stream.size());
+      size_t length = stream[at] | stream[at + 1] << 8U;
+      CHECK((length ^ (stream[at + 2] | stream[at + 3] << 8U)) == 0xFFFF);
+      at += 4;
+      CHECK(at + length <= stream.size());
+      out.insert(out.end(), stream.begin() + static_cast<ptrdiff_t>(at),
+                 stream.begin() + static_cast<ptrdiff_t>(at + length));
+      at += length;
+      continue;
+    }
+    // the encoder never needs dynamic codes
+    CHECK(type == 1);
+    while (true) {
+      int symbol = literals.decode(next_bit);
+      if (symbol < 256) {
+        out.push_back(static_cast<uint8_t>(symbol));
+        continue;
+      }
+      if (symbol == 256) break;
+      auto index = static_cast<size_t>(symbol - 257);
+      CHECK(index < kLengthBase.size());
+      auto length = static_cast<size_t>(kLengthBase[index]) + bits(kLengthExtra[index]);
+      auto code = static_cast<size_t>(distances.decode(next_bit));
+      CHECK(code < kDistanceBase.size());
+      auto distance = static_cast<size_t>(kDistanceBase[code]) + bits(code < 4 ? 0 : static_cast<int>(code / 2 - 1));
+      CHECK(distance <= out.size());
+      for (size_t i = 0; i < length; ++i) out.push_back(out[out.size() - distance]);
+    }
+  }
+  if (bit != 0) ++at;
+
+  uint32_t a = 1;
+  uint32_t b = 0;
+  for (uint8_t byte : out) {
+    a = (a + byte) % 65521;
+    b = (b + a) % 65521;
+  }
+  CHECK(at + 4 == stream.size());
+  CHECK((uint32_t{stream[at]} << 24U | uint32_t{stream[at + 1]} << 16U | uint32_t{stream[at + 2]} << 8U |
+         stream[at + 3]) == (b << 16U | a));
+  return out;
+}
+
+/**
+ * @brief Decode an 8-bit, non-interlaced PNG, checking the CRC of every chunk
+ */
+auto decode_png(std::vector<uint8_t> const& file, uint32_t& width, uint32_t& height, int& channels)
+    -> std::vector<uint8_t> {
+  auto u32 = [&file](size_t at) {
+    CHECK(at + 4 <= file.size());
+    return uint32_t{file[at]} << 24U | uint32_t{file[at + 1]} << 16U | uint32_t{file[at + 2]} << 8U | file[at + 3];
+  };
+  CHECK(file.size() > 8 && std::memcmp(file.data(), "\x89PNG\r\n\x1a\n", 8) == 0);
+
+  std::vector<uint8_t> compressed;
+  channels = 0;
+  size_t at = 8;
+  while (true) {
+    size_t length = u32(at);
+    CHECK(at + 12 + length <= file.size());
+    std::string type(file.begin() + static_cast<ptrdiff_t>(at + 4), file.begin() + static_cast<ptrdiff_t>(at + 8));
+    // bit by bit rather than with the encoder's table
+    uint32_t crc = 0xFFFFFFFFU;
+    for (size_t i = at + 4; i < at + 8 + length; ++i) {
+      crc ^= file[i];
+      for (int k = 0; k < 8; ++k) crc = (crc >> 1U) ^ (0xEDB88320U & (0U - (crc & 1U)));
+    }
+    CHECK((crc ^ 0xFFFFFFFFU) == u32(at + 8 + length));
+
+    uint8_t const* data = file.data() + at + 8;
+    if (type == "IHDR") {
+      CHECK(length == 13 && data[8] == 8 && data[10] == 0 && data[11] == 0 && data[12] == 0);
+      width = u32(at + 8);
+      height = u32(at + 12);
+      channels = data[9] == 0 ? 1 : data[9] == 2 ? 3 : data[9] == 6 ? 4 : 0;
+    } else if (type == "IDAT") {
+      compressed.insert(compressed.end(), data, data + length);
+    } else if (type == "IEND") {
+      CHECK(at + 12 == file.size());
+      break;
+    }
+    at += 12 + length;
+  }
+  CHECK(channels != 0);
+
+  std::vector<uint8_t> filtered = inflate(compressed);
+  size_t row_size = size_t{width} * static_cast<size_t>(channels);
+  CHECK(filtered.size() == (row_size + 1) * height);
+  std::vector<uint8_t> pixels(row_size * height);
+  for (size_t y = 0; y < height; ++y) {
+    uint8_t filter = filtered[(row_size + 1) * y];
+    uint8_t const* src = filtered.data() + (row_size + 1) * y + 1;
+    uint8_t* row = pixels.data() + row_size * y;
+    for (size_t i = 0; i < row_size; ++i) {
+      auto bpp = static_cast<size_t>(channels);
+      int left = i >= bpp ? row[i - bpp] : 0;
+      int up = y > 0 ? row[i - row_size] : 0;
+      int up_left = i >= bpp && y > 0 ? row[i - bpp - row_size] : 0;
+      int predicted = 0;
+      switch (filter) {
+        case 0: break;
+        case 1: predicted = left; break;
+        case 2: predicted = up; break;
+        case 3: predicted = (left + up) / 2; break;
+        case 4: {
+          int p = left + up - up_left;
+          int pa = std::abs(p - left);
+          int pb = std::abs(p - up);
+          int pc = std::abs(p - up_left);
+          predicted = pa <= pb && pa <= pc ? left : pb <= pc ? up : up_left;
+          break;
+        }
+        default: CHECK(filter <= 4);
+      }
+      row[i] = static_cast<uint8_t>(src[i] + predicted);
+    }
+  }
+  return pixels;
+}
+
+/**
+ * @brief Decode a baseline JPEG with one or three components to grey or RGB, with a plain inverse DCT and nearest
+ * neighbour chroma upsampling
+ */
+auto decode_jpeg(std::vector<uint8_t> const& file, uint32_t& width, uint32_t& height, int& channels)
+    -> std::vector<uint8_t> {
+  struct Component {
+    int id = 0;
+    int h = 1;
+    int v = 1;
+    size_t quantization = 0;
+    size_t dc_table = 0;
+    size_t ac_table = 0;
+    int dc = 0;
+    size_t stride = 0;
+    std::vector<float> samples;
+  };
+  std::array<std::array<int, 64>, 4> quantization{};
+  std::array<std::array<HuffmanCode, 4>, 2> tables{};
+  std::vector<Component> components;
+
+  // natural position of each coefficient in zigzag order, walking the anti-diagonals in alternating directions
+  std::array<size_t, 64> natural{};
+  for (size_t k = 0, sum = 0; sum < 15; ++sum) {
+    for (size_t i = 0; i <= sum; ++i) {
+      size_t row = sum % 2 == 0 ? sum - i : i;
+      size_t col = sum - row;
+      if (row < 8 && col < 8) natural[k++] = row * 8 + col;
+    }
+  }
+
+  auto u16 = [&file](size_t at) { return static_cast<size_t>(file.at(at) << 8U | file.at(at + 1)); };
+  CHECK(file.size() > 4 && file[0] == 0xFF && file[1] == 0xD8);
+  size_t at = 2;
+  while (true) {
+    CHECK(file.at(at) == 0xFF);
+    uint8_t marker = file.at(at + 1);
+    size_t length = u16(at + 2);
+    size_t end = at + 2 + length;
+    CHECK(end <= file.size());
+    at += 4;
+    if (marker == 0xDB) {
+      while (at < end) {
+        CHECK((file[at] >> 4U) == 0);
+        auto& table = quantization.at(file[at] & 3U);
+        for (size_t k = 0; k < 64; ++k) table[natural[k]] = file.at(at + 1 + k);
+        at += 65;
+      }
+    } else if (marker == 0xC0) {
+      CHECK(file[at] == 8);
+      height = static_cast<uint32_t>(u16(at + 1));
+      width = static_cast<uint32_t>(u16(at + 3));
+      for (size_t i = 0; i < file[at + 5]; ++i) {
+        size_t c = at + 6 + 3 * i;
+        Component& component = components.emplace_back();
+        component.id = file[c];
+        component.h = file[c + 1] >> 4U;
+        component.v = file[c + 1] & 0xFU;
+        component.quantization = file[c + 2];
+      }
+    } else if (marker == 0xC4) {
+      while (at < end) {
+        auto& table = tables.at(file[at] >> 4U).at(file[at] & 3U);
+        size_t count = 0;
+        for (size_t length = 1; length <= 16; ++length) {
+          table.counts[length] = file.at(at + length);
+          count += file[at + length];
+        }
+        table.symbols.assign(file.begin() + static_cast<ptrdiff_t>(at + 17),
+                             file.begin() + static_cast<ptrdiff_t>(at + 17 + count));
+        at += 17 + count;
+      }
+    } else if (marker == 0xDA) {
+      CHECK(size_t{file[at]} == components.size());
+      for (size_t i = 0; i < components.size(); ++i) {
+        CHECK(file[at + 1 + 2 * i] == components[i].id);
+        components[i].dc_table = file[at + 2 + 2 * i] >> 4U;
+        components[i].ac_table = file[at + 2 + 2 * i] & 0xFU;
+      }
+      at = end;
+      break;
+    }
+    at = end;
+  }
+  CHECK(components.size() == 1 || components.size() == 3);
+  channels = static_cast<int>(components.size());
+
+  unsigned bit = 0;
+  auto next_bit = [&]() {
+    int value = (file.at(at) >> (7U - bit)) & 1U;
+    if (++bit == 8) {
+      bit = 0;
+      // a stuffed zero follows data bytes that look like a marker
+      if (file[at++] == 0xFF) CHECK(file.at(at++) == 0);
+    }
+    return value;
+  };
+  auto receive = [&next_bit](int length) {
+    int value = 0;
+    for (int i = 0; i < length; ++i) value = value << 1 | next_bit();
+    // values with a leading 0 are negative
+    return length > 0 && value < 1 << (length - 1) ? value - (1 << length) + 1 : value;
+  };
+
+  int h_max = 1;
+  int v_max = 1;
+  for (auto const& component : components) {
+    h_max = std::max(h_max, component.h);
+    v_max = std::max(v_max, component.v);
+  }
+  size_t mcus_x = (width + 8 * h_max - 1) / (8 * h_max);
+  size_t mcus_y = (height + 8 * v_max - 1) / (8 * v_max);
+  for (auto& component : components) {
+    component.stride = mcus_x * 8 * component.h;
+    component.samples.resize(component.stride * mcus_y * 8 * component.v);
+  }
+
+  constexpr double kPi = 3.14159265358979323846;
+  for (size_t mcu_y = 0; mcu_y < mcus_y; ++mcu_y) {
+    for (size_t mcu_x = 0; mcu_x < mcus_x; ++mcu_x) {
+      for (auto& component : components) {
+        for (int v = 0; v < component.v; ++v) {
+          for (int h = 0; h < component.h; ++h) {
+            std::array<double, 64> coefficients{};
+            auto const& q = quantization.at(component.quantization);
+            component.dc += receive(tables[0].at(component.dc_table).decode(next_bit));
+            coefficients[0] = component.dc * q[0];
+            for (size_t k = 1; k < 64;) {
+              int run_size = tables[1].at(component.ac_table).decode(next_bit);
+              int run = run_size >> 4;
+              int size = run_size & 0xF;
+              if (size == 0) {
+                if (run != 15) break;
+                k += 16;
+                continue;
+              }
+              k += static_cast<size_t>(run);
+              CHECK(k < 64);
+              coefficients[natural[k]] = receive(size) * q[natural[k]];
+              ++k;
+            }
+
+            size_t x0 = (mcu_x * static_cast<size_t>(component.h) + static_cast<size_t>(h)) * 8;
+            size_t y0 = (mcu_y * static_cast<size_t>(component.v) + static_cast<size_t>(v)) * 8;
+            for (size_t y = 0; y < 8; ++y) {
+              for (size_t x = 0; x < 8; ++x) {
+                double sum = 0;
+                for (size_t u = 0; u < 8; ++u) {
+                  for (size_t w = 0; w < 8; ++w) {
+                    double cu = u == 0 ? std::sqrt(0.5) : 1.0;
+                    double cw = w == 0 ? std::sqrt(0.5) : 1.0;
+                    sum += cu * cw * coefficients[w * 8 + u] * std::cos(static_cast<double>(2 * x + 1) * u * kPi / 16) *
+                           std::cos(static_cast<double>(2 * y + 1) * w * kPi / 16);
+                  }
+                }
+                component.samples[(y0 + y) * component.stride + x0 + x] = static_cast<float>(sum / 4);
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+  // the final byte is padded with 1 bits
+  if (bit != 0 && file[at++] == 0xFF) CHECK(file.at(at++) == 0);
+  CHECK(at + 2 == file.size() && file[at] == 0xFF && file[at + 1] == 0xD9);
+
+  auto to_byte = [](double value) { return static_cast<uint8_t>(std::clamp(std::lround(value), 0L, 255L)); };
+  std::vector<uint8_t> pixels;
+  for (size_t y = 0; y < height; ++y) {
+    for (size_t x = 0; x < width; ++x) {
+      auto sample = [&](Component const& c) {
+        return double{c.samples[y * static_cast<size_t>(c.v) / static_cast<size_t>(v_max) * c.stride +
+                                x * static_cast<size_t>(c.h) / static_cast<size_t>(h_max)]};
+      };
+      double luma = sample(components[0]) + 128;
+      if (channels == 1) {
+        pixels.push_back(to_byte(luma));
+        continue;
+      }
+      double cb = sample(components[1]);
+      double cr = sample(components[2]);
+      pixels.push_back(to_byte(luma + 1.402 * cr));
+      pixels.push_back(to_byte(luma - 0.344136 * cb - 0.714136 * cr));
+      pixels.push_back(to_byte(luma + 1.772 * cb));
+    }
+  }
+  return pixels;
+}
+
+/**
+ * @brief Smooth waves that lossy encoding keeps close, with a flat top left corner of long runs
+ */
+auto waves(size_t width, size_t height, size_t components) -> std::vector<uint8_t> {
+  std::vector<uint8_t> data;
+  for (size_t y = 0; y < height; ++y) {
+    for (size_t x = 0; x < width; ++x) {
+      bool flat = x < width / 2 && y < height / 2;
+      // the same wave in every channel keeps the colour flat, so that chroma subsampling loses nothing
+      double wave = std::sin(static_cast<double>(x) * 0.7) * std::cos(static_cast<double>(y) * 0.5);
+      for (size_t c = 0; c < components; ++c) {
+        data.push_back(static_cast<uint8_t>(flat ? 128 : std::lround(100 + 20 * static_cast<double>(c) + 60 * wave)));
+      }
+    }
+  }
+  return data;
+}
+
+/**
+ * @brief Rows in reverse order, as encoded images start from the top while textures are read back from the bottom
+ */
+auto bottom_up(std::vector<uint8_t> const& texels, size_t row_size) -> std::vector<uint8_t> {
+  std::vector<uint8_t> rows;
+  for (size_t y = texels.size() / row_size; y-- > 0;) {
+    rows.insert(rows.end(), texels.begin() + static_cast<ptrdiff_t>(row_size * y),
+                texels.begin() + static_cast<ptrdiff_t>(row_size * (y + 1)));
+  }
+  return rows;
+}
+
+/**
+ * @return largest and mean absolute difference between two images of the same size
+ */
+auto image_error(std::vector<uint8_t> const& a, std::vector<uint8_t> const& b) -> std::pair<int, double> {
+  CHECK(a.size() == b.size() && !a.empty());
+  int largest = 0;
+  double total = 0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    int error = std::abs(a[i] - b[i]);
+    largest = std::max(largest, error);
+    total += error;
+  }
+  return {largest, total / static_cast<double>(a.size())};
+}
+
+/**
+ * @brief Wait for a request and copy out its encoded data before later updates release it
+ */
+auto encoded_data(EventId event_id) -> std::vector<uint8_t> {
+  RenderQueue::instance().pump();
+  CHECK(wait_until_done(event_id) && !Request_Error(event_id));
+  void* data = nullptr;
+  size_t length = 0;
+  CHECK(Request_GetEncodedData(event_id, &data, &length));
+  auto* bytes = static_cast<uint8_t*>(data);
+  return {bytes, bytes + length};
+}
+
+auto read_file(std::filesystem::path const& path) -> std::vector<uint8_t> {
+  std::ifstream file(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+}  // namespace
+
+TEST_CASE(encode_qoi) {
+  setup();
+  constexpr GLsizei kWidth = 7;
+  constexpr GLsizei kHeight = 5;
+  std::vector<uint8_t> texels = pattern(size_t{kWidth} * kHeight * 4);
+  GLuint texture = mock_gl::create_texture(kWidth, kHeight, GL_RGBA8, texels);
+
+  RequestOptions options{.encoding = kEncodingQoi};
+  EventId event_id = Request_TextureWithOptions(nullptr, 0, texture, 0, &options);
+  RenderQueue::instance().pump();
+  CHECK(wait_until_done(event_id));
+  CHECK(!Request_Error(event_id));
+  // the raw data stays available
+  CHECK(has_data(event_id, texels));
+
+  void* data = nullptr;
+  size_t length = 0;
+  CHECK(Request_GetEncodedData(event_id, &data, &length));
+  uint32_t width = 0;
+  uint32_t height = 0;
+  auto* bytes = static_cast<uint8_t*>(data);
+  std::vector<uint8_t> decoded = decode_qoi(std::vector<uint8_t>(bytes, bytes + length), width, height);
+  CHECK(width == kWidth && height == kHeight);
+  // the bottom row of the texture is the top row of the image
+  size_t row_size = size_t{kWidth} * 4;
+  for (GLsizei y = 0; y < kHeight; ++y) {
+    CHECK(std::memcmp(decoded.data() + row_size * y, texels.data() + row_size * (kHeight - 1 - y), row_size) == 0);
+  }
+
+  // plain requests have no encoded data
+  EventId plain = Request_Texture(texture, 0);
+  RenderQueue::instance().pump();
+  CHECK(wait_until_done(plain));
+  CHECK(!Request_GetEncodedData(plain, &data, &length));
+}
+
+TEST_CASE(encode_to_file) {
+  setup();
+  std::vector<uint8_t> texels = pattern(size_t{20} * 10 * 3);
+  std::vector<uint8_t> grey_texels = waves(9, 9, 1);
+  GLuint texture = mock_gl::create_texture(20, 10, GL_RGB8, texels);
+  GLuint grey = mock_gl::create_texture(9, 9, GL_R8, grey_texels);
+  std::filesystem::path png = std::filesystem::temp_directory_path() / "PluginTests_encode.png";
+  std::filesystem::path jpeg = std::filesystem::temp_directory_path() / "PluginTests_encode.jpg";
+
+  // one at a time, a done request is released two updates later while another one is waited on
+  std::vector<uint8_t> encoded = encoded_data(Request_TextureToFile(png.string().c_str(), texture, 0, nullptr));
+  // colour type 2 is RGB
+  std::vector<uint8_t> file = read_file(png);
+  CHECK(file == encoded);
+  CHECK(file.size() > 33 && std::memcmp(file.data(), "\x89PNG\r\n\x1a\n", 8) == 0);
+  CHECK(std::memcmp(file.data() + 12, "IHDR\0\0\0\x14\0\0\0\x0a\x08\x02", 14) == 0);
+  uint32_t width = 0;
+  uint32_t height = 0;
+  int channels = 0;
+  CHECK(decode_png(file, width, height, channels) == bottom_up(texels, size_t{20} * 3));
+  CHECK(width == 20 && height == 10 && channels == 3);
+
+  // baseline frame with a single component
+  RequestOptions options{.encode_quality = 50};
+  encoded = encoded_data(Request_TextureToFile(jpeg.string().c_str(), grey, 0, &options));
+  file = read_file(jpeg);
+  CHECK(file == encoded);
+  CHECK(file.size() > 4 && file[0] == 0xFF && file[1] == 0xD8 && file[file.size() - 2] == 0xFF &&
+        file.back() == 0xD9);
+  constexpr std::array<uint8_t, 2> kStartOfFrame = {0xFF, 0xC0};
+  auto sof = std::search(file.begin(), file.end(), kStartOfFrame.begin(), kStartOfFrame.end());
+  CHECK(sof != file.end() && std::memcmp(&*sof + 4, "\x08\0\x09\0\x09\x01", 6) == 0);
+  auto [largest, mean] = image_error(decode_jpeg(file, width, height, channels), bottom_up(grey_texels, 9));
+  CHECK(width == 9 && height == 9 && channels == 1);
+  // quality 50 on a 9x9 image, the bounds are a little above what the encoder gives
+  CHECK(largest <= 20 && mean <= 4.0);
+  std::filesystem::remove(png);
+  std::filesystem::remove(jpeg);
+
+  // long runs of matches for the deflate stream, and subsampled chroma
+  constexpr size_t kWidth = 70;
+  constexpr size_t kHeight = 30;
+  std::vector<uint8_t> rgba = waves(kWidth, kHeight, 4);
+  options = {.encoding = kEncodingPng};
+  encoded = encoded_data(Request_TextureWithOptions(
+      nullptr, 0, mock_gl::create_texture(kWidth, kHeight, GL_RGBA8, rgba), 0, &options));
+  CHECK(decode_png(encoded, width, height, channels) == bottom_up(rgba, kWidth * 4));
+  CHECK(width == kWidth && height == kHeight && channels == 4);
+
+  std::vector<uint8_t> rgb = waves(kWidth, kHeight, 3);
+  options = {.encoding = kEncodingJpeg, .encode_quality = 90};
+  encoded = encoded_data(Request_TextureWithOptions(
+      nullptr, 0, mock_gl::create_texture(kWidth, kHeight, GL_RGB8, rgb), 0, &options));
+  std::tie(largest, mean) = image_error(decode_jpeg(encoded, width, height, channels), bottom_up(rgb, kWidth * 3));
+  CHECK(width == kWidth && height == kHeight && channels == 3);
+  CHECK(largest <= 32 && mean <= 1.6);
+
+  // unknown extensions fail right away, formats without 8-bit components and buffers once the data is retrieved
+  EventId unknown = Request_TextureToFile("PluginTests_encode.bmp", texture, 0, nullptr);
+  CHECK(Request_Done(unknown) && Request_Error(unknown));
+  GLuint half = mock_gl::create_texture(4, 4, GL_RGBA16F, pattern(size_t{4} * 4 * 8));
+  options = {.encoding = kEncodingPng};
+  EventId half_request = Request_TextureWithOptions(nullptr, 0, half, 0, &options);
+  RenderQueue::instance().pump();
+  CHECK(wait_until_done(half_request) && Request_Error(half_request));
+  EventId buffer_request = Request_ComputeBufferWithOptions(nullptr, 0, mock_gl::create_buffer(pattern(64)), 64,
+                                                            &options);
+  RenderQueue::instance().pump();
+  CHECK(wait_until_done(buffer_request) && Request_Error(buffer_request));
+  CHECK(stats().errors == 3);
+}
+
+TEST_CASE(capture_stream) {
+  setup();
+  std::vector<uint8_t> expected = pattern(size_t{6} * 4 * 4);
+  GLuint texture = mock_gl::create_texture(6, 4, GL_RGBA8, expected);
+  StreamId newest = Stream_Open(texture, 0, 2, kStreamDropNewest, 0, nullptr);
+  StreamId oldest = Stream_Open(texture, 0, 2, kStreamDropOldest, 0, nullptr);
+  CHECK(newest != kInvalidStreamId && oldest != kInvalidStreamId && newest != oldest);
+
+  // nobody consumes, so each stream fills both slots and then drops a frame per update
+  for (int i = 0; i < 6; ++i) frame();
+  StreamStats newest_stats;
+  StreamStats oldest_stats;
+  CHECK(Stream_GetStats(newest, &newest_stats) && Stream_GetStats(oldest, &oldest_stats));
+  CHECK(newest_stats.captured == 2 && newest_stats.ready == 2 && newest_stats.dropped == 4);
+  CHECK(oldest_stats.ready + oldest_stats.in_flight == 2 && oldest_stats.dropped > 0);
+  CHECK(oldest_stats.captured == oldest_stats.dropped + oldest_stats.ready);
+
+  // the ring reuses its staging buffers instead of creating one per capture
+  CHECK(mock_gl::calls("GenBuffers") == 4);
+  CHECK(stats().live_pbos == 4 && stats().live_fences == 0);
+
+  // dropping the newest frame keeps the first captures, dropping the oldest keeps the latest ones
+  StreamFrame first;
+  CHECK(Stream_AcquireFrame(newest, &first) && first.sequence == 0);
+  CHECK(first.length == expected.size() && std::memcmp(first.data, expected.data(), first.length) == 0);
+  StreamFrame latest;
+  CHECK(Stream_AcquireFrame(oldest, &latest) && latest.sequence >= 3);
+  CHECK(std::memcmp(latest.data, expected.data(), latest.length) == 0);
+
+  // releasing a frame frees its slot for the next update
+  CHECK(!Stream_ReleaseFrame(newest, first.sequence + 10));
+  CHECK(Stream_ReleaseFrame(newest, first.sequence));
+  CHECK(!Stream_ReleaseFrame(newest, first.sequence));
+  frame();
+  frame();
+  CHECK(Stream_GetStats(newest, &newest_stats) && newest_stats.captured == 3);
+  StreamFrame second;
+  CHECK(Stream_AcquireFrame(newest, &second) && second.sequence == 1);
+  CHECK(Stream_AcquireFrame(newest, &second) && second.sequence == 2);
+  CHECK(!Stream_AcquireFrame(newest, &second));
+
+  // closing deletes the staging buffers once the captures in flight are done
+  Stream_Close(newest);
+  Stream_Close(oldest);
+  CHECK(!Stream_GetStats(newest, &newest_stats) && !Stream_AcquireFrame(oldest, &latest));
+  for (int i = 0; i < 4; ++i) frame();
+  CHECK(mock_gl::live_buffers() == 0);
+  CHECK(stats().live_pbos == 0 && stats().staging_bytes == 0);
+  CHECK(stats().errors == 0);
+}
+
+TEST_CASE(capture_stream_block) {
+  setup();
+  GLuint texture = mock_gl::create_texture(4, 4, GL_RGBA8, pattern(size_t{4} * 4 * 4));
+  StreamId stream = Stream_Open(texture, 0, 1, kStreamBlock, 200'000'000, nullptr);
+  frame();
+  // the only slot is still in flight, which is never waited on
+  frame();
+  StreamStats stream_stats;
+  CHECK(Stream_GetStats(stream, &stream_stats) && stream_stats.ready == 1 && stream_stats.dropped == 1);
+
+  // a consumer on another thread releases the frame while the update waits for the slot
+  StreamFrame held;
+  CHECK(Stream_AcquireFrame(stream, &held));
+  std::thread consumer([stream, sequence = held.sequence]() {
+    std::this_thread::sleep_for(milliseconds(1));
+    Stream_ReleaseFrame(stream, sequence);
+  });
+  frame();
+  consumer.join();
+  CHECK(Stream_GetStats(stream, &stream_stats) && stream_stats.dropped == 1 && stream_stats.in_flight == 0);
+  CHECK(stream_stats.captured == 2);
+
+  // without a consumer the frame is dropped once the timeout has passed
+  auto start = std::chrono::steady_clock::now();
+  frame();
+  CHECK(std::chrono::steady_clock::now() - start >= milliseconds(200));
+  CHECK(Stream_GetStats(stream, &stream_stats) && stream_stats.dropped == 2 && stream_stats.captured == 2);
+  Stream_Close(stream);
+  frame();
+  frame();
+  CHECK(mock_gl::live_buffers() == 0);
+}
+
+TEST_CASE(flip_rows) {
+  setup();
+  constexpr GLsizei kWidth = 5;
+  constexpr GLsizei kHeight = 4;
+  constexpr size_t kRowSize = size_t{kWidth} * 4;
+  std::vector<uint8_t> texels = pattern(kRowSize * kHeight);
+  std::vector<uint8_t> flipped;
+  for (GLsizei y = kHeight; y-- > 0;) {
+    flipped.insert(flipped.end(), texels.begin() + static_cast<ptrdiff_t>(kRowSize * y),
+                   texels.begin() + static_cast<ptrdiff_t>(kRowSize * (y + 1)));
+  }
+  GLuint texture = mock_gl::create_texture(kWidth, kHeight, GL_RGBA8, texels);
+
+  RequestOptions options{.copy_flags = kCopyFlipRows};
+  EventId owned = Request_TextureWithOptions(nullptr, 0, texture, 0, &options);
+  std::vector<uint8_t> array(flipped.size());
+  EventId into_array = Request_TextureWithOptions(array.data(), array.size(), texture, 0, &options);
+  // buffers have no rows to flip
+  EventId buffer = Request_ComputeBufferWithOptions(nullptr, 0, mock_gl::create_buffer(texels),
+                                                    static_cast<GLsizeiptr>(texels.size()), &options);
+  // the encoder takes flipped rows as they are
+  options.encoding = kEncodingQoi;
+  EventId encoded = Request_TextureWithOptions(nullptr, 0, texture, 0, &options);
+  RenderQueue::instance().pump();
+  // checked before waiting on the encoding, done requests are released two updates later
+  CHECK(frames_until_done(owned, nanoseconds{0}) == 1);
+  CHECK(Request_Done(into_array) && Request_Done(buffer));
+  CHECK(has_data(owned, flipped));
+  CHECK(array == flipped);
+  CHECK(has_data(buffer, texels));
+  CHECK(wait_until_done(encoded));
+
+  void* data = nullptr;
+  size_t length = 0;
+  CHECK(Request_GetEncodedData(encoded, &data, &length));
+  uint32_t width = 0;
+  uint32_t height = 0;
+  auto* bytes = static_cast<uint8_t*>(data);
+  CHECK(decode_qoi(std::vector<uint8_t>(bytes, bytes + length), width, height) == flipped);
+
+  // staging buffers are mapped in chunks that can split rows, and results can be shorter than the image
+  for (size_t chunk : {size_t{1}, size_t{7}, kRowSize, kRowSize + 3}) {
+    std::vector<uint8_t> out(flipped.size());
+    for (size_t offset = 0; offset < texels.size(); offset += chunk) {
+      copy_flipped(out.data(), out.size(), kHeight, kRowSize, offset, texels.data() + offset,
+                   std::min(chunk, texels.size() - offset));
+    }
+    CHECK(out == flipped);
+  }
+  std::vector<uint8_t> partial(kRowSize + 5);
+  copy_flipped(partial.data(), partial.size(), kHeight, kRowSize, 0, texels.data(), texels.size());
+  CHECK(std::equal(partial.begin(), partial.end(), flipped.begin()));
+}
+
+namespace {
+
+/**
+ * @brief Straightforward floating point conversion of top-down RGB(A) pixels to I420
+ */
+auto reference_i420(std::vector<uint8_t> const& pixels, int width, int height, int components,
+                    YuvColorSpace color_space) -> std::vector<uint8_t> {
+  bool bt709 = color_space == kYuvBt709Limited || color_space == kYuvBt709Full;
+  bool full = color_space == kYuvBt601Full || color_space == kYuvBt709Full;
+  double kr = bt709 ? 0.2126 : 0.299;
+  double kb = bt709 ? 0.0722 : 0.114;
+  double y_scale = full ? 1.0 : 219.0 / 255.0;
+  double c_scale = full ? 1.0 : 224.0 / 255.0;
+  auto at = [&](int x, int y, int c) {
+    x = std::min(x, width - 1);
+    y = std::min(y, height - 1);
+    return static_cast<double>(pixels[(static_cast<size_t>(y) * width + x) * components + c]);
+  };
+  auto luma = [&](double r, double g, double b) { return kr * r + (1 - kr - kb) * g + kb * b; };
+  auto byte = [](double value) { return static_cast<uint8_t>(std::clamp(std::lround(value), 0L, 255L)); };
+
+  int chroma_width = (width + 1) / 2;
+  int chroma_height = (height + 1) / 2;
+  std::vector<uint8_t> frame(yuv_frame_size(kYuvI420, width, height));
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      frame[static_cast<size_t>(y) * width + x] =
+          byte((full ? 0 : 16) + y_scale * luma(at(x, y, 0), at(x, y, 1), at(x, y, 2)));
+    }
+  }
+  uint8_t* u = frame.data() + static_cast<ptrdiff_t>(width) * height;
+  uint8_t* v = u + static_cast<ptrdiff_t>(chroma_width) * chroma_height;
+  for (int y = 0; y < chroma_height; ++y) {
+    for (int x = 0; x < chroma_width; ++x) {
+      double rgb[3] = {};
+      for (int c = 0; c < 3; ++c) {
+        rgb[c] = (at(2 * x, 2 * y, c) + at(2 * x + 1, 2 * y, c) + at(2 * x, 2 * y + 1, c) +
+                  at(2 * x + 1, 2 * y + 1, c)) / 4;
+      }
+      double l = luma(rgb[0], rgb[1], rgb[2]);
+      u[y * chroma_width + x] = byte(128 + c_scale * (rgb[2] - l) / (2 * (1 - kb)));
+      v[y * chroma_width + x] = byte(128 + c_scale * (rgb[0] - l) / (2 * (1 - kr)));
+    }
+  }
+  return frame;
+}
+
+/**
+ * @return a copy of an NV12 frame with the chroma planes split as in I420
+ */
+auto nv12_to_i420(uint8_t const* frame, int width, int height) -> std::vector<uint8_t> {
+  size_t luma_size = static_cast<size_t>(width) * height;
+  size_t chroma_size = static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2);
+  std::vector<uint8_t> out(frame, frame + luma_size + 2 * chroma_size);
+  for (size_t i = 0; i < chroma_size; ++i) {
+    out[luma_size + i] = frame[luma_size + 2 * i];
+    out[luma_size + chroma_size + i] = frame[luma_size + 2 * i + 1];
+  }
+  return out;
+}
+
+auto within_one(uint8_t const* data, std::vector<uint8_t> const& expected) -> bool {
+  return std::equal(expected.begin(), expected.end(), data, [](uint8_t a, uint8_t b) { return std::abs(a - b) <= 1; });
+}
+
+}  // namespace
+
+TEST_CASE(yuv_conversion) {
+  setup();
+  // wide enough for the vector loop and its scalar tail, with odd sizes that repeat the last row and column
+  constexpr int kWidth = 37;
+  constexpr int kHeight = 9;
+  std::vector<uint8_t> texels = pattern(size_t{kWidth} * kHeight * 4);
+  // saturated colours take the chroma to the ends of its range
+  for (size_t i = 0; i < 16; ++i) texels[i] = (i % 4 == 3) ? 0 : ((i / 4) % 2 == 0 ? 255 : 0);
+  std::vector<uint8_t> top_down;
+  for (int y = kHeight; y-- > 0;) {
+    auto row = texels.begin() + static_cast<ptrdiff_t>(y) * kWidth * 4;
+    top_down.insert(top_down.end(), row, row + kWidth * 4);
+  }
+  GLuint texture = mock_gl::create_texture(kWidth, kHeight, GL_RGBA8, texels);
+  size_t frame_size = yuv_frame_size(kYuvI420, kWidth, kHeight);
+  CHECK(frame_size == size_t{kWidth} * kHeight + 2 * 19 * 5);
+
+  for (YuvColorSpace color_space : {kYuvBt601Limited, kYuvBt601Full, kYuvBt709Limited, kYuvBt709Full}) {
+    std::vector<uint8_t> expected = reference_i420(top_down, kWidth, kHeight, 4, color_space);
+    RequestOptions options{.yuv_format = kYuvI420, .yuv_color_space = color_space};
+    EventId i420 = Request_TextureWithOptions(nullptr, 0, texture, 0, &options);
+    options.yuv_format = kYuvNv12;
+    EventId nv12 = Request_TextureWithOptions(nullptr, 0, texture, 0, &options);
+    // flipped rows are already top-down
+    options.copy_flags = kCopyFlipRows;
+    EventId flipped = Request_TextureWithOptions(nullptr, 0, texture, 0, &options);
+    RenderQueue::instance().pump();
+    CHECK(wait_until_done(i420) && wait_until_done(nv12) && wait_until_done(flipped));
+
+    void* data = nullptr;
+    size_t length = 0;
+    CHECK(Request_GetData(i420, &data, &length) && length == frame_size);
+    CHECK(within_one(static_cast<uint8_t*>(data), expected));
+    CHECK(Request_GetData(nv12, &data, &length) && length == frame_size);
+    std::vector<uint8_t> split = nv12_to_i420(static_cast<uint8_t*>(data), kWidth, kHeight);
+    CHECK(within_one(split.data(), expected));
+    CHECK(has_data(flipped, std::vector<uint8_t>(static_cast<uint8_t*>(data), static_cast<uint8_t*>(data) + length)));
+  }
+
+  // 3 components only take the scalar path
+  std::vector<uint8_t> rgb = pattern(size_t{kWidth} * kHeight * 3);
+  ImageView image{.top = rgb.data(), .stride = kWidth * 3, .width = kWidth, .height = kHeight, .components = 3};
+  std::vector<uint8_t> out(frame_size);
+  CHECK(convert_to_yuv(kYuvI420, kYuvBt709Limited, image, out.data()));
+  CHECK(within_one(out.data(), reference_i420(rgb, kWidth, kHeight, 3, kYuvBt709Limited)));
+  image.components = 2;
+  CHECK(!convert_to_yuv(kYuvI420, kYuvBt709Limited, image, out.data()));
+
+  // a converted frame is no longer an image to encode, swapped pixels would swap the chroma planes and buffers have no
+  // pixels to convert
+  RequestOptions options{.encoding = kEncodingPng, .yuv_format = kYuvNv12};
+  EventId encoded = Request_TextureWithOptions(nullptr, 0, texture, 0, &options);
+  options.encoding = kEncodingNone;
+  options.post_process = kPostProcessSwapRedBlue;
+  EventId swapped = Request_TextureWithOptions(nullptr, 0, texture, 0, &options);
+  options.post_process = kPostProcessNone;
+  EventId buffer = Request_ComputeBufferWithOptions(nullptr, 0, mock_gl::create_buffer(texels),
+                                                    static_cast<GLsizeiptr>(texels.size()), &options);
+  RenderQueue::instance().pump();
+  CHECK(wait_until_done(encoded) && wait_until_done(swapped) && wait_until_done(buffer));
+  CHECK(Request_Error(encoded) && Request_Error(swapped) && Request_Error(buffer));
+}
+
+namespace {
+
+/**
+ * @brief Compare bits rather than values, so that NaNs match
+ */
+auto has_floats(EventId event_id, std::vector<float> const& expected) -> bool {
+  void* data = nullptr;
+  size_t length = 0;
+  if (!Request_GetData(event_id, &data, &length) || length != expected.size() * sizeof(float)) return false;
+  return std::memcmp(data, expected.data(), length) == 0;
+}
+
+}  // namespace
+
+TEST_CASE(float_conversion) {
+  setup();
+  // every half, including subnormals, infinities and NaNs, converts to the same bits with and without F16C
+  std::vector<uint16_t> halves(65536 + 3);
+  for (size_t i = 0; i < halves.size(); ++i) halves[i] = static_cast<uint16_t>(i);
+  for (FloatKernel kernel : {FloatKernel::kHalf, FloatKernel::kUnorm8, FloatKernel::kSnorm8, FloatKernel::kUnorm16,
+                             FloatKernel::kSnorm16, FloatKernel::kSrgb8}) {
+    std::vector<float> vectorised(halves.size());
+    std::vector<float> scalar(halves.size());
+    convert_to_float(kernel, halves.data(), halves.size(), 4, vectorised.data());
+    convert_to_float(kernel, halves.data(), halves.size(), 4, scalar.data(), false);
+    CHECK(std::memcmp(vectorised.data(), scalar.data(), scalar.size() * sizeof(float)) == 0);
+  }
+
+  std::array<float, 4> out{};
+  std::array<uint16_t, 4> special = {0x3c00, 0xc000, 0x0001, 0x7c00};
+  convert_to_float(FloatKernel::kHalf, special.data(), special.size(), 4, out.data());
+  CHECK((out == std::array<float, 4>{1.0F, -2.0F, 0x1p-24F, std::numeric_limits<float>::infinity()}));
+  std::array<int8_t, 4> snorm = {-128, -127, 0, 127};
+  convert_to_float(FloatKernel::kSnorm8, snorm.data(), snorm.size(), 4, out.data());
+  CHECK((out == std::array<float, 4>{-1.0F, -1.0F, 0.0F, 1.0F}));
+  std::array<uint8_t, 4> srgb = {0, 128, 255, 128};
+  convert_to_float(FloatKernel::kSrgb8, srgb.data(), srgb.size(), 4, out.data());
+  CHECK(out[0] == 0.0F && std::abs(out[1] - 0.2158605F) < 1e-6F && out[2] == 1.0F && out[3] == 128.0F / 255.0F);
+
+  constexpr GLsizei kWidth = 5;
+  constexpr GLsizei kHeight = 3;
+  constexpr size_t kCount = size_t{kWidth} * kHeight * 4;
+  std::vector<uint8_t> texels = pattern(kCount * 2);
+  std::vector<float> expected(kCount);
+  convert_to_float(FloatKernel::kHalf, texels.data(), kCount, 4, expected.data(), false);
+  std::vector<float> expected_srgb(kCount);
+  convert_to_float(FloatKernel::kSrgb8, texels.data(), kCount, 4, expected_srgb.data(), false);
+
+  RequestOptions options{.float_conversion = kFloatConvert};
+  EventId half = Request_TextureWithOptions(nullptr, 0, mock_gl::create_texture(kWidth, kHeight, GL_RGBA16F, texels),
+                                            0, &options);
+  EventId srgb_format = Request_TextureWithOptions(
+      nullptr, 0, mock_gl::create_texture(kWidth, kHeight, GL_SRGB8_ALPHA8, texels), 0, &options);
+  // float textures are left as they are, integer textures have nothing to normalize
+  std::vector<float> values(kCount, 0.5F);
+  std::vector<uint8_t> value_bytes(kCount * sizeof(float));
+  std::memcpy(value_bytes.data(), values.data(), value_bytes.size());
+  EventId single = Request_TextureWithOptions(
+      nullptr, 0, mock_gl::create_texture(kWidth, kHeight, GL_RGBA32F, value_bytes), 0, &options);
+  EventId integer = Request_TextureWithOptions(nullptr, 0, mock_gl::create_texture(kWidth, kHeight, GL_RGBA8UI, texels),
+                                               0, &options);
+  GLuint rgba = mock_gl::create_texture(kWidth, kHeight, GL_RGBA8, texels);
+  // the caller's buffer has to fit the floats
+  std::vector<float> array(kCount);
+  EventId into_array =
+      Request_TextureWithOptions(array.data(), array.size() * sizeof(float), rgba, 0, &options);
+  std::vector<uint8_t> small(kCount * 2);
+  EventId into_small = Request_TextureWithOptions(small.data(), small.size(), rgba, 0, &options);
+  options.float_conversion = kFloatDecodeSrgb;
+  EventId decoded = Request_TextureWithOptions(nullptr, 0, rgba, 0, &options);
+  RenderQueue::instance().pump();
+  for (EventId event_id : {half, srgb_format, single, integer, into_array, into_small, decoded}) {
+    CHECK(wait_until_done(event_id));
+  }
+
+  CHECK(has_floats(half, expected));
+  CHECK(has_floats(srgb_format, expected_srgb));
+  CHECK(has_floats(decoded, expected_srgb));
+  CHECK(has_floats(single, values));
+  CHECK(Request_Error(integer) && Request_Error(into_small));
+  std::vector<float> unorm(kCount);
+  convert_to_float(FloatKernel::kUnorm8, texels.data(), kCount, 4, unorm.data(), false);
+  CHECK(!Request_Error(into_array) && array == unorm);
+}
+
+namespace {
+
+/**
+ * @brief Order in which the completion and destruct callbacks saw the requests, as (callback, id) pairs
+ */
+struct CallbackLog {
+  std::mutex mutex;
+  std::vector<std::pair<char, EventId>> events;
+  // on_complete holds this request until released, so that updates run while it is being reported
+  std::atomic<EventId> held = -1;
+  std::atomic<bool> holding = false;
+  std::atomic<bool> release = false;
+
+  void add(char callback, EventId event_id) {
+    std::scoped_lock guard(mutex);
+    events.emplace_back(callback, event_id);
+  }
+
+  /** @return position of the callback for the request in the log, -1 if it has not run */
+  auto position(char callback, EventId event_id) -> ptrdiff_t {
+    std::scoped_lock guard(mutex);
+    auto iter = std::find(events.begin(), events.end(), std::pair{callback, event_id});
+    return iter == events.end() ? -1 : iter - events.begin();
+  }
+
+  auto count(char callback, EventId event_id) -> ptrdiff_t {
+    std::scoped_lock guard(mutex);
+    return std::count(events.begin(), events.end(), std::pair{callback, event_id});
+  }
+};
+
+CallbackLog callback_log;
+
+void UNITY_INTERFACE_API log_complete(EventId event_id) {
+  callback_log.add('c', event_id);
+  if (event_id != callback_log.held) return;
+  callback_log.holding = true;
+  while (!callback_log.release) std::this_thread::sleep_for(milliseconds(1));
+}
+
+void UNITY_INTERFACE_API log_batch(EventId const* event_ids, size_t count) {
+  for (size_t i = 0; i < count; ++i) callback_log.add('b', event_ids[i]);
+}
+
+void UNITY_INTERFACE_API log_destruct(EventId event_id) { callback_log.add('d', event_id); }
+
+}  // namespace
+
+TEST_CASE(completion_before_release) {
+  setup();
+  SetOnCompleteCallbackPtr(log_complete);
+  SetOnCompleteBatchCallbackPtr(log_batch);
+  SetOnDestructCallbackPtr(log_destruct);
+
+  // hashed on the worker pool, so the requests are done and reported there while the main thread updates
+  std::vector<uint8_t> expected = pattern(256);
+  GLuint buffer = mock_gl::create_buffer(expected);
+  RequestOptions options{.post_process = kPostProcessHash};
+  std::vector<EventId> event_ids;
+  for (int i = 0; i < 8; ++i) {
+    event_ids.push_back(Request_ComputeBufferWithOptions(nullptr, 0, buffer, 256, &options));
+  }
+  callback_log.held = event_ids.front();
+  RenderQueue::instance().pump();
+
+  for (int i = 0; i < 1000 && !callback_log.holding; ++i) {
+    frame();
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+  CHECK(callback_log.holding);
+  // done but not reported yet, so updates must not release it
+  CHECK(Request_Done(event_ids.front()));
+  for (int i = 0; i < 4; ++i) frame();
+  CHECK(callback_log.position('d', event_ids.front()) == -1);
+
+  callback_log.release = true;
+  auto all_released = [&event_ids]() {
+    return std::all_of(event_ids.begin(), event_ids.end(),
+                       [](EventId event_id) { return callback_log.position('d', event_id) != -1; });
+  };
+  for (int i = 0; i < 1000 && !all_released(); ++i) {
+    frame();
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+  for (EventId event_id : event_ids) {
+    CHECK(callback_log.count('c', event_id) == 1 && callback_log.count('b', event_id) == 1 &&
+          callback_log.count('d', event_id) == 1);
+    ptrdiff_t destructed = callback_log.position('d', event_id);
+    CHECK(callback_log.position('c', event_id) < destructed && callback_log.position('b', event_id) < destructed);
+  }
+}
+
+TEST_CASE(creation_failure_reported) {
+  setup();
+  SetOnCompleteCallbackPtr(log_complete);
+  SetOnCompleteBatchCallbackPtr(log_batch);
+  SetOnDestructCallbackPtr(log_destruct);
+
+  // a missing sink fails on creation, an unknown texture once the request is issued
+  GLuint texture = mock_gl::create_texture(4, 4, GL_RGBA8, pattern(64));
+  std::vector<EventId> event_ids = {Request_TextureIntoSink(12345, texture, 0),
+                                    Request_TextureToFile("PluginTests_failure.bmp", texture, 0, nullptr),
+                                    Request_Texture(texture + 100, 0)};
+  CHECK(Request_Done(event_ids[0]) && Request_Done(event_ids[1]));
+  RenderQueue::instance().pump();
+  for (int i = 0; i < kMaxFrames && callback_log.position('d', event_ids.back()) == -1; ++i) frame();
+
+  for (EventId event_id : event_ids) {
+    CHECK(callback_log.count('c', event_id) == 1 && callback_log.count('b', event_id) == 1 &&
+          callback_log.count('d', event_id) == 1);
+    CHECK(callback_log.position('b', event_id) < callback_log.position('d', event_id));
+  }
+  PluginStats after = stats();
+  CHECK(after.errors == 3 && after.completed == 3);
+}
+
+TEST_CASE(batch_callback) {
+  setup({.fence_delay = milliseconds(2)});
+  SetOnCompleteBatchCallbackPtr(log_batch);
+  SetOnDestructCallbackPtr(log_destruct);
+
+  // completed on the render thread and on the worker pool, over several frames
+  GLuint buffer = mock_gl::create_buffer(pattern(256));
+  RequestOptions options{.post_process = kPostProcessHash};
+  std::vector<EventId> event_ids;
+  for (int i = 0; i < 32; ++i) {
+    event_ids.push_back(i % 2 == 0 ? Request_ComputeBuffer(buffer, 256)
+                                   : Request_ComputeBufferWithOptions(nullptr, 0, buffer, 256, &options));
+    if (i % 8 == 7) {
+      RenderQueue::instance().pump();
+      frame(milliseconds(1));
+    }
+  }
+  RenderQueue::instance().pump();
+  auto all_released = [&event_ids]() {
+    return std::all_of(event_ids.begin(), event_ids.end(),
+                       [](EventId event_id) { return callback_log.position('d', event_id) != -1; });
+  };
+  for (int i = 0; i < 1000 && !all_released(); ++i) {
+    frame(milliseconds(1));
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+
+  for (EventId event_id : event_ids) {
+    CHECK(callback_log.count('b', event_id) == 1 && callback_log.count('d', event_id) == 1);
+    CHECK(callback_log.position('b', event_id) < callback_log.position('d', event_id));
+  }
+  // nothing is delivered twice once the requests are gone
+  for (int i = 0; i < 4; ++i) frame();
+  CHECK(callback_log.events.size() == event_ids.size() * 2);
+}
+
+namespace {
+
+/**
+ * @brief Coroutine that starts right away and cleans up after itself, as a game would use to await readbacks
+ */
+struct Detached {
+  struct promise_type {
+    auto get_return_object() noexcept -> Detached { return {}; }
+    auto initial_suspend() noexcept -> std::suspend_never { return {}; }
+    auto final_suspend() noexcept -> std::suspend_never { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { std::abort(); }
+  };
+};
+
+/**
+ * @brief What the coroutine saw after each co_await
+ */
+struct Resumption {
+  std::atomic<bool> resumed = false;
+  std::thread::id thread;
+  bool error = true;
+  std::vector<uint8_t> data;
+};
+
+auto read_buffer(GLuint buffer, GLsizeiptr size, Executor executor, Resumption& first, Resumption& second)
+    -> Detached {
+  ReadbackResult result = co_await Plugin::instance().request_compute_buffer_async(buffer, size, executor);
+  first.thread = std::this_thread::get_id();
+  first.error = result.has_error();
+  auto const* bytes = static_cast<uint8_t const*>(result.data());
+  if (bytes != nullptr) first.data.assign(bytes, bytes + result.size());
+  first.resumed = true;
+
+  // the request is done by now, the coroutine is still resumed on the executor rather than inline
+  ReadbackResult again = co_await Plugin::completion(result.event_id(), executor);
+  second.thread = std::this_thread::get_id();
+  second.error = again.has_error();
+  second.resumed = true;
+}
+
+}  // namespace
+
+TEST_CASE(awaitable) {
+  setup();
+  std::vector<uint8_t> expected = pattern(128);
+  GLuint buffer = mock_gl::create_buffer(expected);
+
+  std::array<Resumption, 2> pool;
+  std::array<Resumption, 2> main_thread;
+  read_buffer(buffer, 128, Executor::kWorkerPool, pool[0], pool[1]);
+  read_buffer(buffer, 128, Executor::kMainThread, main_thread[0], main_thread[1]);
+  CHECK(!pool[0].resumed && !main_thread[0].resumed);
+  RenderQueue::instance().pump();
+
+  auto all_resumed = [&pool, &main_thread]() { return pool[1].resumed && main_thread[1].resumed; };
+  for (int i = 0; i < 1000 && !all_resumed(); ++i) {
+    frame();
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+  CHECK(all_resumed());
+  for (Resumption const& resumption : pool) CHECK(resumption.thread != std::this_thread::get_id());
+  for (Resumption const& resumption : main_thread) CHECK(resumption.thread == std::this_thread::get_id());
+  CHECK(!pool[0].error && pool[0].data == expected);
+  CHECK(!main_thread[0].error && main_thread[0].data == expected);
+}
+
+TEST_CASE(sink_offsets) {
+  setup();
+  std::filesystem::path path = std::filesystem::temp_directory_path() / "PluginTests_sink.bin";
+  SinkId sink = Sink_Open(path.string().c_str(), 200);
+  CHECK(sink != kInvalidSinkId);
+  std::vector<uint8_t> expected = pattern(64);
+  GLuint buffer = mock_gl::create_buffer(expected);
+
+  // the fourth result does not fit and fails without taking up space
+  std::array<EventId, 4> event_ids = {};
+  for (EventId& event_id : event_ids) event_id = Request_ComputeBufferIntoSink(sink, buffer, 64);
+  RenderQueue::instance().pump();
+  for (EventId event_id : event_ids) CHECK(frames_until_done(event_id, nanoseconds{0}) <= 1);
+  std::array<size_t, 3> offsets = {};
+  for (size_t i = 0; i < offsets.size(); ++i) {
+    CHECK(!Request_Error(event_ids[i]) && Request_GetSinkOffset(event_ids[i], &offsets[i]));
+  }
+  std::sort(offsets.begin(), offsets.end());
+  CHECK(offsets[0] == 0 && offsets[1] == 64 && offsets[2] == 128);
+  size_t offset = 0;
+  CHECK(Request_Error(event_ids[3]) && !Request_GetSinkOffset(event_ids[3], &offset));
+  CHECK(Sink_Size(sink) == 192);
+
+  // the file is cut down to what was written once closed and released
+  Sink_Close(sink);
+  for (int i = 0; i < 4; ++i) frame();
+  std::vector<uint8_t> file = read_file(path);
+  std::filesystem::remove(path);
+  CHECK(file.size() == 192);
+  for (size_t i = 0; i < offsets.size(); ++i) {
+    CHECK(std::equal(expected.begin(), expected.end(), file.begin() + static_cast<ptrdiff_t>(i) * 64));
+  }
+  CHECK(Request_Error(Request_ComputeBufferIntoSink(sink, buffer, 64)));
+}
+
+TEST_CASE(hash_and_swap) {
+  setup();
+  // reference values of the xxHash specification
+  CHECK(xxh64("", 0) == 0xEF46DB3751D8E999ULL && xxh64("abc", 3) == 0x44BC2CF5AD770999ULL);
+  std::vector<uint8_t> data = pattern(256);
+  CHECK(xxh64(data.data(), 3) == 0x31D2363F52E564C9ULL && xxh64(data.data(), 45) == 0x86FAEE00897C4B41ULL &&
+        xxh64(data.data(), 256) == 0x00CFC5207DD8E201ULL);
+
+  GLuint buffer = mock_gl::create_buffer(data);
+  RequestOptions hash{.post_process = kPostProcessHash};
+  EventId hashed = Request_ComputeBufferWithOptions(nullptr, 0, buffer, 256, &hash);
+  // buffers have no pixels whose components could be swapped
+  RequestOptions swap{.post_process = kPostProcessSwapRedBlue};
+  EventId swapped_buffer = Request_ComputeBufferWithOptions(nullptr, 0, buffer, 256, &swap);
+
+  std::vector<uint8_t> pixels = pattern(64);
+  GLuint rgba = mock_gl::create_texture(4, 4, GL_RGBA8, pixels);
+  std::vector<uint8_t> rgb_pixels = pattern(48);
+  GLuint rgb = mock_gl::create_texture(4, 4, GL_RGB8, rgb_pixels);
+  GLuint rgba16 = mock_gl::create_texture(2, 2, GL_RGBA16, pattern(32));
+  RequestOptions both{.post_process = kPostProcessSwapRedBlue | kPostProcessHash};
+  EventId swapped = Request_TextureWithOptions(nullptr, 0, rgba, 0, &both);
+  EventId swapped_rgb = Request_TextureWithOptions(nullptr, 0, rgb, 0, &swap);
+  EventId swapped_16 = Request_TextureWithOptions(nullptr, 0, rgba16, 0, &swap);
+  RenderQueue::instance().pump();
+  for (EventId event_id : {hashed, swapped_buffer, swapped, swapped_rgb, swapped_16}) CHECK(wait_until_done(event_id));
+
+  uint64_t value = 0;
+  CHECK(Request_GetHash(hashed, &value) && value == 0x00CFC5207DD8E201ULL);
+  CHECK(has_data(hashed, data));
+  CHECK(Request_Error(swapped_buffer));
+
+  // the hash is of the swapped pixels
+  for (size_t i = 0; i < pixels.size(); i += 4) std::swap(pixels[i], pixels[i + 2]);
+  for (size_t i = 0; i < rgb_pixels.size(); i += 3) std::swap(rgb_pixels[i], rgb_pixels[i + 2]);
+  std::vector<uint8_t> pixels16 = pattern(32);
+  for (size_t i = 0; i < pixels16.size(); i += 8) {
+    std::swap_ranges(pixels16.begin() + static_cast<ptrdiff_t>(i), pixels16.begin() + static_cast<ptrdiff_t>(i) + 2,
+                     pixels16.begin() + static_cast<ptrdiff_t>(i) + 4);
+  }
+  CHECK(has_data(swapped, pixels) && has_data(swapped_rgb, rgb_pixels) && has_data(swapped_16, pixels16));
+  CHECK(Request_GetHash(swapped, &value) && value == xxh64(pixels.data(), pixels.size()));
+}
+
+namespace {
+
+struct FakeTask {
+  int id;
+  GLsizeiptr size;
+
+  auto prepare() const noexcept -> GLsizeiptr { return size; }
+  [[nodiscard]] auto has_error() const noexcept -> bool { return false; }
+};
+
+/**
+ * @return ids of the tasks the scheduler issues in the next frame
+ */
+auto issue_frame(RequestScheduler<FakeTask>& scheduler) -> std::vector<int> {
+  std::vector<int> issued;
+  scheduler.begin_frame();
+  scheduler.issue([&issued](std::shared_ptr<FakeTask> const& task) { issued.push_back(task->id); });
+  return issued;
+}
+
+}  // namespace
+
+TEST_CASE(scheduler) {
+  RequestScheduler<FakeTask> scheduler;
+  // higher priority first, in submission order within a priority
+  for (auto [id, priority] : {std::pair{0, 0}, {1, 5}, {2, 0}, {3, 5}, {4, -1}}) {
+    scheduler.push(std::make_shared<FakeTask>(id, 10), {.priority = priority});
+  }
+  CHECK(issue_frame(scheduler) == std::vector<int>({1, 3, 0, 2, 4}));
+  CHECK(scheduler.pending() == 0);
+
+  // the first request of a frame goes regardless of its size, the rest in order while they fit
+  scheduler.set_budget(100, 0);
+  for (auto [id, size] : {std::pair{0, 60}, {1, 60}, {2, 30}, {3, 200}}) {
+    scheduler.push(std::make_shared<FakeTask>(id, size), {});
+  }
+  CHECK(issue_frame(scheduler) == std::vector<int>({0}));
+  CHECK(issue_frame(scheduler) == std::vector<int>({1, 2}));
+  CHECK(issue_frame(scheduler) == std::vector<int>({3}));
+
+  // deadlines get requests out ahead of higher priorities and past the budgets, which they still use up
+  scheduler.set_budget(0, 1);
+  scheduler.push(std::make_shared<FakeTask>(0, 10), {.priority = -1, .deadline_frames = 2});
+  scheduler.push(std::make_shared<FakeTask>(1, 10), {.priority = -1, .deadline_frames = 2});
+  for (int id = 2; id < 5; ++id) scheduler.push(std::make_shared<FakeTask>(id, 10), {.priority = 1});
+  CHECK(issue_frame(scheduler) == std::vector<int>({2}));
+  CHECK(issue_frame(scheduler) == std::vector<int>({0, 1}));
+  CHECK(issue_frame(scheduler) == std::vector<int>({3}));
+
+  // requests started elsewhere are dropped right away rather than kept alive until they come up
+  auto task = std::make_shared<FakeTask>(5, 10);
+  std::weak_ptr<FakeTask> started = task;
+  scheduler.push(task, {.deadline_frames = 10});
+  scheduler.remove(*task);
+  task.reset();
+  CHECK(started.expired() && scheduler.pending() == 1);
+  CHECK(issue_frame(scheduler) == std::vector<int>({4}));
+  CHECK(scheduler.pending() == 0);
+}
+
+TEST_CASE(worker_pool_order) {
+  std::vector<int> order;
+  {
+    WorkerPool pool(1);
+    // the worker is held up until every job is queued, it then runs them in submission order
+    std::atomic<bool> release = false;
+    pool.submit([&release]() {
+      while (!release) std::this_thread::sleep_for(milliseconds(1));
+    });
+    for (int i = 0; i < 5; ++i) pool.submit([&order, i]() { order.push_back(i); });
+    CHECK(pool.pending() == 6);
+    release = true;
+  }
+  CHECK(order == std::vector<int>({0, 1, 2, 3, 4}));
+}
+
+namespace {
+
+struct FakeContext final : SharedContext {
+  bool can_make_current;
+  std::thread::id* destroyed_on;
+
+  FakeContext(bool can_make_current, std::thread::id* destroyed_on) noexcept
+      : can_make_current(can_make_current), destroyed_on(destroyed_on) {}
+  FakeContext(FakeContext const&) = delete;
+  FakeContext(FakeContext&&) = delete;
+  auto operator=(FakeContext const&) = delete;
+  auto operator=(FakeContext&&) = delete;
+  ~FakeContext() noexcept override { *destroyed_on = std::this_thread::get_id(); }
+
+  auto make_current() -> bool override { return can_make_current; }
+  void release() override {}
+};
+
+/**
+ * @brief Request whose fence signals right away or never
+ */
+struct FakeFence {
+  bool signals;
+  bool abandoned = false;
+
+  auto wait_for_completion(GLuint64 timeout) -> bool {
+    if (!signals) std::this_thread::sleep_for(nanoseconds(timeout));
+    return signals;
+  }
+  void abandon() { abandoned = true; }
+};
+
+}  // namespace
+
+TEST_CASE(readback_thread_shutdown) {
+  // contexts that cannot be made current are destroyed on the thread that tried
+  std::thread::id destroyed_on;
+  auto on_retrieved = [](EventId /* event_id */, std::shared_ptr<FakeFence> const& /* task */) {};
+  CHECK(ReadbackThread<FakeFence>::start(std::make_unique<FakeContext>(false, &destroyed_on), on_retrieved) ==
+        nullptr);
+  CHECK(destroyed_on != std::thread::id() && destroyed_on != std::this_thread::get_id());
+
+  // a fence that never signals holds up shutting down for a bounded time and fails its request
+  destroyed_on = {};
+  std::vector<EventId> retrieved;
+  auto thread = ReadbackThread<FakeFence>::start(
+      std::make_unique<FakeContext>(true, &destroyed_on),
+      [&retrieved](EventId event_id, std::shared_ptr<FakeFence> const& /* task */) { retrieved.push_back(event_id); });
+  CHECK(thread != nullptr);
+  auto signalled = std::make_shared<FakeFence>(true);
+  auto hung = std::make_shared<FakeFence>(false);
+  thread->push(1, signalled);
+  thread->push(2, hung);
+  auto begin = std::chrono::steady_clock::now();
+  thread.reset();
+  auto elapsed = std::chrono::steady_clock::now() - begin;
+  CHECK(elapsed >= std::chrono::seconds(1) && elapsed < std::chrono::seconds(5));
+  CHECK(retrieved == std::vector<EventId>({1, 2}));
+  CHECK(!signalled->abandoned && hung->abandoned);
+  CHECK(destroyed_on != std::thread::id() && destroyed_on != std::this_thread::get_id());
+}
+
+TEST_CASE(timings) {
+  setup();
+  std::vector<uint8_t> expected = pattern(1000);
+  GLuint buffer = mock_gl::create_buffer(expected);
+  auto size = static_cast<GLsizeiptr>(expected.size());
+  EventId first = Request_ComputeBuffer(buffer, size);
+  EventId second = Request_ComputeBuffer(buffer, size);
+  RenderQueue::instance().pump();
+  CHECK(frames_until_done(second, nanoseconds{0}) == 1);
+  CHECK(Request_Done(first));
+
+  RequestTimings timings;
+#ifndef READBACK_TIMINGS
+  CHECK(!Request_GetTimings(first, &timings));
+  CHECK(mock_gl::calls("GetInteger64v") == 0);
+#else
+  // both copies were started in the same render update, they share one GL_TIMESTAMP round-trip
+  CHECK(mock_gl::calls("GetInteger64v") == 1);
+  CHECK(mock_gl::calls("QueryCounter") == 4);
+
+  // still available once released
+  for (int i = 0; i < kMaxFrames && Request_Exists(first); ++i) frame();
+  CHECK(!Request_Exists(first));
+  CHECK(Request_GetTimings(first, &timings));
+  std::array<uint64_t, 9> const stamps = {timings.submitted, timings.started, timings.gpu_copy_start,
+                                          timings.gpu_copy_end, timings.signalled, timings.mapped,
+                                          timings.copied, timings.done, timings.released};
+  CHECK(std::find(stamps.begin(), stamps.end(), uint64_t{0}) == stamps.end());
+  CHECK(std::is_sorted(stamps.begin(), stamps.end()));
+
+  // the mock's GPU clock does not move with real time, so only the first copy of the update is timed after its start
+  CHECK(Request_GetTimings(second, &timings));
+  CHECK(timings.gpu_copy_start != 0 && timings.gpu_copy_start <= timings.gpu_copy_end);
+  CHECK(timings.started <= timings.signalled && timings.signalled <= timings.released);
+
+  // the next update calibrates again
+  EventId third = Request_ComputeBuffer(buffer, size);
+  CHECK(frames_until_done(third, nanoseconds{0}) == 1);
+  CHECK(mock_gl::calls("GetInteger64v") == 2);
+#endif
+}
+
+auto main(int argc, char** argv) -> int { return run_tests(argc, argv); }
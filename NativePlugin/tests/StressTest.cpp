@@ -0,0 +1,248 @@
+/**
+ * Soak test against the mock GL backend. Several threads submit and poll requests of mixed sizes while the main thread
+ * runs frames, keeping tens of thousands of requests outstanding. Ids start just below the EventId limit so that they
+ * wrap around during the run. Reports the per-frame update cost and resident memory over time, and fails on
+ * duplicate ids, failed requests or GL objects left behind.
+ *
+ * usage: StressTest [--requests <total = 2000000>] [--threads <producers = 4>] [--outstanding <per thread = 4096>]
+ *                   [--report-every <frames = 500>]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#include "MockGL.hpp"
+#include "OpenGLAsyncGPUReadbackPlugin.hpp"
+#include "Test.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  long requests = 2000000;
+  long threads = 4;
+  size_t outstanding = 4096;
+  long report_every = 500;
+};
+
+auto parse(int argc, char** argv) -> Options {
+  Options options;
+  for (int i = 1; i + 1 < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (arg == "--requests") {
+      options.requests = std::strtol(argv[++i], nullptr, 10);
+    } else if (arg == "--threads") {
+      options.threads = std::max(1L, std::strtol(argv[++i], nullptr, 10));
+    } else if (arg == "--outstanding") {
+      options.outstanding = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+    } else if (arg == "--report-every") {
+      options.report_every = std::max(1L, std::strtol(argv[++i], nullptr, 10));
+    }
+  }
+  return options;
+}
+
+auto resident_bytes() -> size_t {
+#if defined(__linux__)
+  std::FILE* statm = std::fopen("/proc/self/statm", "r");
+  if (statm == nullptr) return 0;
+  unsigned long size = 0;
+  unsigned long resident = 0;
+  int read = std::fscanf(statm, "%lu %lu", &size, &resident);
+  std::fclose(statm);
+  return read == 2 ? resident * static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 0;
+#else
+  return 0;
+#endif
+}
+
+/**
+ * @brief Ids of requests submitted and not yet seen done, an id handed out twice while in use is a failure
+ */
+class LiveIds {
+ public:
+  auto add(EventId event_id) -> bool {
+    std::scoped_lock guard(mutex_);
+    return ids_.insert(event_id).second;
+  }
+
+  void remove(EventId event_id) {
+    std::scoped_lock guard(mutex_);
+    ids_.erase(event_id);
+  }
+
+ private:
+  std::mutex mutex_;
+  std::unordered_set<EventId> ids_;
+};
+
+struct Source {
+  GLuint name;
+  bool texture;
+  size_t max_size;
+};
+
+struct Shared {
+  std::vector<Source> sources;
+  LiveIds live;
+  std::atomic<long> claimed = 0;
+  std::atomic<long> duplicates = 0;
+  std::atomic<bool> saw_negative = false;
+  std::atomic<bool> saw_positive = false;
+};
+
+// checked on the main thread before the plugin can release the requests
+std::atomic<long> completed_errors = 0;
+
+void UNITY_INTERFACE_API on_complete_batch(EventId const* event_ids, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    void* data = nullptr;
+    size_t length = 0;
+    if (!Request_GetData(event_ids[i], &data, &length) || length == 0) ++completed_errors;
+  }
+}
+
+void produce(Shared& shared, Options const& options, unsigned seed) {
+  std::mt19937 random(seed);
+  std::vector<EventId> outstanding;
+  outstanding.reserve(options.outstanding);
+
+  auto poll = [&shared, &outstanding]() {
+    std::erase_if(outstanding, [&shared](EventId event_id) {
+      if (!Request_Done(event_id)) return false;
+      shared.live.remove(event_id);
+      return true;
+    });
+  };
+
+  while (shared.claimed.fetch_add(1) < options.requests) {
+    while (outstanding.size() >= options.outstanding) {
+      poll();
+      if (outstanding.size() >= options.outstanding) std::this_thread::yield();
+    }
+
+    Source const& source = shared.sources[random() % shared.sources.size()];
+    auto size = static_cast<GLsizeiptr>(1 + random() % std::max<size_t>(source.max_size, 1));
+    EventId event_id = source.texture ? Request_Texture(source.name, 0) : Request_ComputeBuffer(source.name, size);
+    if (!shared.live.add(event_id)) ++shared.duplicates;
+    (event_id < 0 ? shared.saw_negative : shared.saw_positive) = true;
+    outstanding.push_back(event_id);
+    if (outstanding.size() % 256 == 0) poll();
+  }
+
+  while (!outstanding.empty()) {
+    poll();
+    std::this_thread::yield();
+  }
+}
+
+struct FrameCosts {
+  std::vector<int64_t> ns;
+
+  void report(long frame, size_t in_flight, size_t baseline) {
+    std::sort(ns.begin(), ns.end());
+    auto at = [this](double quantile) {
+      if (ns.empty()) return 0.0;
+      return static_cast<double>(ns[static_cast<size_t>(quantile * static_cast<double>(ns.size() - 1))]) * 1e-3;
+    };
+    auto resident = static_cast<double>(resident_bytes());
+    std::printf("frame %7ld: in flight %6zu, update p50 %8.1f us, p99 %8.1f us, max %8.1f us, rss %7.1f MiB (%+.1f)\n",
+                frame, in_flight, at(0.5), at(0.99), at(1.0), resident / (1 << 20),
+                (resident - static_cast<double>(baseline)) / (1 << 20));
+    std::fflush(stdout);
+    ns.clear();
+  }
+};
+
+}  // namespace
+
+auto main(int argc, char** argv) -> int {
+  Options options = parse(argc, argv);
+  // the copies take a few frames so that requests pile up
+  mock_gl::install({.fence_delay = std::chrono::milliseconds(3), .copy_cost_per_mib = std::chrono::milliseconds(1)});
+  SetGLIssuePluginEventPtr(RenderQueue::issue_plugin_event);
+  SetOnCompleteBatchCallbackPtr(on_complete_batch);
+  Plugin::instance().set_next_event_id(static_cast<EventId>(INT_MAX - options.requests / 2));
+
+  Shared shared;
+  shared.sources = {
+      {mock_gl::create_buffer(std::vector<uint8_t>(64)), false, 64},
+      {mock_gl::create_buffer(std::vector<uint8_t>(size_t{4} << 10)), false, size_t{4} << 10},
+      {mock_gl::create_buffer(std::vector<uint8_t>(size_t{256} << 10)), false, size_t{256} << 10},
+      {mock_gl::create_texture(16, 16, GL_RGBA8, std::vector<uint8_t>(size_t{16} * 16 * 4)), true, 0},
+      {mock_gl::create_texture(64, 32, GL_R8, std::vector<uint8_t>(size_t{64} * 32)), true, 0},
+  };
+
+  size_t baseline = resident_bytes();
+  std::vector<std::thread> producers;
+  std::atomic<long> finished = 0;
+  for (long i = 0; i < options.threads; ++i) {
+    producers.emplace_back([&shared, &options, &finished, i]() {
+      produce(shared, options, static_cast<unsigned>(i + 1));
+      ++finished;
+    });
+  }
+
+  FrameCosts costs;
+  long frame = 0;
+  PluginStats stats{};
+  Clock::time_point start = Clock::now();
+  while (finished < options.threads) {
+    mock_gl::advance(std::chrono::milliseconds(1));
+    Clock::time_point begin = Clock::now();
+    MainThread_UpdateOnce();
+    RenderQueue::instance().pump();
+    costs.ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count());
+
+    if (++frame % options.report_every == 0) {
+      Plugin_GetStats(&stats);
+      costs.report(frame, stats.in_flight, baseline);
+    }
+    // leaves the producers time to submit and poll on machines with few cores
+    std::this_thread::yield();
+  }
+  for (auto& producer : producers) producer.join();
+
+  // release the last requests
+  for (int i = 0; i < 3; ++i) {
+    MainThread_UpdateOnce();
+    RenderQueue::instance().pump();
+  }
+  costs.report(frame, 0, baseline);
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  Plugin_GetStats(&stats);
+  std::printf("%" PRIu64 " requests in %.1f s over %ld frames, %" PRIu64 " errors, %ld duplicate ids, wrapped %s\n",
+              stats.completed, seconds, frame, stats.errors, shared.duplicates.load(),
+              shared.saw_negative && shared.saw_positive ? "yes" : "no");
+
+  bool ok = true;
+  auto expect = [&ok](bool condition, char const* failure) {
+    if (condition) return;
+    std::fprintf(stderr, "%s\n", failure);
+    ok = false;
+  };
+  expect(stats.completed == static_cast<uint64_t>(options.requests), "not every request completed");
+  expect(stats.errors == 0 && completed_errors == 0, "requests failed");
+  expect(shared.duplicates == 0, "an id was handed out twice");
+  expect(options.requests < 2 || (shared.saw_negative && shared.saw_positive), "ids did not wrap around");
+  expect(stats.in_flight == 0 && stats.staging_bytes == 0, "staging memory left behind");
+  expect(mock_gl::live_buffers() == 0 && mock_gl::live_fences() == 0, "GL objects left behind");
+  return ok ? 0 : 1;
+}
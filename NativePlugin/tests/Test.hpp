@@ -0,0 +1,133 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "OpenGLAsyncGPUReadbackPluginAPI.hpp"
+
+/**
+ * Minimal test runner. Each test runs in its own process, selected by name on the command line, since the plugin is a
+ * process-wide singleton.
+ */
+
+struct TestCase {
+  char const* name;
+  void (*run)();
+};
+
+inline auto test_cases() -> std::vector<TestCase>& {
+  static std::vector<TestCase> cases;
+  return cases;
+}
+
+inline auto register_test(char const* name, void (*run)()) -> bool {
+  test_cases().push_back({name, run});
+  return true;
+}
+
+#define TEST_CASE(name)                                                                \
+  static void name();                                                                  \
+  [[maybe_unused]] static bool const name##_registered = register_test(#name, name); \
+  static void name()
+
+#define CHECK(condition)                                                                                        \
+  do {                                                                                                          \
+    if (!(condition)) {                                                                                         \
+      throw std::runtime_error(std::string(__FILE__) + ":" + std::to_string(__LINE__) + ": CHECK(" #condition \
+                               ") failed");                                                                     \
+    }                                                                                                           \
+  } while (false)
+
+/**
+ * @brief Stand-in for Unity's render thread, events issued by the plugin are queued until pumped
+ */
+class RenderQueue {
+ public:
+  static auto instance() -> RenderQueue& {
+    static RenderQueue queue;
+    return queue;
+  }
+
+  /**
+   * @brief GL.IssuePluginEvent replacement to pass to SetGLIssuePluginEventPtr
+   */
+  static void UNITY_INTERFACE_API issue_plugin_event(UnityRenderingEvent event, int event_id) {
+    RenderQueue& queue = instance();
+    {
+      std::scoped_lock guard(queue.mutex_);
+      queue.events_.emplace_back(event, event_id);
+    }
+    queue.wake_.notify_one();
+  }
+
+  /**
+   * @brief Run queued events on the calling thread until there are none left
+   */
+  void pump() {
+    while (true) {
+      std::pair<UnityRenderingEvent, int> event;
+      {
+        std::scoped_lock guard(mutex_);
+        if (events_.empty()) return;
+        event = events_.front();
+        events_.pop_front();
+      }
+      event.first(event.second);
+    }
+  }
+
+  /**
+   * @brief Run events on a background thread as they are issued, for tests that block on the plugin
+   */
+  void start_thread() {
+    thread_ = std::jthread([this](std::stop_token const& stop) {
+      while (!stop.stop_requested()) {
+        {
+          std::unique_lock lock(mutex_);
+          wake_.wait(lock, stop, [this]() { return !events_.empty(); });
+        }
+        pump();
+      }
+    });
+  }
+
+  void stop_thread() {
+    thread_.request_stop();
+    if (thread_.joinable()) thread_.join();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable_any wake_;
+  std::deque<std::pair<UnityRenderingEvent, int>> events_;
+  std::jthread thread_;
+};
+
+inline auto run_tests(int argc, char** argv) -> int {
+  if (argc < 2) {
+    for (TestCase const& test : test_cases()) std::printf("%s\n", test.name);
+    return 0;
+  }
+
+  std::string_view name = argv[1];
+  for (TestCase const& test : test_cases()) {
+    if (name != test.name) continue;
+    try {
+      test.run();
+    } catch (std::exception const& e) {
+      std::fprintf(stderr, "%s: %s\n", test.name, e.what());
+      return 1;
+    }
+    return 0;
+  }
+  std::fprintf(stderr, "unknown test %s\n", argv[1]);
+  return 1;
+}
@@ -13,6 +13,12 @@ namespace UniversalAsyncGPUReadbackPlugin
         private readonly Queue<UniversalAsyncGPUReadbackRequest> requests =
             new Queue<UniversalAsyncGPUReadbackRequest>();
 
+        /// <summary>
+        /// Encode the screenshots on a native worker thread instead of the main thread. Needs the OpenGL plugin and
+        /// a camera without HDR, so that the frames have 8-bit components
+        /// </summary>
+        public bool encodeNatively;
+
         private RenderTexture rt;
         private Camera cam;
 
@@ -34,11 +40,19 @@ namespace UniversalAsyncGPUReadbackPlugin
                 }
                 else if (req.done)
                 {
-                    // Get data from the request when it's done
-                    NativeArray<byte> buffer = req.GetData<byte>();
+                    if (req.TryGetEncodedData(out NativeArray<byte> png))
+                    {
+                        // already encoded by the plugin
+                        File.WriteAllBytes("test.png", png.ToArray());
+                    }
+                    else
+                    {
+                        // Get data from the request when it's done
+                        NativeArray<byte> buffer = req.GetData<byte>();
 
-                    // Save the image
-                    SaveBitmap(buffer, cam.pixelWidth, cam.pixelHeight);
+                        // Save the image
+                        SaveBitmap(buffer, cam.pixelWidth, cam.pixelHeight);
+                    }
 
                     requests.Dequeue();
                 }
@@ -55,7 +69,9 @@ namespace UniversalAsyncGPUReadbackPlugin
 
             if (Time.frameCount % 60 != 0) return;
             if (requests.Count < 8)
-                requests.Enqueue(AsyncReadback.Request(source));
+                requests.Enqueue(encodeNatively && AsyncReadback.usesCustomPlugin
+                    ? AsyncReadback.Request(source, new ReadbackOptions { encoding = ImageEncoding.Png })
+                    : AsyncReadback.Request(source));
             else
                 Debug.LogWarning("Too many requests.");
         }
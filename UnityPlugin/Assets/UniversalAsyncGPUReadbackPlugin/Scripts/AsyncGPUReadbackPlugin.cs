@@ -1,3 +1,4 @@
+﻿using System;
 using Unity.Collections;
 using UnityEngine.Rendering;
 
@@ -37,12 +38,136 @@ namespace UniversalAsyncGPUReadbackPlugin
             return isPlugin ? oRequest.GetRawData<T>() : uRequest.GetData<T>();
         }
 
+        /// <summary>
+        /// Get the offset of the request data in the file it was read back into with
+        /// <see cref="AsyncReadback.RequestIntoFile(ReadbackFileSink, UnityEngine.Texture, int)"/>.
+        /// </summary>
+        /// <param name="offset">Offset in bytes from the start of the file</param>
+        /// <returns>true if the request is done and was written to a file</returns>
+        public bool TryGetFileOffset(out long offset)
+        {
+            offset = 0;
+            return isPlugin && oRequest.TryGetFileOffset(out offset);
+        }
+
+        /// <summary>
+        /// Get the hash of the request data computed with <see cref="PostProcessFlags.Hash"/>.
+        /// </summary>
+        /// <param name="hash">XXH64 hash of the data</param>
+        /// <returns>true if the request is done and was created with <see cref="PostProcessFlags.Hash"/></returns>
+        public bool TryGetHash(out ulong hash)
+        {
+            hash = 0;
+            return isPlugin && oRequest.TryGetHash(out hash);
+        }
+
+        /// <summary>
+        /// Get the image encoded with <see cref="ReadbackOptions.encoding"/>. The data stays valid until the request
+        /// is released, like <see cref="GetData{T}"/>.
+        /// </summary>
+        /// <param name="data">Contents of the image file</param>
+        /// <returns>true if the request is done and was encoded by the OpenGL plugin</returns>
+        public bool TryGetEncodedData(out NativeArray<byte> data)
+        {
+            data = default;
+            return isPlugin && oRequest.TryGetEncodedData(out data);
+        }
+
+        /// <summary>
+        /// Get the lifecycle timestamps of an OpenGL readback request.
+        /// </summary>
+        /// <param name="timings">Timestamps in nanoseconds, 0 for stages that were not reached</param>
+        /// <returns>true if the request is an OpenGL request and the native plugin is built with
+        /// READBACK_TIMINGS</returns>
+        public bool TryGetTimings(out RequestTimings timings)
+        {
+            timings = default;
+            return isPlugin && oRequest.TryGetTimings(out timings);
+        }
+
+        /// <summary>
+        /// Get the time an OpenGL readback request spent in GL calls that should not block.
+        /// </summary>
+        /// <param name="stalls">Times in nanoseconds and whether the request was flagged as stalled</param>
+        /// <returns>true if the request is an OpenGL request that has not been released yet</returns>
+        public bool TryGetStalls(out RequestStalls stalls)
+        {
+            stalls = default;
+            return isPlugin && oRequest.TryGetStalls(out stalls);
+        }
+
         public void WaitForCompletion()
         {
             if (isPlugin) oRequest.WaitForCompletion();
             else uRequest.WaitForCompletion();
         }
 
+        /// <summary>
+        /// Wait for the request to complete for at most <paramref name="timeout"/>. Unity readback requests cannot
+        /// time out and always wait until they complete.
+        /// </summary>
+        /// <param name="timeout"></param>
+        /// <returns>false if the request is still pending</returns>
+        public bool WaitForCompletion(TimeSpan timeout)
+        {
+            if (isPlugin) return oRequest.WaitForCompletion(timeout);
+            uRequest.WaitForCompletion();
+            return true;
+        }
+
+        /// <summary>
+        /// Wait for all of the requests to complete, OpenGL requests are waited on with a single native wait. Unity
+        /// readback requests cannot time out and always wait until they complete.
+        /// </summary>
+        /// <param name="requests"></param>
+        /// <param name="timeout"></param>
+        /// <param name="completed">Optional array set to whether each request is done when the wait returns</param>
+        /// <returns>false if a request is still pending</returns>
+        public static bool WaitAll(UniversalAsyncGPUReadbackRequest[] requests, TimeSpan timeout,
+            bool[] completed = null)
+        {
+            if (Array.TrueForAll(requests, request => request.isPlugin))
+                return OpenGLAsyncReadbackRequest.WaitAll(Array.ConvertAll(requests, request => request.oRequest),
+                    timeout, completed);
+
+            foreach (var request in requests) request.WaitForCompletion(timeout);
+            return FillCompleted(requests, completed);
+        }
+
+        /// <summary>
+        /// Wait for any of the requests to complete. Unity readback requests cannot time out and wait for the first
+        /// request to complete.
+        /// </summary>
+        /// <param name="requests"></param>
+        /// <param name="timeout"></param>
+        /// <param name="completed">Optional array set to whether each request is done when the wait returns</param>
+        /// <returns>false if all requests are still pending</returns>
+        public static bool WaitAny(UniversalAsyncGPUReadbackRequest[] requests, TimeSpan timeout,
+            bool[] completed = null)
+        {
+            if (Array.TrueForAll(requests, request => request.isPlugin))
+                return OpenGLAsyncReadbackRequest.WaitAny(Array.ConvertAll(requests, request => request.oRequest),
+                    timeout, completed);
+
+            if (requests.Length > 0 && !Array.Exists(requests, request => request.done))
+                requests[0].WaitForCompletion(timeout);
+            FillCompleted(requests, completed);
+            return Array.Exists(requests, request => request.done);
+        }
+
+        private static bool FillCompleted(UniversalAsyncGPUReadbackRequest[] requests, bool[] completed)
+        {
+            bool all = true;
+            for (int i = 0; i < requests.Length; ++i)
+            {
+                bool done = requests[i].done;
+                if (completed != null) completed[i] = done;
+                all &= done;
+            }
+
+            return all;
+        }
+
         public void ReleaseNativeArray()
         {
             // unity readback requests need to WaitForCompletion to release their hold on requests into native arrays
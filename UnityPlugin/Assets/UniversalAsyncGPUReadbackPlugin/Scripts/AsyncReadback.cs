@@ -48,36 +48,89 @@ namespace UniversalAsyncGPUReadbackPlugin
         /// <param name="mipmapIndex"></param>
         /// <returns></returns>
         public static UniversalAsyncGPUReadbackRequest Request(Texture src, int mipmapIndex = 0)
+        {
+            return Request(src, default, mipmapIndex);
+        }
+
+        /// <summary>
+        /// Request readback of a texture with scheduling options.
+        /// </summary>
+        /// <param name="src"></param>
+        /// <param name="options">Options for the OpenGL plugin, ignored by Unity's readback</param>
+        /// <param name="mipmapIndex"></param>
+        /// <returns></returns>
+        public static UniversalAsyncGPUReadbackRequest Request(Texture src, ReadbackOptions options,
+            int mipmapIndex = 0)
         {
             if (_supportsAsyncGPUReadback)
                 return new UniversalAsyncGPUReadbackRequest(AsyncGPUReadback.Request(src, mipIndex: mipmapIndex));
 
             return new UniversalAsyncGPUReadbackRequest(
-                OpenGLAsyncReadbackRequest.CreateTextureRequest(src.GetNativeTexturePtr().ToInt32(), mipmapIndex));
+                OpenGLAsyncReadbackRequest.CreateTextureRequest(src.GetNativeTexturePtr().ToInt32(), mipmapIndex,
+                    options));
         }
 
         public static UniversalAsyncGPUReadbackRequest RequestIntoNativeArray<T>(ref NativeArray<T> output, Texture src,
-            int mipmapIndex = 0) where T : unmanaged
+            int mipmapIndex = 0, ReadbackOptions options = default) where T : unmanaged
         {
             if (_supportsAsyncGPUReadback)
                 return new UniversalAsyncGPUReadbackRequest(
                     AsyncGPUReadback.RequestIntoNativeArray(ref output, src, mipIndex: mipmapIndex));
 
             return new UniversalAsyncGPUReadbackRequest(OpenGLAsyncReadbackRequest.CreateTextureRequest(ref output,
+                src.GetNativeTexturePtr().ToInt32(), mipmapIndex, options));
+        }
+
+        /// <summary>
+        /// Request readback of a texture straight into an output file. Only supported by the OpenGL plugin.
+        /// </summary>
+        /// <param name="sink">Output file to append the texture data to</param>
+        /// <param name="src"></param>
+        /// <param name="mipmapIndex"></param>
+        /// <returns></returns>
+        public static UniversalAsyncGPUReadbackRequest RequestIntoFile(ReadbackFileSink sink, Texture src,
+            int mipmapIndex = 0)
+        {
+            if (!usesCustomPlugin)
+                throw new System.NotSupportedException("File sinks are only supported by the OpenGL readback plugin");
+
+            return new UniversalAsyncGPUReadbackRequest(OpenGLAsyncReadbackRequest.CreateTextureRequest(sink,
                 src.GetNativeTexturePtr().ToInt32(), mipmapIndex));
         }
 
-        public static UniversalAsyncGPUReadbackRequest Request(ComputeBuffer computeBuffer)
+        /// <summary>
+        /// Request readback of a texture, encode it on a native worker thread and write the image to a file. Only
+        /// supported by the OpenGL plugin.
+        /// </summary>
+        /// <param name="src">Texture with 8-bit unsigned components</param>
+        /// <param name="path">Output file path, existing files are overwritten</param>
+        /// <param name="options">The encoding is picked from the extension of <paramref name="path"/> (.qoi, .png,
+        /// .jpg) unless it is set</param>
+        /// <param name="mipmapIndex"></param>
+        /// <returns></returns>
+        public static UniversalAsyncGPUReadbackRequest RequestIntoImageFile(Texture src, string path,
+            ReadbackOptions options = default, int mipmapIndex = 0)
+        {
+            if (!usesCustomPlugin)
+                throw new System.NotSupportedException(
+                    "Image encoding is only supported by the OpenGL readback plugin");
+
+            return new UniversalAsyncGPUReadbackRequest(OpenGLAsyncReadbackRequest.CreateTextureRequest(path,
+                src.GetNativeTexturePtr().ToInt32(), mipmapIndex, options));
+        }
+
+        public static UniversalAsyncGPUReadbackRequest Request(ComputeBuffer computeBuffer,
+            ReadbackOptions options = default)
         {
             if (_supportsAsyncGPUReadback)
                 return new UniversalAsyncGPUReadbackRequest(AsyncGPUReadback.Request(computeBuffer));
 
             return new UniversalAsyncGPUReadbackRequest(OpenGLAsyncReadbackRequest.CreateComputeBufferRequest(
-                (int)computeBuffer.GetNativeBufferPtr(), computeBuffer.stride * computeBuffer.count));
+                (int)computeBuffer.GetNativeBufferPtr(), (long)computeBuffer.stride * computeBuffer.count, options));
         }
 
         public static UniversalAsyncGPUReadbackRequest RequestIntoNativeArray<T>(ref NativeArray<T> output,
-            ComputeBuffer computeBuffer) where T : unmanaged
+            ComputeBuffer computeBuffer, ReadbackOptions options = default) where T : unmanaged
         {
             if (_supportsAsyncGPUReadback)
                 return new UniversalAsyncGPUReadbackRequest(
@@ -85,7 +138,142 @@ namespace UniversalAsyncGPUReadbackPlugin
 
             return new UniversalAsyncGPUReadbackRequest(OpenGLAsyncReadbackRequest.CreateComputeBufferRequest(
                 ref output,
-                (int)computeBuffer.GetNativeBufferPtr(), computeBuffer.stride * computeBuffer.count));
+                (int)computeBuffer.GetNativeBufferPtr(), (long)computeBuffer.stride * computeBuffer.count, options));
+        }
+
+        /// <summary>
+        /// Limit how much readback work the OpenGL plugin issues per frame. Requests over the budget are held back
+        /// and issued in priority order in later frames, see <see cref="ReadbackOptions"/>. 0 means unlimited.
+        /// </summary>
+        /// <param name="bytes">Maximum number of bytes issued per frame</param>
+        /// <param name="count">Maximum number of requests issued per frame</param>
+        public static void SetFrameBudget(long bytes, int count)
+        {
+            if (usesCustomPlugin) OpenGLAsyncReadbackRequest.SetFrameBudget(bytes, count);
+        }
+
+        /// <summary>
+        /// Set the number of native worker threads used for <see cref="PostProcessFlags"/>, 0 picks half of the
+        /// hardware threads.
+        /// </summary>
+        /// <param name="count"></param>
+        public static void SetWorkerThreadCount(int count)
+        {
+            if (usesCustomPlugin) OpenGLAsyncReadbackRequest.SetWorkerThreadCount(count);
+        }
+
+        /// <summary>
+        /// Retrieve OpenGL readbacks on a dedicated native thread with its own context shared with Unity's, so that
+        /// the render thread only issues the copies. Takes effect on the next frame and falls back to the render thread
+        /// if the shared context cannot be created, see <see cref="IsReadbackThreadActive"/>. On Linux, drivers that
+        /// cannot share objects across X connections, such as Mesa's, get the context on Unity's connection, which
+        /// then needs Xlib initialized for threads with XInitThreads.
+        /// </summary>
+        /// <param name="enabled"></param>
+        public static void SetReadbackThreadEnabled(bool enabled)
+        {
+            if (usesCustomPlugin) OpenGLAsyncReadbackRequest.SetReadbackThreadEnabled(enabled);
+        }
+
+        /// <summary>
+        /// Make the OpenGL plugin poll only the newest in-flight readback each frame and complete all of them at once
+        /// when it is done. Saves render thread time with many requests in flight, at the cost of older requests
+        /// completing up to a frame later.
+        /// </summary>
+        /// <param name="enabled"></param>
+        public static void SetPollNewestFenceOnly(bool enabled)
+        {
+            if (usesCustomPlugin) OpenGLAsyncReadbackRequest.SetPollNewestFenceOnly(enabled);
+        }
+
+        /// <summary>
+        /// Whether the OpenGL plugin currently retrieves readbacks on its dedicated thread.
+        /// </summary>
+        public static bool IsReadbackThreadActive => usesCustomPlugin && OpenGLAsyncReadbackRequest.IsReadbackThreadActive();
+
+        /// <summary>
+        /// Get the aggregate statistics of the OpenGL plugin. Does not take any locks, safe to poll from any thread.
+        /// </summary>
+        /// <param name="stats"></param>
+        /// <returns>false if the OpenGL plugin is not used</returns>
+        public static bool TryGetStats(out PluginStats stats)
+        {
+            stats = default;
+            return usesCustomPlugin && OpenGLAsyncReadbackRequest.Plugin_GetStats(ref stats);
+        }
+
+        /// <summary>
+        /// Record when each OpenGL plugin request is submitted, started, signalled, copied and released along with
+        /// the frame updates of the plugin threads, see <see cref="DumpTrace"/>. Costs next to nothing while off.
+        /// </summary>
+        /// <param name="enabled"></param>
+        public static void SetTracingEnabled(bool enabled)
+        {
+            if (usesCustomPlugin) OpenGLAsyncReadbackRequest.Plugin_SetTracing(enabled);
+        }
+
+        /// <summary>
+        /// Write the events recorded by <see cref="SetTracingEnabled"/> as Chrome trace_event JSON, which can be
+        /// opened in Perfetto or chrome://tracing. Each thread keeps its most recent events.
+        /// </summary>
+        /// <param name="path">Output file</param>
+        /// <returns>false if the OpenGL plugin is not used or the file could not be written</returns>
+        public static bool DumpTrace(string path)
+        {
+            return usesCustomPlugin &&
+                   OpenGLAsyncReadbackRequest.Plugin_DumpTrace(System.Text.Encoding.UTF8.GetBytes(path + '\0'));
+        }
+
+        /// <summary>
+        /// Flag OpenGL plugin requests that spend longer than <paramref name="threshold"/> in glMapBufferRange,
+        /// glReadPixels or glClientWaitSync as stalled, see <see cref="UniversalAsyncGPUReadbackRequest.TryGetStalls"/>
+        /// and <see cref="PluginStats.stalledRequests"/>. Defaults to a millisecond, a zero threshold disables
+        /// flagging.
+        /// </summary>
+        /// <param name="threshold"></param>
+        public static void SetStallThreshold(System.TimeSpan threshold)
+        {
+            if (!usesCustomPlugin) return;
+            ulong nanoseconds = threshold <= System.TimeSpan.Zero ? 0UL : (ulong)threshold.Ticks * 100UL;
+            OpenGLAsyncReadbackRequest.Plugin_SetStallThreshold(nanoseconds);
+        }
+
+        /// <summary>
+        /// Capture the KHR_debug performance messages of Unity's OpenGL context, where drivers report reads that
+        /// fall off the fast path, see <see cref="GetPerformanceMessages"/>. A debug callback Unity installed keeps
+        /// receiving all messages. Takes effect on the next frame.
+        /// </summary>
+        /// <param name="enabled"></param>
+        public static void SetDebugMessageCaptureEnabled(bool enabled)
+        {
+            if (usesCustomPlugin) OpenGLAsyncReadbackRequest.Plugin_SetDebugMessageCapture(enabled);
+        }
+
+        /// <summary>
+        /// Get the most recent performance messages captured by <see cref="SetDebugMessageCaptureEnabled"/>.
+        /// </summary>
+        /// <returns>Messages, most recent first</returns>
+        public static string[] GetPerformanceMessages()
+        {
+            return usesCustomPlugin
+                ? OpenGLAsyncReadbackRequest.GetPerformanceMessages()
+                : System.Array.Empty<string>();
+        }
+
+        /// <summary>
+        /// Request readback of a compute buffer straight into an output file. Only supported by the OpenGL plugin.
+        /// </summary>
+        /// <param name="sink">Output file to append the buffer data to</param>
+        /// <param name="computeBuffer"></param>
+        /// <returns></returns>
+        public static UniversalAsyncGPUReadbackRequest RequestIntoFile(ReadbackFileSink sink,
+            ComputeBuffer computeBuffer)
+        {
+            if (!usesCustomPlugin)
+                throw new System.NotSupportedException("File sinks are only supported by the OpenGL readback plugin");
+
+            return new UniversalAsyncGPUReadbackRequest(OpenGLAsyncReadbackRequest.CreateComputeBufferRequest(sink,
+                (int)computeBuffer.GetNativeBufferPtr(), (long)computeBuffer.stride * computeBuffer.count));
         }
     }
 }
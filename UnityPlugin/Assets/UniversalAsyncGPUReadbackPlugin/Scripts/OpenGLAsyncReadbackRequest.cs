@@ -1,6 +1,7 @@
 ﻿using System;
 using System.Collections.Generic;
 using System.Runtime.InteropServices;
+using System.Text;
 using Unity.Collections;
 using Unity.Collections.LowLevel.Unsafe;
 using UnityEngine;
@@ -15,10 +16,12 @@ namespace UniversalAsyncGPUReadbackPlugin
 
         private delegate void RequestCallbackDelegate(int eventId);
 
+        private delegate void RequestBatchCallbackDelegate(IntPtr eventIds, ulong count);
+
         // make sure delegates are never collected by GC
         private static readonly GLIssuePluginEventDelegate GLIssuePluginEvent = GL.IssuePluginEvent;
         private static readonly RequestCallbackDelegate RequestDisposedCallback = OnRequestDisposed;
-        private static readonly RequestCallbackDelegate RequestCompletedCompleted = OnRequestComplete;
+        private static readonly RequestBatchCallbackDelegate RequestsCompletedCallback = OnRequestsComplete;
 
         public static bool IsAvailable()
         {
@@ -38,18 +41,30 @@ namespace UniversalAsyncGPUReadbackPlugin
         /// <summary>
         /// Check if the request is done
         /// </summary>
-        public bool done => Request_Done(nativeTaskHandle);
+        public bool done
+        {
+            get
+            {
+                bool isDone = Request_Done(nativeTaskHandle);
+#if ENABLE_UNITY_COLLECTIONS_CHECKS
+                // completions are only delivered on the next update, a request seen done can be read right away
+                if (isDone) OnRequestComplete(nativeTaskHandle);
+#endif
+                return isDone;
+            }
+        }
 
         /// <summary>
         /// Check if the request has an error
         /// </summary>
         public bool hasError => Request_Error(nativeTaskHandle);
 
-        public static OpenGLAsyncReadbackRequest CreateTextureRequest(int textureOpenGLName, int mipmapLevel)
+        public static unsafe OpenGLAsyncReadbackRequest CreateTextureRequest(int textureOpenGLName, int mipmapLevel,
+            ReadbackOptions options = default)
         {
             var result = new OpenGLAsyncReadbackRequest
             {
-                nativeTaskHandle = Request_Texture(textureOpenGLName, mipmapLevel)
+                nativeTaskHandle = Request_TextureWithOptions(null, 0, textureOpenGLName, mipmapLevel, ref options)
             };
 #if ENABLE_UNITY_COLLECTIONS_CHECKS
             result.internalStorage = true;
@@ -61,12 +76,12 @@ namespace UniversalAsyncGPUReadbackPlugin
         }
 
         public static unsafe OpenGLAsyncReadbackRequest CreateTextureRequest<T>(ref NativeArray<T> output,
-            int textureOpenGLName, int mipmapLevel) where T : unmanaged
+            int textureOpenGLName, int mipmapLevel, ReadbackOptions options = default) where T : unmanaged
         {
             var result = new OpenGLAsyncReadbackRequest
             {
-                nativeTaskHandle = Request_TextureIntoArray(output.GetUnsafePtr(),
-                    output.Length * sizeof(T), textureOpenGLName, mipmapLevel)
+                nativeTaskHandle = Request_TextureWithOptions(output.GetUnsafePtr(),
+                    (long)output.Length * sizeof(T), textureOpenGLName, mipmapLevel, ref options)
             };
 #if ENABLE_UNITY_COLLECTIONS_CHECKS
             result.safetyHandle = NativeArrayUnsafeUtility.GetAtomicSafetyHandle(output);
@@ -78,11 +93,12 @@ namespace UniversalAsyncGPUReadbackPlugin
             return result;
         }
 
-        public static OpenGLAsyncReadbackRequest CreateComputeBufferRequest(int computeBufferOpenGLName, int size)
+        public static unsafe OpenGLAsyncReadbackRequest CreateComputeBufferRequest(int computeBufferOpenGLName, long size,
+            ReadbackOptions options = default)
         {
             var result = new OpenGLAsyncReadbackRequest
             {
-                nativeTaskHandle = Request_ComputeBuffer(computeBufferOpenGLName, size)
+                nativeTaskHandle = Request_ComputeBufferWithOptions(null, 0, computeBufferOpenGLName, size, ref options)
             };
 #if ENABLE_UNITY_COLLECTIONS_CHECKS
             result.internalStorage = true;
@@ -94,12 +110,12 @@ namespace UniversalAsyncGPUReadbackPlugin
         }
 
         public static unsafe OpenGLAsyncReadbackRequest CreateComputeBufferRequest<T>(ref NativeArray<T> output,
-            int computeBufferOpenGLName, int size) where T : unmanaged
+            int computeBufferOpenGLName, long size, ReadbackOptions options = default) where T : unmanaged
         {
             var result = new OpenGLAsyncReadbackRequest
             {
-                nativeTaskHandle = Request_ComputeBufferIntoArray(output.GetUnsafePtr(),
-                    output.Length * sizeof(T), computeBufferOpenGLName, size)
+                nativeTaskHandle = Request_ComputeBufferWithOptions(output.GetUnsafePtr(),
+                    (long)output.Length * sizeof(T), computeBufferOpenGLName, size, ref options)
             };
 #if ENABLE_UNITY_COLLECTIONS_CHECKS
             result.safetyHandle = NativeArrayUnsafeUtility.GetAtomicSafetyHandle(output);
@@ -110,6 +126,53 @@ namespace UniversalAsyncGPUReadbackPlugin
             return result;
         }
 
+        public static OpenGLAsyncReadbackRequest CreateTextureRequest(ReadbackFileSink sink, int textureOpenGLName,
+            int mipmapLevel)
+        {
+            var result = new OpenGLAsyncReadbackRequest
+            {
+                nativeTaskHandle = Request_TextureIntoSink(sink.handle, textureOpenGLName, mipmapLevel)
+            };
+#if ENABLE_UNITY_COLLECTIONS_CHECKS
+            result.safetyHandle = AtomicSafetyHandle.Create();
+            AtomicSafetyHandle.SetAllowReadOrWriteAccess(result.safetyHandle, false);
+            RegisterRequest(result);
+#endif
+            return result;
+        }
+
+        public static OpenGLAsyncReadbackRequest CreateTextureRequest(string imagePath, int textureOpenGLName,
+            int mipmapLevel, ReadbackOptions options = default)
+        {
+            var result = new OpenGLAsyncReadbackRequest
+            {
+                nativeTaskHandle = Request_TextureToFile(Encoding.UTF8.GetBytes(imagePath + '\0'), textureOpenGLName,
+                    mipmapLevel, ref options)
+            };
+#if ENABLE_UNITY_COLLECTIONS_CHECKS
+            result.internalStorage = true;
+            result.safetyHandle = AtomicSafetyHandle.Create();
+            AtomicSafetyHandle.SetAllowReadOrWriteAccess(result.safetyHandle, false);
+            RegisterRequest(result);
+#endif
+            return result;
+        }
+
+        public static OpenGLAsyncReadbackRequest CreateComputeBufferRequest(ReadbackFileSink sink,
+            int computeBufferOpenGLName, long size)
+        {
+            var result = new OpenGLAsyncReadbackRequest
+            {
+                nativeTaskHandle = Request_ComputeBufferIntoSink(sink.handle, computeBufferOpenGLName, size)
+            };
+#if ENABLE_UNITY_COLLECTIONS_CHECKS
+            result.safetyHandle = AtomicSafetyHandle.Create();
+            AtomicSafetyHandle.SetAllowReadOrWriteAccess(result.safetyHandle, false);
+            RegisterRequest(result);
+#endif
+            return result;
+        }
+
         public bool Valid()
         {
             return Request_Exists(nativeTaskHandle);
@@ -119,7 +182,7 @@ namespace UniversalAsyncGPUReadbackPlugin
         {
             // Get data from cpp plugin
             void* ptr = null;
-            var length = 0;
+            long length = 0;
             bool success = Request_GetData(nativeTaskHandle, ref ptr, ref length);
             if (!success)
             {
@@ -131,32 +194,172 @@ namespace UniversalAsyncGPUReadbackPlugin
                 throw new InvalidOperationException("The request has an error!");
             }
 
+            // NativeArray lengths are ints, buffers of 2 GB and more need a larger element type
+            long count = length / sizeof(T);
+            if (count > int.MaxValue)
+                throw new InvalidOperationException("The request data has too many elements for a NativeArray!");
+
             NativeArray<T> resultNativeArray =
-                NativeArrayUnsafeUtility.ConvertExistingDataToNativeArray<T>(ptr, length / sizeof(T), Allocator.None);
+                NativeArrayUnsafeUtility.ConvertExistingDataToNativeArray<T>(ptr, (int)count, Allocator.None);
 
 #if ENABLE_UNITY_COLLECTIONS_CHECKS
             // recover safety handle
+            OnRequestComplete(nativeTaskHandle);
             NativeArrayUnsafeUtility.SetAtomicSafetyHandle(ref resultNativeArray, safetyHandle);
 #endif
 
             return resultNativeArray;
         }
 
+        /// <summary>
+        /// Get the offset of the request data in its <see cref="ReadbackFileSink"/>
+        /// </summary>
+        public bool TryGetFileOffset(out long offset)
+        {
+            offset = 0;
+            return Request_GetSinkOffset(nativeTaskHandle, ref offset);
+        }
+
+        /// <summary>
+        /// Get the image encoded with <see cref="ReadbackOptions.encoding"/>, valid until the request is released
+        /// </summary>
+        public unsafe bool TryGetEncodedData(out NativeArray<byte> data)
+        {
+            data = default;
+            void* ptr = null;
+            long length = 0;
+            if (!Request_GetEncodedData(nativeTaskHandle, ref ptr, ref length)) return false;
+
+            data = NativeArrayUnsafeUtility.ConvertExistingDataToNativeArray<byte>(ptr, checked((int)length),
+                Allocator.None);
+#if ENABLE_UNITY_COLLECTIONS_CHECKS
+            OnRequestComplete(nativeTaskHandle);
+            NativeArrayUnsafeUtility.SetAtomicSafetyHandle(ref data, safetyHandle);
+#endif
+            return true;
+        }
+
+        public bool TryGetHash(out ulong hash)
+        {
+            hash = 0;
+            return Request_GetHash(nativeTaskHandle, ref hash);
+        }
+
+        /// <summary>
+        /// Get the lifecycle timestamps of the request, also available for a while after it is released
+        /// </summary>
+        public bool TryGetTimings(out RequestTimings timings)
+        {
+            timings = default;
+            return Request_GetTimings(nativeTaskHandle, ref timings);
+        }
+
+        /// <summary>
+        /// Get the time the request spent in blocking GL calls, until it is released
+        /// </summary>
+        public bool TryGetStalls(out RequestStalls stalls)
+        {
+            stalls = default;
+            return Request_GetStalls(nativeTaskHandle, ref stalls);
+        }
+
         public void WaitForCompletion()
         {
             Request_WaitForCompletion(nativeTaskHandle);
         }
 
+        /// <summary>
+        /// Wait for the request to complete for at most <paramref name="timeout"/>.
+        /// </summary>
+        /// <param name="timeout"></param>
+        /// <returns>false if the request is still pending</returns>
+        public bool WaitForCompletion(TimeSpan timeout)
+        {
+            return Request_WaitForCompletionTimeout(nativeTaskHandle, ToNanoseconds(timeout));
+        }
+
+        /// <summary>
+        /// Wait for all of the requests to complete with a single native wait.
+        /// </summary>
+        /// <param name="requests"></param>
+        /// <param name="timeout"></param>
+        /// <param name="completed">Optional array set to whether each request is done when the wait returns</param>
+        /// <returns>false if a request is still pending</returns>
+        public static bool WaitAll(OpenGLAsyncReadbackRequest[] requests, TimeSpan timeout, bool[] completed = null)
+        {
+            return Wait(requests, timeout, completed, true);
+        }
+
+        /// <summary>
+        /// Wait for any of the requests to complete.
+        /// </summary>
+        /// <param name="requests"></param>
+        /// <param name="timeout"></param>
+        /// <param name="completed">Optional array set to whether each request is done when the wait returns</param>
+        /// <returns>false if all requests are still pending</returns>
+        public static bool WaitAny(OpenGLAsyncReadbackRequest[] requests, TimeSpan timeout, bool[] completed = null)
+        {
+            return Wait(requests, timeout, completed, false);
+        }
+
+        private static bool Wait(OpenGLAsyncReadbackRequest[] requests, TimeSpan timeout, bool[] completed, bool all)
+        {
+            if (completed != null && completed.Length < requests.Length)
+                throw new ArgumentException("completed must have an entry for every request", nameof(completed));
+
+            var ids = new int[requests.Length];
+            for (int i = 0; i < requests.Length; ++i) ids[i] = requests[i].nativeTaskHandle;
+
+            // bool is not blittable, the native flags are one byte each
+            var flags = completed != null ? new byte[requests.Length] : null;
+            bool result = all
+                ? Request_WaitAll(ids, (ulong)ids.Length, ToNanoseconds(timeout), flags)
+                : Request_WaitAny(ids, (ulong)ids.Length, ToNanoseconds(timeout), flags);
+            if (flags != null)
+                for (int i = 0; i < flags.Length; ++i) completed[i] = flags[i] != 0;
+            return result;
+        }
+
+        private static ulong ToNanoseconds(TimeSpan timeout)
+        {
+            return timeout <= TimeSpan.Zero ? 0UL : (ulong)timeout.Ticks * 100UL;
+        }
+
         internal static void Update()
         {
             MainThread_UpdateOnce();
         }
 
+        internal static void SetFrameBudget(long bytes, int count)
+        {
+            SetFrameBudget((ulong)bytes, (ulong)count);
+        }
+
+        internal static void SetWorkerThreadCount(int count)
+        {
+            SetWorkerThreadCount((ulong)count);
+        }
+
+        internal static string[] GetPerformanceMessages()
+        {
+            var messages = new System.Collections.Generic.List<string>();
+            var buffer = new byte[1024];
+            for (ulong index = 0;; ++index)
+            {
+                ulong length = Plugin_GetPerformanceMessage(index, buffer, (ulong)buffer.Length);
+                if (length == 0) break;
+                int copied = (int)System.Math.Min(length, (ulong)buffer.Length - 1);
+                messages.Add(System.Text.Encoding.UTF8.GetString(buffer, 0, copied));
+            }
+
+            return messages.ToArray();
+        }
+
         internal static void Initialize()
         {
             SetGLIssuePluginEventPtr(GLIssuePluginEvent);
 #if ENABLE_UNITY_COLLECTIONS_CHECKS
-            SetOnCompleteCallbackPtr(RequestCompletedCompleted);
+            SetOnCompleteBatchCallbackPtr(RequestsCompletedCallback);
             SetOnDestructCallbackPtr(RequestDisposedCallback);
 #endif
         }
@@ -191,6 +394,14 @@ namespace UniversalAsyncGPUReadbackPlugin
 #endif
         }
 
+        private static unsafe void OnRequestsComplete(IntPtr handles, ulong count)
+        {
+#if ENABLE_UNITY_COLLECTIONS_CHECKS
+            var ids = (int*)handles;
+            for (ulong i = 0; i < count; ++i) OnRequestComplete(ids[i]);
+#endif
+        }
+
         private static void OnRequestComplete(int handle)
         {
 #if ENABLE_UNITY_COLLECTIONS_CHECKS
@@ -207,18 +418,23 @@ namespace UniversalAsyncGPUReadbackPlugin
         private static extern bool CheckCompatible();
 
         [DllImport("OpenGLAsyncGPUReadbackPlugin")]
-        private static extern int Request_Texture(int texture, int miplevel);
+        private static extern unsafe int Request_TextureWithOptions(void* buffer, long size, int texture,
+            int miplevel, ref ReadbackOptions options);
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        private static extern unsafe int Request_ComputeBufferWithOptions(void* buffer, long size, int bufferID,
+            long bufferSize, ref ReadbackOptions options);
+
 
         [DllImport("OpenGLAsyncGPUReadbackPlugin")]
-        private static extern unsafe int Request_TextureIntoArray(void* buffer, int size, int texture,
-            int miplevel);
+        private static extern int Request_TextureIntoSink(int sink, int texture, int miplevel);
 
         [DllImport("OpenGLAsyncGPUReadbackPlugin")]
-        private static extern int Request_ComputeBuffer(int bufferID, int bufferSize);
+        private static extern int Request_ComputeBufferIntoSink(int sink, int bufferID, long bufferSize);
 
         [DllImport("OpenGLAsyncGPUReadbackPlugin")]
-        private static extern unsafe int Request_ComputeBufferIntoArray(void* buffer, int size, int bufferID,
-            int bufferSize);
+        private static extern int Request_TextureToFile(byte[] path, int texture, int miplevel,
+            ref ReadbackOptions options);
 
 
         [DllImport("OpenGLAsyncGPUReadbackPlugin")]
@@ -228,16 +444,86 @@ namespace UniversalAsyncGPUReadbackPlugin
         [DllImport("OpenGLAsyncGPUReadbackPlugin")]
         private static extern void SetOnCompleteCallbackPtr(RequestCallbackDelegate func);
 
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        private static extern void SetOnCompleteBatchCallbackPtr(RequestBatchCallbackDelegate func);
+
         [DllImport("OpenGLAsyncGPUReadbackPlugin")]
         private static extern void SetOnDestructCallbackPtr(RequestCallbackDelegate func);
 
 
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        private static extern void SetFrameBudget(ulong bytes, ulong count);
+
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        private static extern void SetWorkerThreadCount(ulong count);
+
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        internal static extern void SetReadbackThreadEnabled([MarshalAs(UnmanagedType.U1)] bool enabled);
+
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        [return: MarshalAs(UnmanagedType.U1)]
+        internal static extern bool IsReadbackThreadActive();
+
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        internal static extern void SetPollNewestFenceOnly([MarshalAs(UnmanagedType.U1)] bool enabled);
+
+
         [DllImport("OpenGLAsyncGPUReadbackPlugin")]
         private static extern void MainThread_UpdateOnce();
 
 
         [DllImport("OpenGLAsyncGPUReadbackPlugin")]
-        private static extern unsafe bool Request_GetData(int eventID, ref void* buffer, ref int length);
+        [return: MarshalAs(UnmanagedType.U1)]
+        internal static extern bool Plugin_GetStats(ref PluginStats stats);
+
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        internal static extern void Plugin_SetTracing([MarshalAs(UnmanagedType.U1)] bool enabled);
+
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        [return: MarshalAs(UnmanagedType.U1)]
+        internal static extern bool Plugin_DumpTrace(byte[] path);
+
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        internal static extern void Plugin_SetStallThreshold(ulong thresholdNs);
+
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        internal static extern void Plugin_SetDebugMessageCapture([MarshalAs(UnmanagedType.U1)] bool enabled);
+
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        private static extern ulong Plugin_GetPerformanceMessage(ulong index, byte[] buffer, ulong size);
+
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        private static extern unsafe bool Request_GetData(int eventID, ref void* buffer, ref long length);
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool Request_GetSinkOffset(int eventID, ref long offset);
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool Request_GetHash(int eventID, ref ulong hash);
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern unsafe bool Request_GetEncodedData(int eventID, ref void* buffer, ref long length);
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool Request_GetTimings(int eventID, ref RequestTimings timings);
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool Request_GetStalls(int eventID, ref RequestStalls stalls);
 
         [DllImport("OpenGLAsyncGPUReadbackPlugin")]
         private static extern bool Request_Error(int eventID);
@@ -250,5 +536,17 @@ namespace UniversalAsyncGPUReadbackPlugin
 
         [DllImport("OpenGLAsyncGPUReadbackPlugin")]
         private static extern void Request_WaitForCompletion(int eventID);
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool Request_WaitForCompletionTimeout(int eventID, ulong timeoutNs);
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool Request_WaitAll(int[] eventIDs, ulong count, ulong timeoutNs, byte[] completed);
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool Request_WaitAny(int[] eventIDs, ulong count, ulong timeoutNs, byte[] completed);
     }
 }
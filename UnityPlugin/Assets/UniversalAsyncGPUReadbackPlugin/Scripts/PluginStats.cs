@@ -0,0 +1,106 @@
+﻿using System.Runtime.InteropServices;
+
+namespace UniversalAsyncGPUReadbackPlugin
+{
+    /// <summary>
+    /// Aggregate statistics of the OpenGL readback plugin, see <see cref="AsyncReadback.TryGetStats"/>. Rates and
+    /// frames-to-done cover the last full second of updates.
+    /// Layout matches the native PluginStats struct.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct PluginStats
+    {
+        /// <summary>
+        /// Requests created and not done yet.
+        /// </summary>
+        public ulong inFlight;
+
+        /// <summary>
+        /// Requests created since the plugin was loaded.
+        /// </summary>
+        public ulong submitted;
+
+        /// <summary>
+        /// Requests done since the plugin was loaded, including failed ones.
+        /// </summary>
+        public ulong completed;
+
+        /// <summary>
+        /// Requests failed since the plugin was loaded.
+        /// </summary>
+        public ulong errors;
+
+        /// <summary>
+        /// Bytes read back since the plugin was loaded.
+        /// </summary>
+        public ulong bytesCompleted;
+
+        public double completionsPerSecond;
+
+        public double bytesPerSecond;
+
+        /// <summary>
+        /// Number of frames from creating a request until it is done.
+        /// </summary>
+        public double averageFramesToDone;
+
+        public ulong p99FramesToDone;
+
+        /// <summary>
+        /// Size of the staging buffers currently allocated on the GPU.
+        /// </summary>
+        public ulong stagingBytes;
+
+        /// <summary>
+        /// Staging buffers created since the plugin was loaded.
+        /// </summary>
+        public ulong stagingAllocations;
+
+        /// <summary>
+        /// Result buffers allocated by the plugin since it was loaded.
+        /// </summary>
+        public ulong resultAllocations;
+
+        /// <summary>
+        /// GL objects currently held by requests, these should drop back to zero once all requests are done.
+        /// </summary>
+        public ulong livePbos;
+
+        public ulong liveFbos;
+
+        public ulong liveFences;
+
+        /// <summary>
+        /// Highest number of GL objects held at once since the plugin was loaded.
+        /// </summary>
+        public ulong peakPbos;
+
+        public ulong peakFbos;
+
+        public ulong peakFences;
+
+        /// <summary>
+        /// Highest <see cref="stagingBytes"/> since the plugin was loaded.
+        /// </summary>
+        public ulong peakStagingBytes;
+
+        /// <summary>
+        /// Done requests flagged as stalled, see <see cref="RequestStalls"/>.
+        /// </summary>
+        public ulong stalledRequests;
+
+        /// <summary>
+        /// <see cref="RequestStalls"/> times summed over all done requests.
+        /// </summary>
+        public ulong mapNs;
+
+        public ulong readPixelsNs;
+
+        public ulong clientWaitNs;
+
+        /// <summary>
+        /// KHR_debug performance messages captured, see <see cref="AsyncReadback.SetDebugMessageCaptureEnabled"/>.
+        /// </summary>
+        public ulong performanceMessages;
+    }
+}
@@ -0,0 +1,63 @@
+﻿using System;
+using System.Runtime.InteropServices;
+using System.Text;
+
+namespace UniversalAsyncGPUReadbackPlugin
+{
+    /// <summary>
+    /// Memory-mapped output file that completed OpenGL readbacks are written to directly, without going through managed
+    /// memory. The file is created with a fixed capacity and each request appends its data in completion order.
+    /// Only available when <see cref="AsyncReadback.usesCustomPlugin"/> is true.
+    /// </summary>
+    public sealed class ReadbackFileSink : IDisposable
+    {
+        private const int InvalidHandle = -1;
+
+        internal int handle { get; private set; }
+
+        private ReadbackFileSink(int handle)
+        {
+            this.handle = handle;
+        }
+
+        /// <summary>
+        /// Create a new output file, existing files are overwritten.
+        /// </summary>
+        /// <param name="path">Output file path</param>
+        /// <param name="capacity">Maximum number of bytes that can be written to the file</param>
+        /// <returns></returns>
+        public static ReadbackFileSink Open(string path, long capacity)
+        {
+            if (!AsyncReadback.usesCustomPlugin)
+                throw new NotSupportedException("File sinks are only supported by the OpenGL readback plugin");
+
+            int handle = Sink_Open(Encoding.UTF8.GetBytes(path + '\0'), capacity);
+            if (handle == InvalidHandle) throw new System.IO.IOException($"Could not map {path} for writing");
+            return new ReadbackFileSink(handle);
+        }
+
+        /// <summary>
+        /// Number of bytes written to the file so far.
+        /// </summary>
+        public long size => handle == InvalidHandle ? 0 : Sink_Size(handle);
+
+        /// <summary>
+        /// Close the file. It is truncated to <see cref="size"/> once all requests writing to it are disposed of.
+        /// </summary>
+        public void Dispose()
+        {
+            if (handle == InvalidHandle) return;
+            Sink_Close(handle);
+            handle = InvalidHandle;
+        }
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        private static extern int Sink_Open(byte[] path, long capacity);
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        private static extern void Sink_Close(int sink);
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        private static extern long Sink_Size(int sink);
+    }
+}
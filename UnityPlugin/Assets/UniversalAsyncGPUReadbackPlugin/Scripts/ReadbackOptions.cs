@@ -0,0 +1,168 @@
+﻿using System;
+using System.Runtime.InteropServices;
+
+namespace UniversalAsyncGPUReadbackPlugin
+{
+    /// <summary>
+    /// Post-processing steps run on a native worker thread before a request is reported as done.
+    /// </summary>
+    [Flags]
+    public enum PostProcessFlags : uint
+    {
+        None = 0,
+
+        /// <summary>
+        /// Swap the red and blue components of texture data, RGB(A) &lt;-&gt; BGR(A).
+        /// </summary>
+        SwapRedBlue = 1 << 0,
+
+        /// <summary>
+        /// Compute the XXH64 hash of the data, see <see cref="UniversalAsyncGPUReadbackRequest.TryGetHash"/>.
+        /// </summary>
+        Hash = 1 << 1,
+    }
+
+    /// <summary>
+    /// Changes to the data made while it is copied out of the staging buffer, at no extra cost.
+    /// </summary>
+    [Flags]
+    public enum CopyFlags : uint
+    {
+        None = 0,
+
+        /// <summary>
+        /// Store texture rows top row first as images are, instead of bottom-up as OpenGL reads them. Ignored for
+        /// compute buffers.
+        /// </summary>
+        FlipRows = 1 << 0,
+    }
+
+    /// <summary>
+    /// Image formats texture readbacks can be encoded to on a native worker thread. Only textures with 8-bit unsigned
+    /// components can be encoded, single component textures are encoded as grey.
+    /// </summary>
+    public enum ImageEncoding : uint
+    {
+        None = 0,
+
+        /// <summary>
+        /// Lossless and fastest to encode.
+        /// </summary>
+        Qoi = 1,
+
+        /// <summary>
+        /// Lossless.
+        /// </summary>
+        Png = 2,
+
+        /// <summary>
+        /// Baseline JPEG with 4:2:0 chroma subsampling, alpha is dropped.
+        /// </summary>
+        Jpeg = 3,
+    }
+
+    /// <summary>
+    /// 4:2:0 layouts texture readbacks can be converted to for video encoders on a native worker thread, the data is
+    /// replaced by the converted frame with the top row first. Only textures with 8-bit unsigned RGB(A) components can
+    /// be converted.
+    /// </summary>
+    public enum YuvFormat : uint
+    {
+        None = 0,
+
+        /// <summary>
+        /// Luma plane followed by one plane of interleaved U and V samples.
+        /// </summary>
+        Nv12 = 1,
+
+        /// <summary>
+        /// Luma plane followed by the U and the V planes.
+        /// </summary>
+        I420 = 2,
+    }
+
+    /// <summary>
+    /// Matrix and range of the YUV conversion, limited range has luma in 16..235 and chroma in 16..240.
+    /// </summary>
+    public enum YuvColorSpace : uint
+    {
+        Bt601Limited = 0,
+        Bt601Full = 1,
+        Bt709Limited = 2,
+        Bt709Full = 3,
+    }
+
+    /// <summary>
+    /// Conversion of texture components to 32-bit floats on a native worker thread, the data is replaced by the floats.
+    /// Float textures are left as they are, integer textures fail.
+    /// </summary>
+    public enum FloatConversion : uint
+    {
+        None = 0,
+
+        /// <summary>
+        /// Widen halves, scale normalized integers to [0, 1] or [-1, 1] and decode sRGB textures to linear.
+        /// </summary>
+        Convert = 1,
+
+        /// <summary>
+        /// As <see cref="Convert"/>, but colour components of 8-bit unsigned normalized textures are always decoded from
+        /// sRGB, for sRGB data in textures without an sRGB format. Alpha stays linear.
+        /// </summary>
+        DecodeSrgb = 2,
+    }
+
+    /// <summary>
+    /// Per-request options for the OpenGL readback plugin, ignored when Unity's own readback is used.
+    /// Layout matches the native RequestOptions struct.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct ReadbackOptions
+    {
+        /// <summary>
+        /// Requests with higher priority are issued first when the frame budget is limited.
+        /// </summary>
+        public int priority;
+
+        /// <summary>
+        /// Number of frames after which the request is issued regardless of the frame budget, 0 for no deadline.
+        /// </summary>
+        public int deadlineFrames;
+
+        /// <summary>
+        /// Post-processing steps to run off the Unity threads before the request is done.
+        /// </summary>
+        public PostProcessFlags postProcess;
+
+        /// <summary>
+        /// Image format the texture data is encoded to after post-processing, see
+        /// <see cref="UniversalAsyncGPUReadbackRequest.TryGetEncodedData"/>.
+        /// </summary>
+        public ImageEncoding encoding;
+
+        /// <summary>
+        /// JPEG quality from 1 to 100, 0 for the default of 90.
+        /// </summary>
+        public int encodeQuality;
+
+        /// <summary>
+        /// Changes made while the data is copied out of the staging buffer.
+        /// </summary>
+        public CopyFlags copyFlags;
+
+        /// <summary>
+        /// YUV layout the texture data is converted to before the other steps, requests that also swap red and blue fail.
+        /// </summary>
+        public YuvFormat yuvFormat;
+
+        /// <summary>
+        /// Matrix and range of the YUV conversion.
+        /// </summary>
+        public YuvColorSpace yuvColorSpace;
+
+        /// <summary>
+        /// Conversion of the texture components to float, after swapping red and blue and before the other steps.
+        /// </summary>
+        public FloatConversion floatConversion;
+    }
+}
@@ -0,0 +1,203 @@
+﻿using System;
+using System.Runtime.InteropServices;
+using Unity.Collections;
+using Unity.Collections.LowLevel.Unsafe;
+using UnityEngine;
+
+namespace UniversalAsyncGPUReadbackPlugin
+{
+    /// <summary>
+    /// What a <see cref="ReadbackStream"/> does when all of its slots are in use because the consumer falls behind.
+    /// Frames are always skipped while captures still in flight take up every slot.
+    /// </summary>
+    public enum StreamDropPolicy
+    {
+        /// <summary>
+        /// Overwrite the oldest frame that has not been acquired yet.
+        /// </summary>
+        DropOldest = 0,
+
+        /// <summary>
+        /// Skip capturing the new frame.
+        /// </summary>
+        DropNewest = 1,
+
+        /// <summary>
+        /// Block <see cref="AsyncReadback"/>'s update until a frame is released, frames have to be released from
+        /// another thread for this to help. The new frame is skipped if none is released within the timeout.
+        /// </summary>
+        Block = 2,
+    }
+
+    /// <summary>
+    /// Frame of a <see cref="ReadbackStream"/>, valid until it is released or the stream is disposed of.
+    /// </summary>
+    public struct ReadbackStreamFrame
+    {
+        public NativeArray<byte> data;
+
+        /// <summary>
+        /// Number of the capture since the stream was opened.
+        /// </summary>
+        public ulong sequence;
+
+        /// <summary>
+        /// Native request that captured the frame.
+        /// </summary>
+        public int eventId;
+
+#if ENABLE_UNITY_COLLECTIONS_CHECKS
+        internal AtomicSafetyHandle safetyHandle;
+#endif
+    }
+
+    /// <summary>
+    /// Counters of a <see cref="ReadbackStream"/>. Layout matches the native StreamStats struct.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct StreamStats
+    {
+        /// <summary>
+        /// Frames captured without error.
+        /// </summary>
+        public ulong captured;
+
+        /// <summary>
+        /// Frames lost to the drop policy, either overwritten or never captured.
+        /// </summary>
+        public ulong dropped;
+
+        public ulong errors;
+
+        /// <summary>
+        /// Frames waiting to be acquired.
+        /// </summary>
+        public ulong ready;
+
+        public ulong inFlight;
+    }
+
+    /// <summary>
+    /// Reads a texture back every frame into a fixed ring of slots whose GPU staging buffers and result memory are
+    /// reused from frame to frame, for video streaming and similar continuous captures. Completed frames are taken
+    /// with <see cref="TryAcquireFrame"/> and handed back with <see cref="ReleaseFrame"/>, from any thread.
+    /// Only available when <see cref="AsyncReadback.usesCustomPlugin"/> is true.
+    /// </summary>
+    public sealed class ReadbackStream : IDisposable
+    {
+        private const int InvalidHandle = -1;
+
+        private int handle;
+
+        private ReadbackStream(int handle)
+        {
+            this.handle = handle;
+        }
+
+        /// <summary>
+        /// Start capturing a texture, the first capture is issued by the next update.
+        /// </summary>
+        /// <param name="src">Texture to capture</param>
+        /// <param name="slots">Number of frames in flight and waiting to be acquired</param>
+        /// <param name="policy">What to do when every slot is in use</param>
+        /// <param name="blockTimeout">
+        /// Longest time the update waits for a slot with <see cref="StreamDropPolicy.Block"/>, 5 ms by default
+        /// </param>
+        /// <param name="options">Options of every capture</param>
+        /// <param name="mipmapIndex">Mip level to capture</param>
+        /// <returns></returns>
+        public static ReadbackStream Open(Texture src, int slots = 3,
+            StreamDropPolicy policy = StreamDropPolicy.DropOldest, TimeSpan? blockTimeout = null,
+            ReadbackOptions options = default, int mipmapIndex = 0)
+        {
+            if (!AsyncReadback.usesCustomPlugin)
+                throw new NotSupportedException("Readback streams are only supported by the OpenGL readback plugin");
+
+            ulong timeoutNs = (ulong)((blockTimeout ?? TimeSpan.FromMilliseconds(5)).Ticks * 100);
+            int handle = Stream_Open(src.GetNativeTexturePtr().ToInt32(), mipmapIndex, (ulong)Math.Max(slots, 1),
+                (uint)policy, timeoutNs, ref options);
+            if (handle == InvalidHandle) throw new ArgumentException($"Invalid drop policy {policy}", nameof(policy));
+            return new ReadbackStream(handle);
+        }
+
+        public StreamStats stats
+        {
+            get
+            {
+                StreamStats value = default;
+                if (handle != InvalidHandle) Stream_GetStats(handle, ref value);
+                return value;
+            }
+        }
+
+        /// <summary>
+        /// Take the oldest captured frame that has not been acquired yet, it keeps its slot until released.
+        /// </summary>
+        public unsafe bool TryAcquireFrame(out ReadbackStreamFrame frame)
+        {
+            frame = default;
+            NativeFrame native = default;
+            if (handle == InvalidHandle || !Stream_AcquireFrame(handle, ref native)) return false;
+
+            frame.data = NativeArrayUnsafeUtility.ConvertExistingDataToNativeArray<byte>((void*)native.data,
+                checked((int)native.length), Allocator.None);
+            frame.sequence = native.sequence;
+            frame.eventId = native.eventId;
+#if ENABLE_UNITY_COLLECTIONS_CHECKS
+            frame.safetyHandle = AtomicSafetyHandle.Create();
+            NativeArrayUnsafeUtility.SetAtomicSafetyHandle(ref frame.data, frame.safetyHandle);
+#endif
+            return true;
+        }
+
+        /// <summary>
+        /// Hand an acquired frame back so that its slot can be captured into again, its data is invalid afterwards.
+        /// </summary>
+        public void ReleaseFrame(ReadbackStreamFrame frame)
+        {
+#if ENABLE_UNITY_COLLECTIONS_CHECKS
+            AtomicSafetyHandle.CheckDeallocateAndThrow(frame.safetyHandle);
+            AtomicSafetyHandle.Release(frame.safetyHandle);
+#endif
+            if (handle != InvalidHandle) Stream_ReleaseFrame(handle, frame.sequence);
+        }
+
+        /// <summary>
+        /// Stop capturing. Frames still acquired are invalid afterwards, captures in flight are discarded.
+        /// </summary>
+        public void Dispose()
+        {
+            if (handle == InvalidHandle) return;
+            Stream_Close(handle);
+            handle = InvalidHandle;
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        private struct NativeFrame
+        {
+            public IntPtr data;
+            public ulong length;
+            public ulong sequence;
+            public int eventId;
+        }
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        private static extern int Stream_Open(int texture, int miplevel, ulong slots, uint dropPolicy,
+            ulong blockTimeoutNs, ref ReadbackOptions options);
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        private static extern void Stream_Close(int stream);
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool Stream_AcquireFrame(int stream, ref NativeFrame frame);
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool Stream_ReleaseFrame(int stream, ulong sequence);
+
+        [DllImport("OpenGLAsyncGPUReadbackPlugin")]
+        [return: MarshalAs(UnmanagedType.U1)]
+        private static extern bool Stream_GetStats(int stream, ref StreamStats stats);
+    }
+}
@@ -0,0 +1,34 @@
+﻿using System.Runtime.InteropServices;
+
+namespace UniversalAsyncGPUReadbackPlugin
+{
+    /// <summary>
+    /// Time an OpenGL readback request spent inside GL calls that return right away while the readback stays
+    /// asynchronous. Long times point at formats and sizes the driver cannot read back without stalling.
+    /// Layout matches the native RequestStalls struct.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct RequestStalls
+    {
+        /// <summary>
+        /// Nanoseconds in glMapBufferRange.
+        /// </summary>
+        public ulong mapNs;
+
+        /// <summary>
+        /// Nanoseconds in glReadPixels, only for textures.
+        /// </summary>
+        public ulong readPixelsNs;
+
+        /// <summary>
+        /// Nanoseconds in glClientWaitSync, includes explicit waits such as WaitForCompletion.
+        /// </summary>
+        public ulong clientWaitNs;
+
+        /// <summary>
+        /// Any of the above took longer than the threshold set with <see cref="AsyncReadback.SetStallThreshold"/>.
+        /// Set once the request is done.
+        /// </summary>
+        [MarshalAs(UnmanagedType.U1)] public bool stalled;
+    }
+}
@@ -0,0 +1,58 @@
+﻿using System.Runtime.InteropServices;
+
+namespace UniversalAsyncGPUReadbackPlugin
+{
+    /// <summary>
+    /// Lifecycle timestamps of an OpenGL readback request in nanoseconds of a monotonic clock, 0 for stages that were
+    /// not reached. Only recorded when the native plugin is built with READBACK_TIMINGS.
+    /// Layout matches the native RequestTimings struct.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct RequestTimings
+    {
+        /// <summary>
+        /// Request created.
+        /// </summary>
+        public ulong submitted;
+
+        /// <summary>
+        /// Copy issued on the render thread.
+        /// </summary>
+        public ulong started;
+
+        /// <summary>
+        /// GPU started the copy. Not recorded for requests retrieved by the readback thread.
+        /// </summary>
+        public ulong gpuCopyStart;
+
+        /// <summary>
+        /// GPU finished the copy. Not recorded for requests retrieved by the readback thread.
+        /// </summary>
+        public ulong gpuCopyEnd;
+
+        /// <summary>
+        /// Fence observed as signalled.
+        /// </summary>
+        public ulong signalled;
+
+        /// <summary>
+        /// Staging buffer mapped.
+        /// </summary>
+        public ulong mapped;
+
+        /// <summary>
+        /// Data copied out of the staging buffer.
+        /// </summary>
+        public ulong copied;
+
+        /// <summary>
+        /// Reported as done, after post-processing.
+        /// </summary>
+        public ulong done;
+
+        /// <summary>
+        /// Released by the update after it was seen done.
+        /// </summary>
+        public ulong released;
+    }
+}